@@ -112,12 +112,31 @@ class OdinInaira(object):
     def get_frame_updates(self, msg):
         frame_data = json.loads(msg[0])
 
+        # Batched result messages carry the results of several frames in a single part
+        if 'results' in frame_data:
+            for result in frame_data['results']:
+                self.update_frame_results(result)
+            return False
+
+        # When results are batched, live images arrive on their own as header and data parts
+        if 'frame_number' not in frame_data:
+            if self.process_live_image:
+                self.send_live_image(msg)
+            return False
+
         if self.process_live_image:
-            logging.info("Sending Image data from Inaira to Live View")
-            liveview_data = msg[1:]
-            liveview_adapter = self.adapters['live_view']
-            liveview_adapter.live_viewer.create_image_from_socket(liveview_data)
+            self.send_live_image(msg[1:])
+
+        self.update_frame_results(frame_data)
+
+        return False
 
+    def send_live_image(self, liveview_data):
+        logging.info("Sending Image data from Inaira to Live View")
+        liveview_adapter = self.adapters['live_view']
+        liveview_adapter.live_viewer.create_image_from_socket(liveview_data)
+
+    def update_frame_results(self, frame_data):
         self.frame_number = frame_data['frame_number']
         self.total_frames = self.frame_number + 1
         self.process_time = frame_data['process_time']
@@ -146,9 +165,6 @@ class OdinInaira(object):
 
         logging.debug(" Avg Process Time = " + str(self.avg_process_time) + "ms")
 
-
-        return False
-
     def cleanup(self):
         for channel in self.ipc_channels:
             channel.cleanup()
@@ -0,0 +1,50 @@
+#
+# - FindBlosc module
+# Module to find the Blosc compression library. Set BLOSC_ROOT_DIR to search a specific
+# installation prefix before the default locations.
+#
+# After running the find, the variables below will be defined:
+#   BLOSC_FOUND          System has Blosc libs/headers
+#   BLOSC_INCLUDE_DIRS   The location of Blosc headers
+#   BLOSC_LIBRARIES      The Blosc libraries
+#
+
+message("\nLooking for Blosc headers and libraries")
+
+if (BLOSC_ROOT_DIR)
+    message(STATUS "Searching Blosc root dir: ${BLOSC_ROOT_DIR}")
+endif()
+
+find_path(BLOSC_INCLUDE_DIR
+    blosc.h
+    HINTS ${BLOSC_ROOT_DIR}
+    PATH_SUFFIXES include
+)
+
+find_library(BLOSC_LIBRARY
+    NAMES blosc
+    HINTS ${BLOSC_ROOT_DIR}
+    PATH_SUFFIXES lib lib64
+)
+
+include(FindPackageHandleStandardArgs)
+
+find_package_handle_standard_args(BLOSC
+    DEFAULT_MSG
+    BLOSC_INCLUDE_DIR
+    BLOSC_LIBRARY
+)
+
+if (BLOSC_FOUND)
+
+    set(BLOSC_INCLUDE_DIRS ${BLOSC_INCLUDE_DIR})
+    set(BLOSC_LIBRARIES ${BLOSC_LIBRARY})
+
+    message(STATUS "Include dirs: ${BLOSC_INCLUDE_DIRS}")
+    message(STATUS "Libraries: ${BLOSC_LIBRARIES}")
+
+else()
+    message(STATUS "Blosc package not found, not building compression plugin")
+endif()
+
+mark_as_advanced(BLOSC_INCLUDE_DIR BLOSC_LIBRARY)
@@ -0,0 +1,287 @@
+#ifndef INCLUDE_INAIRACRC32C_H_
+#define INCLUDE_INAIRACRC32C_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <cstddef>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "InairaDefinitions.h"
+
+namespace Inaira
+{
+    // CRC32C (Castagnoli) checksums of frame payloads, computed by the receiver when an image is
+    // grabbed and verified by the first processor plugin, so that corruption can be attributed to
+    // the grabber, the shared memory or a plugin.
+    //
+    // On x86-64 processors with SSE4.2 the CRC32 instruction is used on three independent streams
+    // of the buffer at once, hiding its three cycle latency, and the stream CRCs are combined with
+    // precomputed zero shift tables. This runs at several bytes per cycle, so a multi-megabyte
+    // frame is checked in well under a millisecond. Other processors use a slicing-by-8 table
+    // implementation. The implementation is chosen once at runtime and both give identical results.
+
+    const uint32_t CRC32C_POLY = 0x82F63B78;        // Reflected Castagnoli polynomial
+    const std::size_t CRC32C_LONG = 8192;           // Stream lengths of the hardware method
+    const std::size_t CRC32C_SHORT = 256;
+
+    class Crc32c
+    {
+        public:
+            // Return the process wide instance, building the tables on first use
+            static const Crc32c& instance(void)
+            {
+                static Crc32c crc32c;
+                return crc32c;
+            }
+
+            // Build the tables and choose the implementation. Callers normally share instance(),
+            // but a separate instance can be built to compare the two implementations.
+            Crc32c() :
+                hardware_(false)
+            {
+                // Build the slicing-by-8 tables, each extending the previous by a zero byte
+                for (uint32_t n = 0; n < 256; n++)
+                {
+                    uint32_t crc = n;
+                    for (int k = 0; k < 8; k++)
+                    {
+                        crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+                    }
+                    table_[0][n] = crc;
+                }
+                for (uint32_t n = 0; n < 256; n++)
+                {
+                    uint32_t crc = table_[0][n];
+                    for (int k = 1; k < 8; k++)
+                    {
+                        crc = table_[0][crc & 0xFF] ^ (crc >> 8);
+                        table_[k][n] = crc;
+                    }
+                }
+
+                useHardware(true);
+                zerosTable(long_shift_, CRC32C_LONG);
+                zerosTable(short_shift_, CRC32C_SHORT);
+            }
+
+            /**
+             * Update a CRC32C with the contents of a buffer.
+             *
+             * \param[in] crc - CRC of the preceding data, or 0 to start a new CRC
+             * \param[in] data - pointer to the buffer
+             * \param[in] size - size of the buffer in bytes
+             * \return updated CRC
+             */
+            uint32_t update(uint32_t crc, const void* data, std::size_t size) const
+            {
+#if defined(__x86_64__)
+                if (hardware_)
+                {
+                    return updateHardware(crc, static_cast<const uint8_t*>(data), size);
+                }
+#endif
+                return updateSoftware(crc, static_cast<const uint8_t*>(data), size);
+            }
+
+            bool hardware(void) const
+            {
+                return hardware_;
+            }
+
+            // Use the CRC32 instruction if enabled and supported, otherwise the table
+            // implementation, returning true if the instruction is used
+            bool useHardware(bool enable)
+            {
+                hardware_ = false;
+#if defined(__x86_64__)
+                __builtin_cpu_init();
+                hardware_ = enable && __builtin_cpu_supports("sse4.2");
+#endif
+                return hardware_;
+            }
+
+        private:
+
+            uint32_t updateSoftware(uint32_t crc, const uint8_t* next, std::size_t size) const
+            {
+                crc = ~crc;
+                while (size && (reinterpret_cast<uintptr_t>(next) & 7))
+                {
+                    crc = table_[0][(crc ^ *next++) & 0xFF] ^ (crc >> 8);
+                    size--;
+                }
+                while (size >= 8)
+                {
+                    uint64_t word;
+                    memcpy(&word, next, sizeof(word));
+                    word ^= crc;
+                    crc = table_[7][word & 0xFF] ^ table_[6][(word >> 8) & 0xFF] ^
+                        table_[5][(word >> 16) & 0xFF] ^ table_[4][(word >> 24) & 0xFF] ^
+                        table_[3][(word >> 32) & 0xFF] ^ table_[2][(word >> 40) & 0xFF] ^
+                        table_[1][(word >> 48) & 0xFF] ^ table_[0][word >> 56];
+                    next += 8;
+                    size -= 8;
+                }
+                while (size)
+                {
+                    crc = table_[0][(crc ^ *next++) & 0xFF] ^ (crc >> 8);
+                    size--;
+                }
+                return ~crc;
+            }
+
+#if defined(__x86_64__)
+            __attribute__((target("sse4.2")))
+            uint32_t updateHardware(uint32_t crc, const uint8_t* next, std::size_t size) const
+            {
+                uint64_t crc0 = static_cast<uint32_t>(~crc);
+                while (size && (reinterpret_cast<uintptr_t>(next) & 7))
+                {
+                    crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *next++);
+                    size--;
+                }
+
+                // Checksum three adjacent streams at once, then shift the CRC of each stream
+                // over the length of the next and combine them
+                while (size >= CRC32C_LONG * 3)
+                {
+                    crc0 = hardwareStreams(crc0, next, CRC32C_LONG, long_shift_);
+                    next += CRC32C_LONG * 3;
+                    size -= CRC32C_LONG * 3;
+                }
+                while (size >= CRC32C_SHORT * 3)
+                {
+                    crc0 = hardwareStreams(crc0, next, CRC32C_SHORT, short_shift_);
+                    next += CRC32C_SHORT * 3;
+                    size -= CRC32C_SHORT * 3;
+                }
+
+                while (size >= 8)
+                {
+                    crc0 = _mm_crc32_u64(crc0, *reinterpret_cast<const uint64_t*>(next));
+                    next += 8;
+                    size -= 8;
+                }
+                while (size)
+                {
+                    crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *next++);
+                    size--;
+                }
+                return ~static_cast<uint32_t>(crc0);
+            }
+
+            __attribute__((target("sse4.2")))
+            uint64_t hardwareStreams(uint64_t crc0, const uint8_t* next, std::size_t length,
+                const uint32_t shift[4][256]) const
+            {
+                uint64_t crc1 = 0;
+                uint64_t crc2 = 0;
+                const uint8_t* end = next + length;
+                do
+                {
+                    crc0 = _mm_crc32_u64(crc0, *reinterpret_cast<const uint64_t*>(next));
+                    crc1 = _mm_crc32_u64(crc1, *reinterpret_cast<const uint64_t*>(next + length));
+                    crc2 = _mm_crc32_u64(crc2,
+                        *reinterpret_cast<const uint64_t*>(next + 2 * length));
+                    next += 8;
+                } while (next < end);
+                crc0 = applyShift(shift, static_cast<uint32_t>(crc0)) ^ crc1;
+                return applyShift(shift, static_cast<uint32_t>(crc0)) ^ crc2;
+            }
+#endif
+
+            // Apply a zero shift table to a CRC, giving the CRC extended by that many zero bytes
+            static uint32_t applyShift(const uint32_t shift[4][256], uint32_t crc)
+            {
+                return shift[0][crc & 0xFF] ^ shift[1][(crc >> 8) & 0xFF] ^
+                    shift[2][(crc >> 16) & 0xFF] ^ shift[3][crc >> 24];
+            }
+
+            static uint32_t gf2MatrixTimes(const uint32_t* matrix, uint32_t vector)
+            {
+                uint32_t sum = 0;
+                while (vector)
+                {
+                    if (vector & 1)
+                    {
+                        sum ^= *matrix;
+                    }
+                    vector >>= 1;
+                    matrix++;
+                }
+                return sum;
+            }
+
+            static void gf2MatrixSquare(uint32_t* square, const uint32_t* matrix)
+            {
+                for (int n = 0; n < 32; n++)
+                {
+                    square[n] = gf2MatrixTimes(matrix, matrix[n]);
+                }
+            }
+
+            // Build the table shifting a CRC over a power of two number of zero bytes, by
+            // repeatedly squaring the GF(2) operator for a single zero bit
+            static void zerosTable(uint32_t shift[4][256], std::size_t length)
+            {
+                uint32_t even[32];
+                uint32_t odd[32];
+                odd[0] = CRC32C_POLY;
+                uint32_t row = 1;
+                for (int n = 1; n < 32; n++)
+                {
+                    odd[n] = row;
+                    row <<= 1;
+                }
+                gf2MatrixSquare(even, odd);         // Two zero bits
+                gf2MatrixSquare(odd, even);         // Four zero bits
+
+                const uint32_t* op = odd;
+                do
+                {
+                    gf2MatrixSquare(even, odd);
+                    op = even;
+                    length >>= 1;
+                    if (length == 0)
+                    {
+                        break;
+                    }
+                    gf2MatrixSquare(odd, even);
+                    op = odd;
+                    length >>= 1;
+                } while (length);
+
+                for (uint32_t n = 0; n < 256; n++)
+                {
+                    shift[0][n] = gf2MatrixTimes(op, n);
+                    shift[1][n] = gf2MatrixTimes(op, n << 8);
+                    shift[2][n] = gf2MatrixTimes(op, n << 16);
+                    shift[3][n] = gf2MatrixTimes(op, n << 24);
+                }
+            }
+
+            bool hardware_;
+            uint32_t table_[8][256];
+            uint32_t long_shift_[4][256];
+            uint32_t short_shift_[4][256];
+    };
+
+    // Calculate the CRC32C of a buffer, optionally continuing the CRC of preceding data
+    inline uint32_t crc32c(const void* data, std::size_t size, uint32_t crc = 0)
+    {
+        return Crc32c::instance().update(crc, data, size);
+    }
+
+    // Check the payload CRC of a frame whose header flags it as present. The image must lie
+    // within the frame buffer, which the caller checks against the size of the buffer.
+    inline bool valid_payload_checksum(const FrameHeader* header)
+    {
+        const uint8_t* image = reinterpret_cast<const uint8_t*>(header) + header->image_offset;
+        return crc32c(image, header->frame_size) == header->payload_crc;
+    }
+}
+
+#endif /*INCLUDE_INAIRACRC32C_H_*/
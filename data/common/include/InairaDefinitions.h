@@ -1,19 +1,93 @@
 #ifndef INCLUDE_INAIRADEFINITIONS_H_
 #define INCLUDE_INAIRADEFINITIONS_H_
 
+#include <stdint.h>
+#include <time.h>
+#include <cstddef>
+
 namespace Inaira
 {
+    // Magic word ("INAI" in memory order) and version at the start of every frame header
+    const uint32_t FRAME_HEADER_MAGIC = 0x49414E49;
+    const uint16_t FRAME_HEADER_VERSION = 4;
+
+    // Default alignment of the image within each frame buffer, a cache line, and the largest
+    // supported alignment, a page. Alignments must be powers of two in this range.
+    const uint32_t FRAME_IMAGE_ALIGNMENT = 64;
+    const uint32_t FRAME_IMAGE_ALIGNMENT_MAX = 4096;
+
+    // Frame header status flags
+    enum FrameStatusFlags
+    {
+        FrameHostTimestamps = 1 << 0,       // Host acquisition timestamps are valid
+        FrameCameraTimestamp = 1 << 1,      // Camera image number and timestamp are valid
+        FrameSimulated = 1 << 2,            // Frame was produced by a simulator, not a camera
+        FrameMonotonicTimestamps = 1 << 3,  // Monotonic grab and ready timestamps are valid
+        FramePayloadChecksum = 1 << 4       // Payload CRC32C of the image is valid
+    };
+
+    // Frame header at the start of each shared memory buffer. The layout is fixed at 88 bytes
+    // with naturally aligned fields, and must match the struct format in the Python frame
+    // producer. Any change to the layout must increment the version. The image follows the header
+    // at image_offset, padded so that the image is aligned in memory.
     typedef struct
     {
+        uint32_t magic;                     // FRAME_HEADER_MAGIC
+        uint16_t version;                   // FRAME_HEADER_VERSION
+        uint16_t header_size;               // Size of this header in bytes
         uint32_t frame_number;
-        // uint32_t frame_state;
-        // uint64_t frame_start_time_secs;
-        // uint64_t frame_start_nsecs;
-        uint32_t frame_width;
-        uint32_t frame_height;
+        uint32_t frame_width;               // Pixels per row, decoded to dimensions (height, width)
+        uint32_t frame_height;              // Rows of the row-major image
         uint32_t frame_data_type;
         uint32_t frame_size;
+        uint32_t status_flags;              // FrameStatusFlags
+        uint64_t acquisition_start_ns;      // Host realtime clock at start of image acquisition
+        uint64_t acquisition_end_ns;        // Host realtime clock when the image was received
+        uint32_t camera_image_number;       // Camera image number from BCD timestamp
+        uint32_t image_offset;              // Offset of the image from the start of the buffer
+        uint64_t camera_timestamp;          // Camera timestamp in microseconds
+        uint64_t grab_mono_ns;              // Monotonic clock when the image grab completed
+        uint64_t ready_mono_ns;             // Monotonic clock when the frame was notified ready
+        uint32_t payload_crc;               // CRC32C of the frame_size bytes of the image
+        uint32_t reserved;
     } FrameHeader;
+
+    // Check that a buffer starts with a frame header of the current version
+    inline bool valid_frame_header(const FrameHeader* header)
+    {
+        return (header->magic == FRAME_HEADER_MAGIC) &&
+            (header->version == FRAME_HEADER_VERSION) &&
+            (header->header_size == sizeof(FrameHeader)) &&
+            (header->image_offset >= sizeof(FrameHeader));
+    }
+
+    // Check that the image described by a valid frame header lies within a frame buffer of the
+    // given size, and holds at least frame_width * frame_height pixels of the given size in bytes
+    inline bool valid_frame_image(const FrameHeader* header, std::size_t buffer_size,
+        std::size_t pixel_size)
+    {
+        uint64_t pixels_size = static_cast<uint64_t>(header->frame_width) * header->frame_height *
+            pixel_size;
+        return (pixel_size > 0) &&
+            (static_cast<uint64_t>(header->image_offset) + header->frame_size <= buffer_size) &&
+            (header->frame_size >= pixels_size);
+    }
+
+    // Read the monotonic clock in nanoseconds. This is common to all processes on the host, so
+    // frame timestamps taken in the receiver can be compared with the time in the processor.
+    inline uint64_t monotonic_clock_ns(void)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (static_cast<uint64_t>(now.tv_sec) * 1000000000) + now.tv_nsec;
+    }
+
+    // Check that an image alignment is a power of two in the supported range
+    inline bool valid_image_alignment(uint32_t alignment)
+    {
+        return (alignment >= FRAME_IMAGE_ALIGNMENT) && (alignment <= FRAME_IMAGE_ALIGNMENT_MAX) &&
+            ((alignment & (alignment - 1)) == 0);
+    }
 }
 
 
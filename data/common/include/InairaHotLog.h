@@ -0,0 +1,394 @@
+#ifndef INCLUDE_INAIRAHOTLOG_H_
+#define INCLUDE_INAIRAHOTLOG_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <log4cxx/logger.h>
+#include "DebugLevelLogger.h"
+
+namespace Inaira
+{
+    // Asynchronous logging for per-frame messages on the hot processing paths, so that debug
+    // logging can stay enabled without slowing acquisition and inference to the rate of the
+    // synchronous log4cxx appenders.
+    //
+    // A message is captured as a record of its logger, level, format string literal and up to
+    // HOTLOG_MAX_ARGS arguments, copied by value into a ring of records owned by the logging
+    // thread. The ring is allocated on the first message from a thread, so capturing a message
+    // does not allocate or format anything. A background thread drains the rings every
+    // HOTLOG_DRAIN_INTERVAL_MS, replacing each {} in the format with the next argument and passing
+    // the message to the logger, so messages are delayed by up to the interval and are ordered
+    // within each thread but not between threads. String arguments are truncated to
+    // HOTLOG_STRING_SIZE - 1 characters. If a ring is full the message is dropped and the number
+    // of dropped messages is logged as a warning by the next drain.
+    //
+    // The logging macros check the logger level before capturing a message, so the levels set in
+    // the log4cxx configuration apply as they do to the LOG4CXX macros.
+    //
+    // Each record holds a reference to its logger until it is drained, so the logger stays valid
+    // whatever its owner does. The format literal lives in the library that logged it, so plugins
+    // and decoders call HotLog::flush() from their destructors to format their messages before
+    // the library can be unloaded.
+
+    const uint32_t HOTLOG_RING_SIZE = 1024;         // Records per thread, a power of two
+    const uint32_t HOTLOG_MAX_ARGS = 4;
+    const uint32_t HOTLOG_STRING_SIZE = 24;
+    const uint32_t HOTLOG_DRAIN_INTERVAL_MS = 10;
+
+    enum HotLogLevel
+    {
+        HotLogTrace = 0,
+        HotLogDebug = 1,
+        HotLogInfo = 2,
+        HotLogWarn = 3,
+        HotLogError = 4
+    };
+
+    enum HotLogArgType
+    {
+        HotLogArgUnsigned = 0,
+        HotLogArgSigned = 1,
+        HotLogArgDouble = 2,
+        HotLogArgString = 3,
+        HotLogArgHex = 4
+    };
+
+    // Wrapper for an argument to be formatted in hexadecimal, e.g. a buffer address
+    struct HotLogHex
+    {
+        explicit HotLogHex(uint64_t value) : value(value) {}
+        explicit HotLogHex(const void* addr) : value(reinterpret_cast<uintptr_t>(addr)) {}
+        uint64_t value;
+    };
+
+    typedef struct
+    {
+        uint32_t type;                      // HotLogArgType
+        union
+        {
+            uint64_t u;
+            int64_t i;
+            double d;
+            char s[HOTLOG_STRING_SIZE];
+        } value;
+    } HotLogArg;
+
+    typedef struct
+    {
+        log4cxx::LoggerPtr logger;          // Logger, released when the record is drained
+        const char* format;                 // Format string literal with {} for each argument
+        uint32_t level;                     // HotLogLevel
+        uint32_t num_args;
+        HotLogArg args[HOTLOG_MAX_ARGS];
+    } HotLogRecord;
+
+    // Single producer, single consumer ring of records written by one thread and drained by the
+    // background logging thread
+    class HotLogRing
+    {
+        public:
+            HotLogRing() :
+                head_(0),
+                tail_(0),
+                dropped_(0),
+                dropped_reported_(0)
+            {
+            }
+
+            // Claim the next record to write, or return null if the ring is full
+            HotLogRecord* claim(void)
+            {
+                uint64_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+                if (head_ - tail >= HOTLOG_RING_SIZE)
+                {
+                    __atomic_fetch_add(&dropped_, 1, __ATOMIC_RELAXED);
+                    return 0;
+                }
+                return &records_[head_ & (HOTLOG_RING_SIZE - 1)];
+            }
+
+            // Make the claimed record visible to the logging thread
+            void commit(void)
+            {
+                __atomic_store_n(&head_, head_ + 1, __ATOMIC_RELEASE);
+            }
+
+            /**
+             * Format and log all records written to the ring, then report any dropped messages
+             * to the logger of the last record. Called by the logging thread only.
+             */
+            void drain(void)
+            {
+                uint64_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+                log4cxx::LoggerPtr last_logger;
+                for (uint64_t index = tail_; index < head; index++)
+                {
+                    HotLogRecord& record = records_[index & (HOTLOG_RING_SIZE - 1)];
+                    last_logger = record.logger;
+                    try
+                    {
+                        record.logger->forcedLog(levelPtr(record.level), format(record));
+                    }
+                    catch (...)
+                    {
+                    }
+                    record.logger = log4cxx::LoggerPtr();
+                    __atomic_store_n(&tail_, index + 1, __ATOMIC_RELEASE);
+                }
+
+                uint64_t dropped = __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+                if (last_logger && dropped != dropped_reported_)
+                {
+                    std::ostringstream message;
+                    message << (dropped - dropped_reported_)
+                        << " hot path log messages dropped as the log ring was full";
+                    try
+                    {
+                        last_logger->forcedLog(log4cxx::Level::getWarn(), message.str());
+                    }
+                    catch (...)
+                    {
+                    }
+                    dropped_reported_ = dropped;
+                }
+            }
+
+        private:
+            static log4cxx::LevelPtr levelPtr(uint32_t level)
+            {
+                switch (level)
+                {
+                    case HotLogTrace:
+                        return log4cxx::Level::getTrace();
+                    case HotLogDebug:
+                        return log4cxx::Level::getDebug();
+                    case HotLogInfo:
+                        return log4cxx::Level::getInfo();
+                    case HotLogWarn:
+                        return log4cxx::Level::getWarn();
+                    default:
+                        return log4cxx::Level::getError();
+                }
+            }
+
+            // Replace each {} in the format with the next argument of the record
+            static std::string format(const HotLogRecord& record)
+            {
+                std::ostringstream message;
+                uint32_t arg = 0;
+                for (const char* c = record.format; *c; c++)
+                {
+                    if (c[0] == '{' && c[1] == '}' && arg < record.num_args)
+                    {
+                        const HotLogArg& value = record.args[arg++];
+                        switch (value.type)
+                        {
+                            case HotLogArgUnsigned:
+                                message << value.value.u;
+                                break;
+                            case HotLogArgSigned:
+                                message << value.value.i;
+                                break;
+                            case HotLogArgDouble:
+                                message << value.value.d;
+                                break;
+                            case HotLogArgString:
+                                message << value.value.s;
+                                break;
+                            default:
+                                message << std::hex << value.value.u << std::dec;
+                                break;
+                        }
+                        c++;
+                    }
+                    else
+                    {
+                        message << *c;
+                    }
+                }
+                return message.str();
+            }
+
+            HotLogRecord records_[HOTLOG_RING_SIZE];
+            alignas(64) uint64_t head_;     // Next record to write, owned by the producer
+            alignas(64) uint64_t tail_;     // Next record to drain, owned by the logging thread
+            uint64_t dropped_;              // Messages dropped as the ring was full
+            uint64_t dropped_reported_;     // Dropped messages already reported
+    };
+
+    class HotLog
+    {
+        public:
+            // Return the process wide hot path log, starting the logging thread on first use
+            static HotLog& instance(void)
+            {
+                static HotLog hot_log;
+                return hot_log;
+            }
+
+            /**
+             * Capture a message in the ring of the calling thread for formatting and logging by
+             * the logging thread. The caller is expected to have checked the logger level.
+             *
+             * \param[in] logger - logger to log the message to
+             * \param[in] level - level of the message
+             * \param[in] format - format string literal, which must stay loaded until the next
+             * flush() or drain
+             * \param[in] args - arguments replacing each {} in the format
+             */
+            template<typename... Args>
+            void log(const log4cxx::LoggerPtr& logger, HotLogLevel level, const char* format,
+                const Args&... args)
+            {
+                static_assert(sizeof...(Args) <= HOTLOG_MAX_ARGS, "Too many hot path log arguments");
+
+                HotLogRing* ring = threadRing();
+                HotLogRecord* record = ring->claim();
+                if (!record)
+                {
+                    return;
+                }
+                record->logger = logger;
+                record->format = format;
+                record->level = level;
+                record->num_args = sizeof...(Args);
+                HotLogArg* arg = record->args;
+                (void)arg;
+                (packArg(*arg++, args), ...);
+                ring->commit();
+            }
+
+            // Log all messages captured so far by all threads, e.g. before shutdown or before the
+            // library holding their format literals is unloaded
+            void flush(void)
+            {
+                drainAll();
+            }
+
+        private:
+            HotLog() :
+                running_(true)
+            {
+                thread_ = std::thread(&HotLog::run, this);
+            }
+
+            ~HotLog()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(run_mutex_);
+                    running_ = false;
+                }
+                run_condition_.notify_all();
+                thread_.join();
+                drainAll();
+            }
+
+            // Return the ring of the calling thread, allocating and registering it on first use.
+            // Rings are kept after their thread exits so that its last messages are logged.
+            HotLogRing* threadRing(void)
+            {
+                static thread_local HotLogRing* ring = 0;
+                if (!ring)
+                {
+                    ring = new HotLogRing;
+                    std::lock_guard<std::mutex> lock(rings_mutex_);
+                    rings_.push_back(std::unique_ptr<HotLogRing>(ring));
+                }
+                return ring;
+            }
+
+            template<typename T>
+            static void packArg(HotLogArg& arg, const T& value)
+            {
+                if constexpr (std::is_same<T, HotLogHex>::value)
+                {
+                    arg.type = HotLogArgHex;
+                    arg.value.u = value.value;
+                }
+                else if constexpr (std::is_convertible<const T&, const char*>::value)
+                {
+                    arg.type = HotLogArgString;
+                    strncpy(arg.value.s, value, HOTLOG_STRING_SIZE - 1);
+                    arg.value.s[HOTLOG_STRING_SIZE - 1] = '\0';
+                }
+                else if constexpr (std::is_same<T, std::string>::value)
+                {
+                    arg.type = HotLogArgString;
+                    strncpy(arg.value.s, value.c_str(), HOTLOG_STRING_SIZE - 1);
+                    arg.value.s[HOTLOG_STRING_SIZE - 1] = '\0';
+                }
+                else if constexpr (std::is_floating_point<T>::value)
+                {
+                    arg.type = HotLogArgDouble;
+                    arg.value.d = value;
+                }
+                else if constexpr (std::is_signed<T>::value || std::is_enum<T>::value)
+                {
+                    arg.type = HotLogArgSigned;
+                    arg.value.i = static_cast<int64_t>(value);
+                }
+                else
+                {
+                    static_assert(std::is_integral<T>::value, "Unsupported hot path log argument");
+                    arg.type = HotLogArgUnsigned;
+                    arg.value.u = static_cast<uint64_t>(value);
+                }
+            }
+
+            void run(void)
+            {
+                std::unique_lock<std::mutex> lock(run_mutex_);
+                while (running_)
+                {
+                    run_condition_.wait_for(
+                        lock, std::chrono::milliseconds(HOTLOG_DRAIN_INTERVAL_MS));
+                    lock.unlock();
+                    drainAll();
+                    lock.lock();
+                }
+            }
+
+            // Drain the rings of all threads, serialised so each ring has a single consumer
+            void drainAll(void)
+            {
+                std::lock_guard<std::mutex> lock(rings_mutex_);
+                for (std::size_t index = 0; index < rings_.size(); index++)
+                {
+                    rings_[index]->drain();
+                }
+            }
+
+            bool running_;
+            std::mutex run_mutex_;
+            std::condition_variable run_condition_;
+            std::thread thread_;
+            std::mutex rings_mutex_;
+            std::vector<std::unique_ptr<HotLogRing> > rings_;
+    };
+}
+
+// Hot path equivalents of the LOG4CXX macros, taking a format string literal with {} for each
+// argument instead of a stream expression, e.g.
+//     INAIRA_HOTLOG_DEBUG(logger_, "Frame {} took {}ms", frame_number, process_time);
+#define INAIRA_HOTLOG_TRACE(logger, ...) do { if ((logger)->isTraceEnabled()) { \
+    Inaira::HotLog::instance().log((logger), Inaira::HotLogTrace, __VA_ARGS__); } } while (0)
+#define INAIRA_HOTLOG_DEBUG(logger, ...) do { if ((logger)->isDebugEnabled()) { \
+    Inaira::HotLog::instance().log((logger), Inaira::HotLogDebug, __VA_ARGS__); } } while (0)
+
+// Hot path equivalent of LOG4CXX_DEBUG_LEVEL, logging only at or above the odin-data debug level
+#define INAIRA_HOTLOG_DEBUG_LEVEL(level, logger, ...) do { \
+    if ((level) <= debug_level && (logger)->isDebugEnabled()) { \
+    Inaira::HotLog::instance().log((logger), Inaira::HotLogDebug, __VA_ARGS__); } } while (0)
+
+#endif /*INCLUDE_INAIRAHOTLOG_H_*/
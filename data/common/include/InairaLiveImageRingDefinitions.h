@@ -0,0 +1,47 @@
+#ifndef INCLUDE_INAIRALIVEIMAGERINGDEFINITIONS_H_
+#define INCLUDE_INAIRALIVEIMAGERINGDEFINITIONS_H_
+
+#include <stdint.h>
+
+namespace Inaira
+{
+    // Layout of the POSIX shared memory ring of live preview images written by InairaMLPlugin.
+    //
+    // The segment starts with a 64 byte ring header, followed by num_slots slots of slot_size
+    // bytes. Each slot starts with a 64 byte slot header followed by the image data. Readers find
+    // the newest image in slot (write_count - 1) % num_slots and use the slot sequence number as a
+    // seqlock: the sequence is odd while the slot is being written, so a reader copies the slot
+    // only if the sequence is even and unchanged before and after the copy. The slot shape is the
+    // (height, width) of the row-major image, i.e. the number of rows then the number of columns.
+
+    const uint32_t LIVE_IMAGE_RING_MAGIC = 0x474E5249; // "IRNG"
+    const uint32_t LIVE_IMAGE_RING_VERSION = 1;
+    const uint32_t LIVE_IMAGE_RING_HEADER_SIZE = 64;
+    const uint32_t LIVE_IMAGE_SLOT_HEADER_SIZE = 64;
+    const uint32_t LIVE_IMAGE_CLASS_UNKNOWN = 0xFFFFFFFF;
+
+    typedef struct
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t num_slots;
+        uint32_t slot_size;
+        uint64_t max_image_size;
+        uint64_t write_count;
+        uint8_t reserved[32];
+    } LiveImageRingHeader;
+
+    typedef struct
+    {
+        uint64_t sequence;
+        uint64_t frame_number;
+        uint32_t classification;
+        float score;
+        uint32_t shape[2];                  // Image height, width
+        uint32_t data_type;
+        uint32_t image_size;
+        uint8_t reserved[24];
+    } LiveImageSlotHeader;
+}
+
+#endif /*INCLUDE_INAIRALIVEIMAGERINGDEFINITIONS_H_*/
@@ -0,0 +1,92 @@
+#ifndef INCLUDE_INAIRAMEMORYUSAGE_H_
+#define INCLUDE_INAIRAMEMORYUSAGE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+
+namespace Inaira
+{
+    // Memory footprint of the current process. The resident set size and its peak come from
+    // /proc/self/status, where the kernel tracks the peak continuously. The heap in use is every
+    // allocation made through malloc by the process, not the usage of any one allocator, and its
+    // peak is the largest value seen by sampleHeap() or read(). Callers sample the heap in their
+    // frame path so that the peak does not depend on how often status is requested.
+
+    class MemoryUsage
+    {
+        public:
+            MemoryUsage() :
+                rss_bytes(0),
+                rss_peak_bytes(0),
+                virtual_bytes(0),
+                heap_in_use_bytes(0),
+                heap_peak_bytes(0)
+            {
+            }
+
+            /**
+             * Update the heap in use and its peak. This walks the malloc arenas but does not
+             * read /proc, so it can be called once per frame.
+             */
+            void sampleHeap(void)
+            {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+                struct mallinfo2 info = mallinfo2();
+                heap_in_use_bytes = info.uordblks + info.hblkhd;
+#else
+                struct mallinfo info = mallinfo();
+                heap_in_use_bytes = static_cast<unsigned int>(info.uordblks) +
+                    static_cast<unsigned int>(info.hblkhd);
+#endif
+                if (heap_in_use_bytes > heap_peak_bytes)
+                {
+                    heap_peak_bytes = heap_in_use_bytes;
+                }
+            }
+
+            /**
+             * Update the memory usage of the process, including the heap.
+             *
+             * \return true if the process status could be read
+             */
+            bool read(void)
+            {
+                sampleHeap();
+
+                FILE* status_file = fopen("/proc/self/status", "r");
+                if (!status_file)
+                {
+                    return false;
+                }
+                char line[256];
+                unsigned long long value_kb;
+                while (fgets(line, sizeof(line), status_file))
+                {
+                    if (sscanf(line, "VmRSS: %llu kB", &value_kb) == 1)
+                    {
+                        rss_bytes = value_kb * 1024;
+                    }
+                    else if (sscanf(line, "VmHWM: %llu kB", &value_kb) == 1)
+                    {
+                        rss_peak_bytes = value_kb * 1024;
+                    }
+                    else if (sscanf(line, "VmSize: %llu kB", &value_kb) == 1)
+                    {
+                        virtual_bytes = value_kb * 1024;
+                    }
+                }
+                fclose(status_file);
+                return true;
+            }
+
+            uint64_t rss_bytes;                 // Resident set size
+            uint64_t rss_peak_bytes;            // Peak resident set size tracked by the kernel
+            uint64_t virtual_bytes;             // Virtual memory size, including shared buffers
+            uint64_t heap_in_use_bytes;         // Bytes allocated through malloc
+            uint64_t heap_peak_bytes;           // Largest heap in use sampled so far
+    };
+}
+
+#endif /*INCLUDE_INAIRAMEMORYUSAGE_H_*/
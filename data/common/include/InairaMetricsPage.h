@@ -0,0 +1,311 @@
+#ifndef INCLUDE_INAIRAMETRICSPAGE_H_
+#define INCLUDE_INAIRAMETRICSPAGE_H_
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "InairaDefinitions.h"
+
+namespace Inaira
+{
+    // Fixed layout POSIX shared memory page of counters and gauges, published by the receiver
+    // camera controller and the processor plugins so that monitoring tools can read them at any
+    // rate without sending status requests over the control channel.
+    //
+    // The page starts with a 64 byte header followed by METRICS_PAGE_MAX_METRICS entries of 64
+    // bytes, of which the first num_metrics are in use. Each entry holds a metric name, its type
+    // and its value, either an unsigned integer or the bits of a double. The header sequence
+    // number is a seqlock over the whole page: it is odd while the page is being updated, so a
+    // reader takes a consistent snapshot of all metrics by copying the page only if the sequence
+    // is even and unchanged before and after the copy. Each page has a single writer thread, which
+    // binds metrics to the variables holding them and publishes their values after each frame.
+
+    const uint32_t METRICS_PAGE_MAGIC = 0x54454D49; // "IMET"
+    const uint32_t METRICS_PAGE_VERSION = 1;
+    const uint32_t METRICS_PAGE_HEADER_SIZE = 64;
+    const uint32_t METRICS_PAGE_ENTRY_SIZE = 64;
+    const uint32_t METRICS_PAGE_MAX_METRICS = 127;
+    const uint32_t METRICS_PAGE_NAME_SIZE = 48;
+
+    enum MetricType
+    {
+        MetricCounter = 0,                  // Unsigned integer that only increases
+        MetricGauge = 1,                    // Unsigned integer that can go up and down
+        MetricValue = 2                     // Double precision value, e.g. a rate or latency
+    };
+
+    typedef struct
+    {
+        uint32_t magic;                     // METRICS_PAGE_MAGIC, written last on creation
+        uint32_t version;                   // METRICS_PAGE_VERSION
+        uint32_t num_metrics;               // Number of entries in use
+        uint32_t pid;                       // Process ID of the writer
+        uint64_t sequence;                  // Seqlock sequence, odd during an update
+        uint64_t update_ns;                 // Monotonic clock at the last update
+        uint8_t reserved[32];
+    } MetricsPageHeader;
+
+    typedef struct
+    {
+        char name[METRICS_PAGE_NAME_SIZE];  // Null terminated metric name
+        uint32_t type;                      // MetricType
+        uint32_t reserved;
+        uint64_t value;                     // Value, or the bits of a double for MetricValue
+    } MetricsPageEntry;
+
+    class MetricsPage
+    {
+        public:
+            MetricsPage() :
+                segment_(0),
+                dropped_bindings_(0)
+            {
+            }
+
+            ~MetricsPage()
+            {
+                destroy();
+            }
+
+            /**
+             * Create and map the shared memory page, replacing any existing page of the same name,
+             * and publish all metrics bound so far.
+             *
+             * \param[in] name - POSIX shared memory name of the page
+             * \return true if the page was created, otherwise false with errno set
+             */
+            bool create(const std::string& name)
+            {
+                std::lock_guard<std::mutex> lock(page_mutex_);
+                unmap();
+
+                this->name = (name[0] == '/') ? name : "/" + name;
+                int fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+                if (fd < 0)
+                {
+                    return false;
+                }
+                if (ftruncate(fd, segmentSize()) != 0)
+                {
+                    int error = errno;
+                    close(fd);
+                    shm_unlink(this->name.c_str());
+                    errno = error;
+                    return false;
+                }
+                void* addr = mmap(NULL, segmentSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                int error = errno;
+                close(fd);
+                if (addr == MAP_FAILED)
+                {
+                    shm_unlink(this->name.c_str());
+                    errno = error;
+                    return false;
+                }
+                segment_ = static_cast<uint8_t*>(addr);
+
+                MetricsPageHeader* header = pageHeader();
+                header->version = METRICS_PAGE_VERSION;
+                header->pid = static_cast<uint32_t>(getpid());
+                header->sequence = 0;
+                header->update_ns = monotonic_clock_ns();
+                for (uint32_t index = 0; index < metrics_.size(); index++)
+                {
+                    writeEntry(index);
+                }
+                header->num_metrics = metrics_.size();
+                // Publish the magic last so readers never see a partially initialised header
+                __atomic_store_n(&header->magic, METRICS_PAGE_MAGIC, __ATOMIC_RELEASE);
+                return true;
+            }
+
+            // Unmap and remove the shared memory page. Bound metrics are kept, so the page can be
+            // created again under a different name.
+            void destroy(void)
+            {
+                std::lock_guard<std::mutex> lock(page_mutex_);
+                unmap();
+            }
+
+            bool isOpen(void) const
+            {
+                return segment_ != 0;
+            }
+
+            /**
+             * Bind a metric to a counter or gauge, whose value is copied into the page by each
+             * publish. Metrics can be bound before or after the page is created, and the source
+             * must outlive the page. Sources are read with relaxed atomic loads, so a counter
+             * updated on another thread with atomic operations can be bound without a lock.
+             *
+             * \param[in] name - metric name, truncated to METRICS_PAGE_NAME_SIZE - 1 characters
+             * \param[in] source - variable holding the value of the metric
+             * \param[in] type - MetricCounter or MetricGauge
+             * \return true if the metric was bound, otherwise false with errno set to ENOSPC when
+             * the page already holds METRICS_PAGE_MAX_METRICS metrics
+             */
+            bool bind(const std::string& name, const uint64_t& source, MetricType type)
+            {
+                return addBinding(name, type, &source, sizeof(source));
+            }
+
+            bool bind(const std::string& name, const uint32_t& source, MetricType type)
+            {
+                return addBinding(name, type, &source, sizeof(source));
+            }
+
+            bool bind(const std::string& name, const bool& source)
+            {
+                return addBinding(name, MetricGauge, &source, sizeof(source));
+            }
+
+            bool bind(const std::string& name, const double& source)
+            {
+                return addBinding(name, MetricValue, &source, sizeof(source));
+            }
+
+            // Number of metrics that could not be bound because the page was full. Owners check
+            // this when creating the page, so that missing metrics are reported rather than lost.
+            uint32_t droppedBindings(void) const
+            {
+                return dropped_bindings_;
+            }
+
+            // Copy the current values of all bound metrics into the page as one consistent update.
+            // Publishing to a page that is not open does nothing, so it can be called on every
+            // frame, and an update is skipped rather than waiting while the page is being created
+            // or destroyed by another thread.
+            void publish(void)
+            {
+                std::unique_lock<std::mutex> lock(page_mutex_, std::try_to_lock);
+                if (!lock.owns_lock() || !segment_)
+                {
+                    return;
+                }
+
+                MetricsPageHeader* header = pageHeader();
+                uint64_t sequence = header->sequence;
+                __atomic_store_n(&header->sequence, sequence + 1, __ATOMIC_RELAXED);
+                __atomic_thread_fence(__ATOMIC_RELEASE);
+
+                for (uint32_t index = 0; index < bindings_.size(); index++)
+                {
+                    const MetricBinding& binding = bindings_[index];
+                    uint64_t value = 0;
+                    switch (binding.size)
+                    {
+                        case sizeof(uint64_t):
+                            // Doubles are published as their bits, like counters
+                            value = __atomic_load_n(static_cast<const uint64_t*>(binding.source),
+                                __ATOMIC_RELAXED);
+                            break;
+                        case sizeof(uint32_t):
+                            value = __atomic_load_n(static_cast<const uint32_t*>(binding.source),
+                                __ATOMIC_RELAXED);
+                            break;
+                        default:
+                            value = __atomic_load_n(static_cast<const bool*>(binding.source),
+                                __ATOMIC_RELAXED);
+                            break;
+                    }
+                    __atomic_store_n(&pageEntry(index)->value, value, __ATOMIC_RELAXED);
+                }
+
+                __atomic_store_n(&header->update_ns, monotonic_clock_ns(), __ATOMIC_RELAXED);
+                __atomic_store_n(&header->sequence, sequence + 2, __ATOMIC_RELEASE);
+            }
+
+            std::string name;
+
+        private:
+            typedef struct
+            {
+                const void* source;
+                std::size_t size;
+            } MetricBinding;
+
+            // Add a bound metric, writing its entry into the page if it is already open
+            bool addBinding(const std::string& name, MetricType type, const void* source,
+                std::size_t size)
+            {
+                std::lock_guard<std::mutex> lock(page_mutex_);
+                if (bindings_.size() >= METRICS_PAGE_MAX_METRICS)
+                {
+                    dropped_bindings_++;
+                    errno = ENOSPC;
+                    return false;
+                }
+                MetricsPageEntry entry;
+                memset(&entry, 0, sizeof(entry));
+                strncpy(entry.name, name.c_str(), METRICS_PAGE_NAME_SIZE - 1);
+                entry.type = type;
+                metrics_.push_back(entry);
+                MetricBinding binding = {source, size};
+                bindings_.push_back(binding);
+
+                if (segment_)
+                {
+                    MetricsPageHeader* header = pageHeader();
+                    uint64_t sequence = header->sequence;
+                    __atomic_store_n(&header->sequence, sequence + 1, __ATOMIC_RELAXED);
+                    __atomic_thread_fence(__ATOMIC_RELEASE);
+                    writeEntry(metrics_.size() - 1);
+                    __atomic_store_n(&header->num_metrics, metrics_.size(), __ATOMIC_RELAXED);
+                    __atomic_store_n(&header->sequence, sequence + 2, __ATOMIC_RELEASE);
+                }
+                return true;
+            }
+
+            void unmap(void)
+            {
+                if (segment_)
+                {
+                    munmap(segment_, segmentSize());
+                    shm_unlink(name.c_str());
+                    segment_ = 0;
+                }
+            }
+
+            std::size_t segmentSize(void) const
+            {
+                return METRICS_PAGE_HEADER_SIZE +
+                    (std::size_t)METRICS_PAGE_ENTRY_SIZE * METRICS_PAGE_MAX_METRICS;
+            }
+
+            MetricsPageHeader* pageHeader(void)
+            {
+                return reinterpret_cast<MetricsPageHeader*>(segment_);
+            }
+
+            MetricsPageEntry* pageEntry(uint32_t index)
+            {
+                return reinterpret_cast<MetricsPageEntry*>(
+                    segment_ + METRICS_PAGE_HEADER_SIZE + (std::size_t)METRICS_PAGE_ENTRY_SIZE * index);
+            }
+
+            // Copy the name and type of a metric into the page. The value is left as zero until
+            // the next update.
+            void writeEntry(uint32_t index)
+            {
+                MetricsPageEntry* entry = pageEntry(index);
+                memcpy(entry->name, metrics_[index].name, METRICS_PAGE_NAME_SIZE);
+                entry->type = metrics_[index].type;
+            }
+
+            uint8_t* segment_;
+            std::mutex page_mutex_;
+            std::vector<MetricsPageEntry> metrics_;
+            std::vector<MetricBinding> bindings_;
+            uint32_t dropped_bindings_;
+    };
+}
+
+#endif /*INCLUDE_INAIRAMETRICSPAGE_H_*/
@@ -0,0 +1,394 @@
+#ifndef INCLUDE_INAIRAPERFCOUNTERS_H_
+#define INCLUDE_INAIRAPERFCOUNTERS_H_
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <mutex>
+#include <string>
+
+#include "IpcMessage.h"
+
+namespace Inaira
+{
+    // Opt-in per-stage hardware performance counters, read with perf_event_open around the hot
+    // processing stages so that status can show whether a stage is compute or memory bound.
+    //
+    // Each thread opens one group of counters for itself the first time it profiles a stage: CPU
+    // cycles, instructions, cache misses and branch misses. Where the hardware counters are not
+    // available, e.g. in a virtual machine without a virtual PMU, the thread falls back to the
+    // task clock, page faults, context switches and CPU migrations software counters. A stage
+    // reads the group, a single system call, at its start and end and adds the differences to the
+    // totals for the stage. When profiling is disabled a stage costs one relaxed load and a
+    // branch. Counters are scaled for multiplexing when the kernel cannot schedule them all.
+
+    const uint32_t PERF_MAX_STAGES = 16;
+    const uint32_t PERF_NUM_COUNTERS = 4;
+    const uint32_t PERF_NUM_VALUES = 2 + PERF_NUM_COUNTERS;   // Time enabled, running, counters
+
+    enum PerfCounterMode
+    {
+        PerfUnavailable = 0,                // No counters could be opened
+        PerfHardware = 1,                   // Cycles, instructions, cache and branch misses
+        PerfSoftware = 2                    // Task clock, page faults, context and CPU switches
+    };
+
+    // Group of counters for the calling thread, opened on first use and closed at thread exit
+    class PerfThreadCounters
+    {
+        public:
+            PerfThreadCounters() :
+                mode(PerfUnavailable),
+                open_errno(0),
+                opened_(false)
+            {
+                for (uint32_t i = 0; i < PERF_NUM_COUNTERS; i++)
+                {
+                    fds_[i] = -1;
+                }
+            }
+
+            ~PerfThreadCounters()
+            {
+                closeGroup();
+            }
+
+            // Open the counter group for the calling thread, unless already attempted
+            void open(void)
+            {
+                if (opened_)
+                {
+                    return;
+                }
+                opened_ = true;
+
+                static const uint64_t hardware[PERF_NUM_COUNTERS] = {
+                    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+                };
+                static const uint64_t software[PERF_NUM_COUNTERS] = {
+                    PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_SW_PAGE_FAULTS,
+                    PERF_COUNT_SW_CONTEXT_SWITCHES, PERF_COUNT_SW_CPU_MIGRATIONS
+                };
+
+                if (openGroup(PERF_TYPE_HARDWARE, hardware))
+                {
+                    mode = PerfHardware;
+                }
+                else if (openGroup(PERF_TYPE_SOFTWARE, software))
+                {
+                    mode = PerfSoftware;
+                }
+            }
+
+            /**
+             * Read the times the group was enabled and running followed by the counter values.
+             *
+             * \param[out] values - times and counter values
+             * \return true if the counters were read
+             */
+            bool readValues(uint64_t values[PERF_NUM_VALUES])
+            {
+                // Group read format: number of counters, time enabled, time running, counters
+                uint64_t data[1 + PERF_NUM_VALUES];
+                if (mode == PerfUnavailable || ::read(fds_[0], data, sizeof(data)) != sizeof(data))
+                {
+                    return false;
+                }
+                memcpy(values, data + 1, sizeof(uint64_t) * PERF_NUM_VALUES);
+                return true;
+            }
+
+            PerfCounterMode mode;
+            int open_errno;                 // Error from opening the counters, if unavailable
+
+        private:
+            bool openGroup(uint32_t type, const uint64_t configs[PERF_NUM_COUNTERS])
+            {
+                for (uint32_t i = 0; i < PERF_NUM_COUNTERS; i++)
+                {
+                    struct perf_event_attr attr;
+                    memset(&attr, 0, sizeof(attr));
+                    attr.size = sizeof(attr);
+                    attr.type = type;
+                    attr.config = configs[i];
+                    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                        PERF_FORMAT_TOTAL_TIME_RUNNING;
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+
+                    // Count the calling thread on any CPU
+                    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, i ? fds_[0] : -1, 0);
+                    if (fd < 0)
+                    {
+                        open_errno = errno;
+                        closeGroup();
+                        return false;
+                    }
+                    fds_[i] = fd;
+                }
+                open_errno = 0;
+                return true;
+            }
+
+            void closeGroup(void)
+            {
+                for (uint32_t i = 0; i < PERF_NUM_COUNTERS; i++)
+                {
+                    if (fds_[i] >= 0)
+                    {
+                        close(fds_[i]);
+                        fds_[i] = -1;
+                    }
+                }
+            }
+
+            int fds_[PERF_NUM_COUNTERS];
+            bool opened_;
+    };
+
+    // Per-stage totals of the performance counters of a plugin or the camera service loop
+    class PerfCounters
+    {
+        public:
+            PerfCounters() :
+                enabled_(false),
+                mode_(PerfUnavailable),
+                open_errno_(0),
+                num_stages_(0)
+            {
+                reset();
+            }
+
+            // Enable or disable profiling, resetting the totals when enabled
+            void enable(bool enable)
+            {
+                if (enable)
+                {
+                    reset();
+                }
+                __atomic_store_n(&enabled_, enable, __ATOMIC_RELAXED);
+            }
+
+            bool enabled(void) const
+            {
+                return __atomic_load_n(&enabled_, __ATOMIC_RELAXED);
+            }
+
+            void reset(void)
+            {
+                for (uint32_t stage = 0; stage < PERF_MAX_STAGES; stage++)
+                {
+                    __atomic_store_n(&stages_[stage].count, 0, __ATOMIC_RELAXED);
+                    for (uint32_t i = 0; i < PERF_NUM_COUNTERS; i++)
+                    {
+                        __atomic_store_n(&stages_[stage].totals[i], 0, __ATOMIC_RELAXED);
+                    }
+                }
+            }
+
+            // Return the counter group of the calling thread, opening it on first use. The group
+            // is shared by all profiled stages in the thread, so the mode is taken from it on each
+            // use but only written when it differs.
+            PerfThreadCounters& threadCounters(void)
+            {
+                static thread_local PerfThreadCounters counters;
+                counters.open();
+                if (__atomic_load_n(&mode_, __ATOMIC_RELAXED) != counters.mode ||
+                    __atomic_load_n(&open_errno_, __ATOMIC_RELAXED) != counters.open_errno)
+                {
+                    __atomic_store_n(&mode_, counters.mode, __ATOMIC_RELAXED);
+                    __atomic_store_n(&open_errno_, counters.open_errno, __ATOMIC_RELAXED);
+                }
+                return counters;
+            }
+
+            // Add the counter differences over one execution of a stage to its totals, scaled up
+            // if the counters were only running for part of the stage
+            void record(const char* name, const uint64_t start[PERF_NUM_VALUES],
+                const uint64_t end[PERF_NUM_VALUES])
+            {
+                uint64_t enabled_ns = end[0] - start[0];
+                uint64_t running_ns = end[1] - start[1];
+                if (running_ns == 0)
+                {
+                    return;
+                }
+
+                uint32_t stage = findStage(name);
+                if (stage >= PERF_MAX_STAGES)
+                {
+                    return;
+                }
+                __atomic_fetch_add(&stages_[stage].count, 1, __ATOMIC_RELAXED);
+                for (uint32_t i = 0; i < PERF_NUM_COUNTERS; i++)
+                {
+                    uint64_t delta = end[2 + i] - start[2 + i];
+                    if (running_ns < enabled_ns)
+                    {
+                        delta = static_cast<uint64_t>(
+                            static_cast<double>(delta) * enabled_ns / running_ns);
+                    }
+                    __atomic_fetch_add(&stages_[stage].totals[i], delta, __ATOMIC_RELAXED);
+                }
+            }
+
+            /**
+             * Add the counter totals and derived rates of each stage to a status message. With
+             * hardware counters the rates are instructions per cycle and cache and branch misses
+             * per thousand instructions. With software counters they are the task clock and
+             * switches per execution of the stage.
+             *
+             * \param[in] status - status message to populate
+             * \param[in] path - parameter path prefix for the counters, ending in a slash
+             */
+            void status(OdinData::IpcMessage& status, const std::string& path) const
+            {
+                PerfCounterMode mode = static_cast<PerfCounterMode>(
+                    __atomic_load_n(&mode_, __ATOMIC_RELAXED));
+                status.set_param(path + "enabled", enabled());
+                status.set_param(path + "mode", std::string(
+                    mode == PerfHardware ? "hardware" : mode == PerfSoftware ? "software" :
+                    "unavailable"));
+                int open_errno = __atomic_load_n(&open_errno_, __ATOMIC_RELAXED);
+                if (mode == PerfUnavailable && open_errno)
+                {
+                    status.set_param(path + "error", std::string(strerror(open_errno)));
+                }
+
+                std::lock_guard<std::mutex> lock(stages_mutex_);
+                for (uint32_t stage = 0; stage < num_stages_; stage++)
+                {
+                    std::string stage_path = path + stages_[stage].name + "/";
+                    uint64_t count = __atomic_load_n(&stages_[stage].count, __ATOMIC_RELAXED);
+                    uint64_t totals[PERF_NUM_COUNTERS];
+                    for (uint32_t i = 0; i < PERF_NUM_COUNTERS; i++)
+                    {
+                        totals[i] = __atomic_load_n(&stages_[stage].totals[i], __ATOMIC_RELAXED);
+                    }
+
+                    status.set_param(stage_path + "count", count);
+                    if (mode == PerfHardware)
+                    {
+                        status.set_param(stage_path + "cycles", totals[0]);
+                        status.set_param(stage_path + "instructions", totals[1]);
+                        status.set_param(stage_path + "cache_misses", totals[2]);
+                        status.set_param(stage_path + "branch_misses", totals[3]);
+                        status.set_param(stage_path + "ipc",
+                            totals[0] ? static_cast<double>(totals[1]) / totals[0] : 0.0);
+                        status.set_param(stage_path + "cache_mpki",
+                            totals[1] ? 1000.0 * totals[2] / totals[1] : 0.0);
+                        status.set_param(stage_path + "branch_mpki",
+                            totals[1] ? 1000.0 * totals[3] / totals[1] : 0.0);
+                        status.set_param(stage_path + "cycles_per_frame",
+                            count ? static_cast<double>(totals[0]) / count : 0.0);
+                    }
+                    else if (mode == PerfSoftware)
+                    {
+                        status.set_param(stage_path + "task_clock_ns", totals[0]);
+                        status.set_param(stage_path + "page_faults", totals[1]);
+                        status.set_param(stage_path + "context_switches", totals[2]);
+                        status.set_param(stage_path + "cpu_migrations", totals[3]);
+                        status.set_param(stage_path + "task_clock_us_per_frame",
+                            count ? totals[0] / 1000.0 / count : 0.0);
+                        status.set_param(stage_path + "page_faults_per_frame",
+                            count ? static_cast<double>(totals[1]) / count : 0.0);
+                    }
+                }
+            }
+
+        private:
+            typedef struct
+            {
+                const char* name;
+                uint64_t count;
+                uint64_t totals[PERF_NUM_COUNTERS];
+            } PerfStage;
+
+            // Find the index of a stage by name, adding it on first use. Stage names must be
+            // string literals, so they are matched by pointer before comparing the strings.
+            uint32_t findStage(const char* name)
+            {
+                uint32_t num_stages = __atomic_load_n(&num_stages_, __ATOMIC_ACQUIRE);
+                for (uint32_t stage = 0; stage < num_stages; stage++)
+                {
+                    if (stages_[stage].name == name)
+                    {
+                        return stage;
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(stages_mutex_);
+                for (uint32_t stage = 0; stage < num_stages_; stage++)
+                {
+                    if (strcmp(stages_[stage].name, name) == 0)
+                    {
+                        return stage;
+                    }
+                }
+                if (num_stages_ >= PERF_MAX_STAGES)
+                {
+                    return PERF_MAX_STAGES;
+                }
+                stages_[num_stages_].name = name;
+                __atomic_store_n(&num_stages_, num_stages_ + 1, __ATOMIC_RELEASE);
+                return num_stages_ - 1;
+            }
+
+            bool enabled_;
+            int mode_;
+            int open_errno_;
+            mutable std::mutex stages_mutex_;
+            uint32_t num_stages_;
+            PerfStage stages_[PERF_MAX_STAGES];
+    };
+
+    // Scoped stage, whose counters are recorded when it goes out of scope if profiling was
+    // enabled and the counters could be read when it started
+    class PerfStageSpan
+    {
+        public:
+            PerfStageSpan(PerfCounters& perf, const char* name) :
+                perf_(perf),
+                name_(name),
+                counters_(0)
+            {
+                if (perf.enabled())
+                {
+                    PerfThreadCounters& counters = perf.threadCounters();
+                    if (counters.readValues(start_))
+                    {
+                        counters_ = &counters;
+                    }
+                }
+            }
+
+            ~PerfStageSpan()
+            {
+                end();
+            }
+
+            // End the stage before it goes out of scope
+            void end(void)
+            {
+                uint64_t end_values[PERF_NUM_VALUES];
+                if (counters_ && counters_->readValues(end_values))
+                {
+                    perf_.record(name_, start_, end_values);
+                }
+                counters_ = 0;
+            }
+
+        private:
+            PerfCounters& perf_;
+            const char* name_;
+            PerfThreadCounters* counters_;
+            uint64_t start_[PERF_NUM_VALUES];
+    };
+}
+
+#endif /*INCLUDE_INAIRAPERFCOUNTERS_H_*/
@@ -0,0 +1,210 @@
+#ifndef INCLUDE_INAIRASTARTUPTIMER_H_
+#define INCLUDE_INAIRASTARTUPTIMER_H_
+
+#include <stdint.h>
+
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "IpcMessage.h"
+#include "InairaDefinitions.h"
+
+namespace Inaira
+{
+    // Timing report of the phases of bringing up the camera controller or the ML model, so that
+    // slow startups can be broken down and the phases worth optimising identified.
+    //
+    // Each phase is timed by a StartupPhase on the thread running it and recorded with its start
+    // time relative to the first phase and its duration. A phase recorded again under the same
+    // name, e.g. a model loaded twice during configuration, replaces the earlier timing. Once the
+    // owner marks startup complete, later phases are ignored so that reconnecting or reloading
+    // during operation does not change the report.
+
+    class StartupTimer
+    {
+        public:
+            StartupTimer() :
+                first_start_ns_(0),
+                complete_ns_(0),
+                complete_(false)
+            {
+            }
+
+            /**
+             * Record the timing of a startup phase.
+             *
+             * \param[in] name - name of the phase
+             * \param[in] start_ns - monotonic clock at the start of the phase
+             * \param[in] end_ns - monotonic clock at the end of the phase
+             */
+            void record(const std::string& name, uint64_t start_ns, uint64_t end_ns)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (complete_)
+                {
+                    return;
+                }
+                if (phases_.empty() || start_ns < first_start_ns_)
+                {
+                    first_start_ns_ = start_ns;
+                }
+
+                StartupPhaseTiming timing = {name, start_ns, end_ns - start_ns};
+                for (std::size_t index = 0; index < phases_.size(); index++)
+                {
+                    if (phases_[index].name == name)
+                    {
+                        phases_[index] = timing;
+                        return;
+                    }
+                }
+                phases_.push_back(timing);
+            }
+
+            // Mark startup as complete, fixing the elapsed time and ignoring any later phases
+            void complete(void)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!complete_)
+                {
+                    complete_ns_ = monotonic_clock_ns();
+                    complete_ = true;
+                }
+            }
+
+            bool isComplete(void) const
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return complete_;
+            }
+
+            // Format the phases as a single line for logging, e.g.
+            // "camera_open 812.3ms, arm 95.1ms, total 907.4ms, elapsed 910.2ms"
+            std::string report(void) const
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::ostringstream report;
+                report << std::fixed << std::setprecision(1);
+                for (std::size_t index = 0; index < phases_.size(); index++)
+                {
+                    report << phases_[index].name << " "
+                        << toMs(phases_[index].duration_ns) << "ms, ";
+                }
+                report << "total " << toMs(totalNs()) << "ms, elapsed " << toMs(elapsedNs())
+                    << "ms";
+                return report.str();
+            }
+
+            /**
+             * Add the startup report to a status message. Each phase reports its start relative
+             * to the first phase and its duration in milliseconds. The total is the sum of the
+             * phase durations and the elapsed time runs from the start of the first phase to
+             * completion, or to now if startup is still in progress.
+             *
+             * \param[in] status - status message to add the report to
+             * \param[in] path - parameter path prefix of the report, ending in a separator
+             */
+            void status(OdinData::IpcMessage& status, const std::string& path) const
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                status.set_param(path + "complete", complete_);
+                status.set_param(path + "total_ms", toMs(totalNs()));
+                status.set_param(path + "elapsed_ms", toMs(elapsedNs()));
+                for (std::size_t index = 0; index < phases_.size(); index++)
+                {
+                    std::string phase_path = path + "phases/" + phases_[index].name + "/";
+                    status.set_param(phase_path + "start_ms",
+                        toMs(phases_[index].start_ns - first_start_ns_));
+                    status.set_param(phase_path + "duration_ms", toMs(phases_[index].duration_ns));
+                }
+            }
+
+        private:
+            typedef struct
+            {
+                std::string name;
+                uint64_t start_ns;
+                uint64_t duration_ns;
+            } StartupPhaseTiming;
+
+            static double toMs(uint64_t ns)
+            {
+                return static_cast<double>(ns) / 1000000.0;
+            }
+
+            // Sum of the phase durations, called with the mutex held
+            uint64_t totalNs(void) const
+            {
+                uint64_t total_ns = 0;
+                for (std::size_t index = 0; index < phases_.size(); index++)
+                {
+                    total_ns += phases_[index].duration_ns;
+                }
+                return total_ns;
+            }
+
+            // Time from the start of the first phase to completion, called with the mutex held
+            uint64_t elapsedNs(void) const
+            {
+                if (phases_.empty())
+                {
+                    return 0;
+                }
+                return (complete_ ? complete_ns_ : monotonic_clock_ns()) - first_start_ns_;
+            }
+
+            uint64_t first_start_ns_;
+            uint64_t complete_ns_;
+            bool complete_;
+            std::vector<StartupPhaseTiming> phases_;
+            mutable std::mutex mutex_;
+    };
+
+    // Times a startup phase from construction until end(), next() or destruction, so that a phase
+    // left early on an error path is still recorded up to the failure.
+    class StartupPhase
+    {
+        public:
+            StartupPhase(StartupTimer& timer, const std::string& name) :
+                timer_(timer),
+                name_(name),
+                start_ns_(monotonic_clock_ns()),
+                active_(true)
+            {
+            }
+
+            ~StartupPhase()
+            {
+                end();
+            }
+
+            // End the current phase and start timing the next one
+            void next(const std::string& name)
+            {
+                end();
+                name_ = name;
+                start_ns_ = monotonic_clock_ns();
+                active_ = true;
+            }
+
+            void end(void)
+            {
+                if (active_)
+                {
+                    timer_.record(name_, start_ns_, monotonic_clock_ns());
+                    active_ = false;
+                }
+            }
+
+        private:
+            StartupTimer& timer_;
+            std::string name_;
+            uint64_t start_ns_;
+            bool active_;
+    };
+}
+
+#endif /*INCLUDE_INAIRASTARTUPTIMER_H_*/
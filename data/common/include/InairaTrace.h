@@ -0,0 +1,209 @@
+#ifndef INCLUDE_INAIRATRACE_H_
+#define INCLUDE_INAIRATRACE_H_
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "InairaDefinitions.h"
+
+namespace Inaira
+{
+    // Opt-in tracing of per-frame processing spans, dumped as Chrome trace event JSON that can be
+    // opened in Perfetto or chrome://tracing.
+    //
+    // Each thread records spans into its own fixed size ring, written only by that thread, so
+    // recording takes no lock and the memory used is bounded; the oldest spans are overwritten
+    // when a ring is full. When tracing is disabled, a span costs one relaxed load and a branch.
+    // Span times are on the monotonic clock, so traces dumped by the receiver and the processor
+    // plugins line up and can be merged into one timeline.
+
+    const uint32_t TRACE_RING_EVENTS = 16384;
+
+    typedef struct
+    {
+        const char* name;                   // Span name, must be a string literal
+        uint64_t start_ns;                  // Monotonic clock at the start of the span
+        uint64_t duration_ns;               // Duration of the span
+        uint64_t frame_number;              // Frame the span belongs to
+    } TraceEvent;
+
+    typedef struct
+    {
+        uint32_t tid;                       // Kernel thread ID of the writing thread
+        uint64_t write_count;               // Number of events ever written to the ring
+        std::vector<TraceEvent> events;     // Ring of TRACE_RING_EVENTS events
+    } TraceRing;
+
+    class Tracer
+    {
+        public:
+            Tracer() :
+                enabled_(false)
+            {
+                static uint64_t next_id = 1;
+                id_ = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+            }
+
+            ~Tracer()
+            {
+                for (std::size_t i = 0; i < rings_.size(); i++)
+                {
+                    delete rings_[i];
+                }
+            }
+
+            void enable(bool enable)
+            {
+                __atomic_store_n(&enabled_, enable, __ATOMIC_RELAXED);
+            }
+
+            bool enabled(void) const
+            {
+                return __atomic_load_n(&enabled_, __ATOMIC_RELAXED);
+            }
+
+            // Record a completed span in the ring of the calling thread
+            void record(const char* name, uint64_t start_ns, uint64_t end_ns,
+                uint64_t frame_number)
+            {
+                TraceRing* ring = threadRing();
+                uint64_t count = ring->write_count;
+                TraceEvent& event = ring->events[count % TRACE_RING_EVENTS];
+                event.name = name;
+                event.start_ns = start_ns;
+                event.duration_ns = end_ns - start_ns;
+                event.frame_number = frame_number;
+                __atomic_store_n(&ring->write_count, count + 1, __ATOMIC_RELEASE);
+            }
+
+            // Write the spans in all rings to a Chrome trace event JSON file, naming the threads
+            // that recorded them. Spans that may have been overwritten while they were copied are
+            // dropped.
+            bool dump(const std::string& path, const std::string& name, std::size_t& num_events)
+            {
+                std::ofstream trace_stream(path.c_str(), std::ios::trunc);
+                trace_stream << std::fixed << std::setprecision(3);
+                trace_stream << "{\"traceEvents\":[";
+
+                num_events = 0;
+                std::lock_guard<std::mutex> lock(rings_mutex_);
+                std::vector<TraceEvent> events;
+                for (std::size_t i = 0; i < rings_.size(); i++)
+                {
+                    TraceRing* ring = rings_[i];
+                    trace_stream << (i ? ",\n" : "\n")
+                        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << getpid()
+                        << ",\"tid\":" << ring->tid << ",\"args\":{\"name\":\"" << name << "\"}}";
+
+                    uint64_t end = __atomic_load_n(&ring->write_count, __ATOMIC_ACQUIRE);
+                    uint64_t start = (end > TRACE_RING_EVENTS) ? end - TRACE_RING_EVENTS : 0;
+                    events.assign(ring->events.begin(), ring->events.end());
+                    // Slots of events written during the copy, including one in progress, are
+                    // no longer valid
+                    uint64_t written = __atomic_load_n(&ring->write_count, __ATOMIC_ACQUIRE);
+                    if (written + 1 > start + TRACE_RING_EVENTS)
+                    {
+                        start = written + 1 - TRACE_RING_EVENTS;
+                    }
+
+                    for (uint64_t idx = start; idx < end; idx++)
+                    {
+                        const TraceEvent& event = events[idx % TRACE_RING_EVENTS];
+                        trace_stream << ",\n{\"name\":\"" << event.name
+                            << "\",\"ph\":\"X\",\"pid\":" << getpid() << ",\"tid\":" << ring->tid
+                            << ",\"ts\":" << event.start_ns / 1000.0
+                            << ",\"dur\":" << event.duration_ns / 1000.0
+                            << ",\"args\":{\"frame\":" << event.frame_number << "}}";
+                        num_events++;
+                    }
+                }
+
+                trace_stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+                return static_cast<bool>(trace_stream);
+            }
+
+        private:
+            // Find the ring of the calling thread, creating it on first use. The last ring used
+            // by each thread is cached by tracer ID, so the lock is only taken when a thread
+            // records into a different tracer.
+            TraceRing* threadRing(void)
+            {
+                static thread_local uint64_t cached_id = 0;
+                static thread_local TraceRing* cached_ring = 0;
+                if (cached_id == id_)
+                {
+                    return cached_ring;
+                }
+
+                uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+                std::lock_guard<std::mutex> lock(rings_mutex_);
+                TraceRing* ring = 0;
+                for (std::size_t i = 0; i < rings_.size() && !ring; i++)
+                {
+                    if (rings_[i]->tid == tid)
+                    {
+                        ring = rings_[i];
+                    }
+                }
+                if (!ring)
+                {
+                    ring = new TraceRing;
+                    ring->tid = tid;
+                    ring->write_count = 0;
+                    ring->events.resize(TRACE_RING_EVENTS);
+                    rings_.push_back(ring);
+                }
+                cached_id = id_;
+                cached_ring = ring;
+                return ring;
+            }
+
+            uint64_t id_;
+            bool enabled_;
+            std::mutex rings_mutex_;
+            std::vector<TraceRing*> rings_;
+    };
+
+    // Scoped span, recorded when it goes out of scope if tracing was enabled when it started
+    class TraceSpan
+    {
+        public:
+            TraceSpan(Tracer& tracer, const char* name, uint64_t frame_number) :
+                tracer_(tracer),
+                name_(name),
+                frame_number_(frame_number),
+                start_ns_(tracer.enabled() ? monotonic_clock_ns() : 0)
+            {
+            }
+
+            ~TraceSpan()
+            {
+                end();
+            }
+
+            // End the span before it goes out of scope
+            void end(void)
+            {
+                if (start_ns_)
+                {
+                    tracer_.record(name_, start_ns_, monotonic_clock_ns(), frame_number_);
+                    start_ns_ = 0;
+                }
+            }
+
+        private:
+            Tracer& tracer_;
+            const char* name_;
+            uint64_t frame_number_;
+            uint64_t start_ns_;
+    };
+}
+
+#endif /*INCLUDE_INAIRATRACE_H_*/
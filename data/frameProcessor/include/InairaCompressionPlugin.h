@@ -0,0 +1,90 @@
+
+#ifndef INCLUDE_InairaCOMPRESSIONPLUGIN_H_
+#define INCLUDE_InairaCOMPRESSIONPLUGIN_H_
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "InairaProcessorPlugin.h"
+
+namespace FrameProcessor
+{
+    /*
+    Compresses frames with Blosc on a pool of worker threads, so that the HDF writer only has to
+    perform direct chunk writes. Frames are pushed downstream in the order they were received,
+    whichever worker completes them first.
+    */
+    class InairaCompressionPlugin : public InairaProcessorPlugin
+    {
+        public:
+            InairaCompressionPlugin();
+            virtual ~InairaCompressionPlugin();
+
+            void configure(OdinData::IpcMessage& config, OdinData::IpcMessage& reply);
+            void requestConfiguration(OdinData::IpcMessage& reply);
+            void status(OdinData::IpcMessage& status);
+            bool reset_statistics(void);
+
+        protected:
+            void process_end_of_acquisition(void);
+
+        private:
+            struct CompressionJob
+            {
+                uint64_t sequence;
+                boost::shared_ptr<Frame> frame;
+            };
+
+            void process_frame(boost::shared_ptr<Frame> frame);
+            void startWorkers(void);
+            void stopWorkers(void);
+            void workerLoop(void);
+            boost::shared_ptr<Frame> compressFrame(boost::shared_ptr<Frame> frame);
+            void emitFrame(uint64_t sequence, boost::shared_ptr<Frame> frame);
+            void waitForPending(void);
+
+            static const std::string CONFIG_COMPRESSOR;
+            static const std::string CONFIG_LEVEL;
+            static const std::string CONFIG_SHUFFLE;
+            static const std::string CONFIG_THREADS;
+            static const std::string CONFIG_MAX_PENDING;
+
+            std::string compressor_;
+            uint32_t level_;
+            std::string shuffle_;
+            uint32_t threads_;
+            uint32_t max_pending_;
+
+            std::vector<boost::shared_ptr<boost::thread> > workers_;
+            boost::mutex queue_mutex_;
+            boost::condition_variable work_cond_;
+            boost::condition_variable space_cond_;
+            std::deque<CompressionJob> queue_;
+            bool stop_workers_;
+            uint32_t pending_;
+            uint64_t next_sequence_;
+
+            boost::mutex emit_mutex_;
+            std::map<uint64_t, boost::shared_ptr<Frame> > completed_;
+            uint64_t next_emit_;
+
+            // Updated by the workers with atomic operations and published without a lock
+            uint64_t frames_compressed_;
+            uint64_t frames_failed_;
+            uint64_t bytes_in_;
+            uint64_t bytes_out_;
+            uint32_t max_reorder_depth_;
+    };
+
+    /**
+     * Registration of this plugin through the ClassLoader.  This macro
+     * registers the class without needing to worry about name mangling
+     */
+    REGISTER(FrameProcessorPlugin, InairaCompressionPlugin, "InairaCompressionPlugin");
+}
+
+#endif /*INCLUDE_InairaCOMPRESSIONPLUGIN_H_*/
@@ -0,0 +1,32 @@
+
+#ifndef INCLUDE_InairaFOCUSMETRIC_H_
+#define INCLUDE_InairaFOCUSMETRIC_H_
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace FrameProcessor
+{
+    /*
+    Sharpness metric of a uint16 image, calculated as the variance of the 4-neighbour Laplacian over
+    every row_step-th row. Blurred or defocused images have little high frequency content and so a
+    low variance. The Laplacian of each row is vectorised with AVX2 where the CPU supports it.
+    */
+    class InairaFocusMetric
+    {
+        public:
+            InairaFocusMetric();
+            virtual ~InairaFocusMetric();
+
+            bool configure(uint32_t row_step);
+            double calculate(const uint16_t* data, uint32_t width, uint32_t height) const;
+            bool useSimd(bool enable);
+
+            uint32_t row_step;
+
+        private:
+            bool use_avx2_;
+    };
+}
+
+#endif /*INCLUDE_InairaFOCUSMETRIC_H_*/
@@ -0,0 +1,45 @@
+
+#ifndef INCLUDE_InairaFRAMEACCUMULATOR_H_
+#define INCLUDE_InairaFRAMEACCUMULATOR_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace FrameProcessor
+{
+    /*
+    Temporal accumulation of uint16 images into a uint32 sum, vectorised with AVX2 where the CPU
+    supports it. The number of frames accumulated is limited so that the sum cannot overflow. The
+    result is read out either as the exact uint32 sum or as the rounded uint16 mean.
+    */
+    class InairaFrameAccumulator
+    {
+        public:
+            InairaFrameAccumulator();
+            virtual ~InairaFrameAccumulator();
+
+            bool configure(uint32_t frames, const std::string& mode);
+            bool enabled(void) const;
+            bool outputSum(void) const;
+            std::size_t outputPixelSize(void) const;
+
+            void reset(std::size_t num_pixels);
+            void add(const uint16_t* data);
+            bool complete(void) const;
+            void read(void* output) const;
+            bool useSimd(bool enable);
+
+            uint32_t frames;
+            std::string mode;
+            uint32_t frames_accumulated;
+            std::size_t num_pixels;
+
+        private:
+            std::vector<uint32_t> sum_;
+            bool output_sum_;
+            bool use_avx2_;
+    };
+}
+
+#endif /*INCLUDE_InairaFRAMEACCUMULATOR_H_*/
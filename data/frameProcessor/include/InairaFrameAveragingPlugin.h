@@ -0,0 +1,59 @@
+
+#ifndef INCLUDE_InairaFRAMEAVERAGINGPLUGIN_H_
+#define INCLUDE_InairaFRAMEAVERAGINGPLUGIN_H_
+
+#include <boost/thread/mutex.hpp>
+
+#include "InairaProcessorPlugin.h"
+#include "InairaFrameAccumulator.h"
+
+namespace FrameProcessor
+{
+    /*
+    Sums or averages each group of consecutive uint16 frames into a single output frame, improving
+    the signal to noise ratio in low light and reducing the data rate by the group size. Input
+    frames are released as soon as they are accumulated. Frames of any other type are passed on.
+    */
+    class InairaFrameAveragingPlugin : public InairaProcessorPlugin
+    {
+        public:
+            InairaFrameAveragingPlugin();
+            virtual ~InairaFrameAveragingPlugin();
+
+            void configure(OdinData::IpcMessage& config, OdinData::IpcMessage& reply);
+            void requestConfiguration(OdinData::IpcMessage& reply);
+            void status(OdinData::IpcMessage& status);
+            bool reset_statistics(void);
+
+        protected:
+            void process_end_of_acquisition(void);
+
+        private:
+            void process_frame(boost::shared_ptr<Frame> frame);
+            void startGroup(boost::shared_ptr<Frame> frame, uint64_t group);
+            void emitGroup(void);
+            void discardGroup(void);
+
+            static const std::string CONFIG_FRAMES;
+            static const std::string CONFIG_MODE;
+
+            InairaFrameAccumulator accumulator_;  //!< Frame sums for the current group
+            boost::mutex accumulator_mutex_;      //!< Protects the accumulator and group state
+            bool group_active_;                   //!< True while a group is being accumulated
+            uint64_t group_;                      //!< Index of the group, frame number / frames
+            FrameMetaData group_metadata_;        //!< Metadata of the first frame in the group
+
+            uint64_t frames_accumulated_;         //!< Number of input frames accumulated
+            uint64_t frames_emitted_;             //!< Number of output frames pushed
+            uint64_t frames_passed_;              //!< Number of frames passed on unchanged
+            uint64_t groups_discarded_;           //!< Number of incomplete groups discarded
+    };
+
+    /**
+     * Registration of this plugin through the ClassLoader.  This macro
+     * registers the class without needing to worry about name mangling
+     */
+    REGISTER(FrameProcessorPlugin, InairaFrameAveragingPlugin, "InairaFrameAveragingPlugin");
+}
+
+#endif /*INCLUDE_InairaFRAMEAVERAGINGPLUGIN_H_*/
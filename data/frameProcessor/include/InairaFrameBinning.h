@@ -0,0 +1,42 @@
+
+#ifndef INCLUDE_InairaFRAMEBINNING_H_
+#define INCLUDE_InairaFRAMEBINNING_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace FrameProcessor
+{
+    /*
+    In-place pixel binning of a uint16 image by a factor of 2 or 4 in each dimension. Binned pixels
+    are the sum, clamped to the uint16 range, or the rounded mean of the pixels in each bin. A bin
+    containing a saturated pixel is output as saturated so that saturation survives the binning.
+    The binned image is written from the start of the input image, which it never overtakes.
+    */
+    class InairaFrameBinning
+    {
+        public:
+            InairaFrameBinning();
+            virtual ~InairaFrameBinning();
+
+            bool configure(uint32_t factor, const std::string& mode, uint32_t saturation_level);
+            bool enabled(void) const;
+            void bin(uint16_t* data, uint32_t width, uint32_t height,
+                     uint32_t& binned_width, uint32_t& binned_height);
+
+            uint32_t factor;
+            std::string mode;
+            uint32_t saturation_level;
+
+        private:
+            template <uint32_t Factor>
+            void sumRow(const uint16_t* row, uint32_t binned_width);
+
+            bool mean_;
+            std::vector<uint32_t> bin_sum_;
+            std::vector<uint16_t> bin_max_;
+    };
+}
+
+#endif /*INCLUDE_InairaFRAMEBINNING_H_*/
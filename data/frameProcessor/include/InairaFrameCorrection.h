@@ -0,0 +1,88 @@
+
+#ifndef INCLUDE_InairaFRAMECORRECTION_H_
+#define INCLUDE_InairaFRAMECORRECTION_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <log4cxx/logger.h>
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+
+namespace FrameProcessor
+{
+    /*
+    Flat-field, dark-frame and defective pixel correction of uint16 images. Each pixel is corrected
+    in place as (raw - dark) * gain, vectorised with AVX2 where the CPU supports it, and pixels in
+    the bad pixel list are then replaced by the mean of their good neighbours. The dark and gain
+    maps are raw float32 files of one value per pixel, and can be captured by averaging live frames.
+    */
+    class InairaFrameCorrection
+    {
+        public:
+            enum CaptureType
+            {
+                CaptureNone,
+                CaptureDark,
+                CaptureFlat
+            };
+
+            InairaFrameCorrection();
+            virtual ~InairaFrameCorrection();
+
+            bool loadDarkMap(const std::string& path);
+            bool loadGainMap(const std::string& path);
+            bool loadBadPixels(const std::string& path);
+            bool enabled(void) const;
+            bool apply(uint16_t* data, uint32_t width, uint32_t height);
+            bool useSimd(bool enable);
+
+            bool startCapture(CaptureType type, uint32_t frames);
+            bool capturing(void) const;
+            void capture(const uint16_t* data, uint32_t width, uint32_t height);
+            std::string captureName(void) const;
+
+            std::string dark_map_file;
+            std::string gain_map_file;
+            std::string bad_pixel_file;
+
+            std::size_t dark_map_pixels;
+            std::size_t gain_map_pixels;
+            std::size_t bad_pixels;
+            uint32_t capture_frames_remaining;
+            uint64_t frames_corrected;
+            uint64_t frames_mismatched;
+
+        private:
+            struct BadPixel
+            {
+                std::size_t index;
+                std::vector<std::size_t> neighbours;
+            };
+
+            bool loadMap(const std::string& path, std::vector<float>& map);
+            bool saveMap(const std::string& path, const std::vector<float>& map);
+            void finishCapture(void);
+            void buildBadPixels(uint32_t width, uint32_t height);
+            void correctPixels(uint16_t* data, std::size_t num_pixels);
+
+            std::vector<float> dark_map_;
+            std::vector<float> gain_map_;
+            std::vector<std::pair<uint32_t, uint32_t> > bad_pixel_list_;
+            std::vector<BadPixel> bad_pixel_map_;
+            uint32_t bad_pixel_width_;
+            uint32_t bad_pixel_height_;
+
+            CaptureType capture_type_;
+            uint32_t capture_frames_;
+            uint32_t capture_width_;
+            uint32_t capture_height_;
+            std::vector<uint32_t> capture_sum_;
+
+            bool use_avx2_;
+            LoggerPtr logger_;
+    };
+}
+
+#endif /*INCLUDE_InairaFRAMECORRECTION_H_*/
@@ -0,0 +1,54 @@
+
+#ifndef INCLUDE_InairaFRAMEHISTORY_H_
+#define INCLUDE_InairaFRAMEHISTORY_H_
+
+#include <deque>
+#include <vector>
+
+#include <log4cxx/logger.h>
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+
+#include <boost/shared_ptr.hpp>
+#include "Frame.h"
+
+namespace FrameProcessor
+{
+    /*
+    Ring of recent frames that were not forwarded for storage, held so that they can be written as
+    context around a defective frame. Frames are held by reference, or as compact copies when the
+    shared memory buffers must be returned to the frame receiver.
+    */
+    class InairaFrameHistory
+    {
+        public:
+            InairaFrameHistory();
+            virtual ~InairaFrameHistory();
+
+            void configure(uint32_t pre_frames, uint32_t post_frames, std::size_t max_bytes, bool copy_frames);
+            bool enabled(void) const;
+            void store(boost::shared_ptr<Frame> frame);
+            std::vector<boost::shared_ptr<Frame> > trigger(void);
+            bool postTriggerFrame(void);
+            void clear(void);
+            void resetStatistics(void);
+
+            uint32_t pre_frames;
+            uint32_t post_frames;
+            std::size_t max_bytes;
+            bool copy_frames;
+
+            uint32_t frames_held;
+            std::size_t bytes_held;
+            uint32_t frames_flushed;
+            uint32_t frames_evicted;
+            uint32_t triggers;
+
+        private:
+            std::deque<boost::shared_ptr<Frame> > frames_;
+            uint32_t post_remaining_;
+            LoggerPtr logger_;
+    };
+}
+
+#endif /*INCLUDE_InairaFRAMEHISTORY_H_*/
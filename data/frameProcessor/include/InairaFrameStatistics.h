@@ -0,0 +1,49 @@
+
+#ifndef INCLUDE_InairaFRAMESTATISTICS_H_
+#define INCLUDE_InairaFRAMESTATISTICS_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace FrameProcessor
+{
+    /*
+    Single-pass statistics over a uint16 image: minimum, maximum, mean, standard deviation, a coarse
+    histogram and a count of saturated pixels. The image is processed in cache-sized blocks, with
+    the moments and saturation count vectorised with AVX2 where the CPU supports it and the
+    histogram filled from the same block while it is still in L1 cache.
+    */
+    class InairaFrameStatistics
+    {
+        public:
+            InairaFrameStatistics();
+            virtual ~InairaFrameStatistics();
+
+            bool configure(uint32_t histogram_bins, uint32_t pixel_bits, uint32_t saturation_level);
+            void calculate(const uint16_t* data, std::size_t num_pixels);
+            bool useSimd(bool enable);
+
+            uint32_t histogram_bins;
+            uint32_t pixel_bits;
+            uint32_t saturation_level;
+
+            uint32_t min;
+            uint32_t max;
+            double mean;
+            double std_dev;
+            uint64_t saturated;
+            std::vector<uint32_t> histogram;
+
+        private:
+            void calculateBlock(const uint16_t* data, std::size_t num_pixels,
+                                uint64_t& sum, uint64_t& sum_sq);
+            void fillHistogram(const uint16_t* data, std::size_t num_pixels);
+
+            bool use_avx2_;
+            uint32_t histogram_shift_;
+            std::vector<uint32_t> sub_histograms_;
+    };
+}
+
+#endif /*INCLUDE_InairaFRAMESTATISTICS_H_*/
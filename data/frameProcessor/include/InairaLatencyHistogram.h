@@ -0,0 +1,150 @@
+
+#ifndef INCLUDE_InairaLATENCYHISTOGRAM_H_
+#define INCLUDE_InairaLATENCYHISTOGRAM_H_
+
+#include <stdint.h>
+#include <string>
+
+#include "IpcMessage.h"
+#include "InairaMetricsPage.h"
+
+namespace FrameProcessor
+{
+    /*
+    Histogram of latencies between two monotonic clock timestamps, with logarithmic bins so that
+    latencies from microseconds to seconds are resolved with a fixed, small number of bins. Bin 0
+    counts latencies under 1us, bin i latencies from 2^(i-1) to 2^i us and the last bin all
+    longer latencies. Recording a latency is a few instructions, so it can be done on every frame.
+    */
+    class InairaLatencyHistogram
+    {
+        public:
+            static const uint32_t NUM_BINS = 24;
+
+            InairaLatencyHistogram()
+            {
+                reset();
+            }
+
+            void reset(void)
+            {
+                count = 0;
+                invalid = 0;
+                min_ns = 0;
+                max_ns = 0;
+                sum_ns = 0;
+                for (uint32_t bin = 0; bin < NUM_BINS; bin++)
+                {
+                    bins_[bin] = 0;
+                }
+            }
+
+            /**
+             * Record the latency between two timestamps. Missing or reversed timestamps are
+             * counted as invalid rather than recorded.
+             *
+             * \param[in] start_ns - monotonic clock at the start of the interval, 0 if unknown
+             * \param[in] end_ns - monotonic clock at the end of the interval
+             */
+            void record(uint64_t start_ns, uint64_t end_ns)
+            {
+                if (start_ns == 0 || end_ns < start_ns)
+                {
+                    invalid++;
+                    return;
+                }
+
+                uint64_t latency_ns = end_ns - start_ns;
+                uint64_t latency_us = latency_ns / 1000;
+                uint32_t bin = latency_us ? 64 - __builtin_clzll(latency_us) : 0;
+                bins_[bin < NUM_BINS ? bin : NUM_BINS - 1]++;
+
+                if (count == 0 || latency_ns < min_ns)
+                {
+                    min_ns = latency_ns;
+                }
+                if (latency_ns > max_ns)
+                {
+                    max_ns = latency_ns;
+                }
+                sum_ns += latency_ns;
+                count++;
+            }
+
+            /**
+             * Estimate a percentile of the latency as the upper bound of the bin containing it.
+             *
+             * \param[in] fraction - percentile as a fraction, e.g. 0.99
+             * \return latency in microseconds
+             */
+            uint64_t percentileUs(double fraction) const
+            {
+                uint64_t target = static_cast<uint64_t>(fraction * count);
+                uint64_t cumulative = 0;
+                for (uint32_t bin = 0; bin < NUM_BINS; bin++)
+                {
+                    cumulative += bins_[bin];
+                    if (cumulative > target)
+                    {
+                        return static_cast<uint64_t>(1) << bin;
+                    }
+                }
+                return max_ns / 1000;
+            }
+
+            /**
+             * Add the latency summary and histogram to a status message.
+             *
+             * \param[in] status - status message to populate
+             * \param[in] path - parameter path prefix for this histogram, ending in a slash
+             */
+            void status(OdinData::IpcMessage& status, const std::string& path) const
+            {
+                status.set_param(path + "count", count);
+                status.set_param(path + "invalid", invalid);
+                status.set_param(path + "min_us", min_ns / 1000.0);
+                status.set_param(path + "max_us", max_ns / 1000.0);
+                status.set_param(path + "mean_us", count ? (sum_ns / 1000.0) / count : 0.0);
+                status.set_param(path + "p50_us", percentileUs(0.5));
+                status.set_param(path + "p99_us", percentileUs(0.99));
+                for (uint32_t bin = 0; bin < NUM_BINS; bin++)
+                {
+                    status.set_param(path + "histogram[]", bins_[bin]);
+                }
+            }
+
+            /**
+             * Bind the latency summary and histogram bins to metrics in a shared memory page, so
+             * that readers of the page can calculate percentiles from a consistent snapshot.
+             *
+             * \param[in] metrics - metrics page to bind to
+             * \param[in] path - metric name prefix for this histogram, ending in a slash
+             * \return true if all the metrics were bound
+             */
+            bool bindMetrics(Inaira::MetricsPage& metrics, const std::string& path) const
+            {
+                bool bound = metrics.bind(path + "count", count, Inaira::MetricCounter);
+                bound &= metrics.bind(path + "invalid", invalid, Inaira::MetricCounter);
+                bound &= metrics.bind(path + "min_ns", min_ns, Inaira::MetricGauge);
+                bound &= metrics.bind(path + "max_ns", max_ns, Inaira::MetricGauge);
+                bound &= metrics.bind(path + "sum_ns", sum_ns, Inaira::MetricCounter);
+                for (uint32_t bin = 0; bin < NUM_BINS; bin++)
+                {
+                    bound &= metrics.bind(path + "histogram/" + std::to_string(bin), bins_[bin],
+                        Inaira::MetricCounter);
+                }
+                return bound;
+            }
+
+            uint64_t count;
+            uint64_t invalid;
+            uint64_t min_ns;
+            uint64_t max_ns;
+            uint64_t sum_ns;
+
+        private:
+            uint64_t bins_[NUM_BINS];
+    };
+}
+
+#endif /*INCLUDE_InairaLATENCYHISTOGRAM_H_*/
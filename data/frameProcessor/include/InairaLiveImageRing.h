@@ -0,0 +1,47 @@
+
+#ifndef INCLUDE_InairaLIVEIMAGERING_H_
+#define INCLUDE_InairaLIVEIMAGERING_H_
+
+#include <string>
+
+#include <log4cxx/logger.h>
+using namespace log4cxx;
+using namespace log4cxx::helpers;
+
+#include <boost/shared_ptr.hpp>
+#include "Frame.h"
+#include "InairaLiveImageRingDefinitions.h"
+
+namespace FrameProcessor
+{
+    /*
+    Writer for a POSIX shared memory ring of the latest live preview images, allowing consumers on
+    the same host to map the ring and read the newest image without any socket traffic. The layout
+    is defined in InairaLiveImageRingDefinitions.h.
+    */
+    class InairaLiveImageRing
+    {
+        public:
+            InairaLiveImageRing();
+            virtual ~InairaLiveImageRing();
+
+            bool create(const std::string& name, uint32_t num_slots, std::size_t max_image_size);
+            void destroy(void);
+            bool isOpen(void) const;
+            bool write(boost::shared_ptr<Frame> frame, uint32_t classification, float score);
+
+            std::string name;
+            uint32_t num_slots;
+            std::size_t max_image_size;
+            uint32_t images_written;
+            uint32_t images_skipped;
+
+        private:
+            uint8_t* segment_;
+            std::size_t segment_size_;
+            uint32_t slot_size_;
+            LoggerPtr logger_;
+    };
+}
+
+#endif /*INCLUDE_InairaLIVEIMAGERING_H_*/
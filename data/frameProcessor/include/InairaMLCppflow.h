@@ -17,6 +17,8 @@ using namespace log4cxx::helpers;
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 #include "Frame.h"
+#include "InairaStartupTimer.h"
+#include "InairaHotLog.h"
 
 namespace FrameProcessor
 {
@@ -36,10 +38,14 @@ namespace FrameProcessor
 
             std::string input_layer_name;
             std::string output_layer_name;
+            uint64_t parameter_bytes;
+            Inaira::StartupTimer startup;
 
         private:
             static void test_deallocator(void* buffer, std::size_t len, void* arg);
+            static uint64_t variablesSize(const std::string& model_dir);
             boost::scoped_ptr<cppflow::model> model;
+            bool warmed_up_;
             LoggerPtr logger_;
     };
 }
@@ -3,9 +3,21 @@
 #ifndef INCLUDE_InairaMLPLUGIN_H_
 #define INCLUDE_InairaMLPLUGIN_H_
 
+#include <map>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 #include "InairaProcessorPlugin.h"
 #include "DataBlockFrame.h"
 #include "InairaMLCppflow.h"
+#include "InairaFrameHistory.h"
+#include "InairaLiveImageRing.h"
+#include "InairaWindowLut.h"
+#include "InairaLatencyHistogram.h"
+#include "InairaMemoryUsage.h"
+#include "InairaHotLog.h"
+#include "InairaCrc32c.h"
 
 namespace FrameProcessor
 {
@@ -19,6 +31,10 @@ namespace FrameProcessor
             void requestConfiguration(OdinData::IpcMessage& reply);
             void status(OdinData::IpcMessage& status);
             bool reset_statistics(void);
+            void process_frame(boost::shared_ptr<Frame> frame);
+
+        protected:
+            void process_end_of_acquisition(void);
 
         private:
             /*
@@ -29,13 +45,62 @@ namespace FrameProcessor
                 void* frame_data_ptr;
                 std::string json_header;
             };
+
+            /*
+            Tracks the images published as zero-copy messages. Each one holds a reference to its
+            frame, and so to the shared memory buffer, until ZeroMQ has finished with it. Held
+            images are keyed by image id with the monotonic clock in ns when they were published
+            */
+            struct ImageReleaseTracker
+            {
+                boost::mutex mutex;
+                std::map<uint64_t, uint64_t> held_images;
+                uint32_t max_hold_time;
+            };
+
+            /*
+            Storage policy and counters for frames of one classification
+            */
+            struct StoragePolicy
+            {
+                std::string mode;
+                uint32_t rate;
+                uint64_t frames_seen;
+                uint32_t window_count;
+                uint64_t window_start;
+                uint32_t written;
+                uint32_t dropped;
+            };
+
+            /*
+            Hint passed to the ZeroMQ free callback of a zero-copy image message
+            */
+            struct ImageReleaseHint
+            {
+                boost::shared_ptr<Frame> frame;
+                boost::shared_ptr<ImageReleaseTracker> tracker;
+                uint64_t image_id;
+            };
             
-            void process_frame(boost::shared_ptr<Frame> frame);
-            void decodeHeader(boost::shared_ptr<Frame> frame);
+            bool decodeHeader(boost::shared_ptr<Frame> frame);
+            void recordLatency(boost::shared_ptr<Frame> frame, uint64_t process_start_ns);
+            void convertFrame(boost::shared_ptr<Frame> frame);
+            static std::size_t dataTypeSize(DataType data_type);
             std::string sendResults(uint32_t frame_number, uint32_t process_time, std::vector<float> results);
+            bool batchingResults(void);
+            void batchResults(const std::string& results);
+            void sendResultBatch(void);
+            void batchFlushLoop(void);
             InairaMLPlugin::LiveImageData sendImage(boost::shared_ptr<Frame> frame);
+            void publishImage(boost::shared_ptr<Frame> frame, InairaMLPlugin::LiveImageData& live_image);
+            bool canHoldImage(void);
+            bool holdLimitEnforced(void) const;
+            static void releaseImage(void* data, void* hint);
 
             void setSocketAddr(std::string value);
+            bool setStoragePolicy(StoragePolicy& policy, std::string mode);
+            bool storeFrame(StoragePolicy& policy);
+            void writeLiveRing(boost::shared_ptr<Frame> frame, uint32_t classification, float score);
 
 
             static const std::string CONFIG_MODEL_PATH;
@@ -45,20 +110,99 @@ namespace FrameProcessor
             static const std::string CONFIG_RESULT_DEST;
             static const std::string CONFIG_SEND_RESULTS;
             static const std::string CONFIG_SEND_IMAGE;
+            static const std::string CONFIG_ZERO_COPY_IMAGE;
+            static const std::string CONFIG_ZERO_COPY_MAX_FRAMES;
+            static const std::string CONFIG_ZERO_COPY_MAX_HOLD;
+            static const std::string CONFIG_RESULT_BATCH_FRAMES;
+            static const std::string CONFIG_RESULT_BATCH_TIME;
+            static const std::string CONFIG_DEFECTIVE_STORAGE;
+            static const std::string CONFIG_DEFECTIVE_STORAGE_RATE;
+            static const std::string CONFIG_GOOD_STORAGE;
+            static const std::string CONFIG_GOOD_STORAGE_RATE;
+            static const std::string CONFIG_LIVE_VIEW_PLUGIN;
+            static const std::string CONFIG_HISTORY_PRE_FRAMES;
+            static const std::string CONFIG_HISTORY_POST_FRAMES;
+            static const std::string CONFIG_HISTORY_MAX_MB;
+            static const std::string CONFIG_HISTORY_COPY_FRAMES;
+            static const std::string CONFIG_LIVE_RING_NAME;
+            static const std::string CONFIG_LIVE_RING_SLOTS;
+            static const std::string CONFIG_LIVE_RING_MAX_IMAGE_SIZE;
+            static const std::string CONFIG_LIVE_RING_FRAME_FREQUENCY;
+            static const std::string CONFIG_CONVERT_8BIT;
+            static const std::string CONFIG_WINDOW_LEVEL;
+            static const std::string CONFIG_WINDOW_WIDTH;
+            static const std::string CONFIG_WINDOW_GAMMA;
+            static const std::string CONFIG_SKIP_BLURRED;
+            static const std::string CONFIG_VERIFY_CHECKSUM;
+            static const std::string STORAGE_ALL;
+            static const std::string STORAGE_EVERY_N;
+            static const std::string STORAGE_PER_SECOND;
+            static const std::string STORAGE_NONE;
 
 
             std::string model_path;
             bool decode_header;
 
             InairaMLCppflow model_;
+            boost::mutex memory_mutex_;
+            Inaira::MemoryUsage memory_;
             std::string classes[2];
+            std::string datasets[2];
+            StoragePolicy storage_[2];
+            std::string live_view_plugin_;
+            InairaFrameHistory history_;
+
+            boost::mutex live_ring_mutex_;
+            InairaLiveImageRing live_ring_;
+            std::string live_ring_name_;
+            uint32_t live_ring_slots_;
+            uint32_t live_ring_max_image_size_;
+            uint32_t live_ring_frame_frequency_;
+            uint64_t live_ring_frame_count_;
+
+            bool convert_8bit_;
+            InairaWindowLut window_lut_;
+            uint32_t frames_converted_;
+
+            bool skip_blurred_;
+            uint32_t frames_skipped_blurred_;
+
+            uint32_t frames_invalid_header_;
+
+            bool verify_checksum_;
+            uint32_t frames_checksum_verified_;
+            uint32_t frames_checksum_mismatched_;
+
+            boost::mutex latency_mutex_;
+            InairaLatencyHistogram ready_to_process_latency_;
+            InairaLatencyHistogram process_to_result_latency_;
+            InairaLatencyHistogram total_latency_;
 
             std::string data_socket_addr_;
-            OdinData::IpcChannel publish_socket_;
+            zmq::socket_t publish_socket_;
             bool is_bound_;
             bool send_results_;
             bool send_image_;
 
+            bool zero_copy_image_;
+            uint32_t zero_copy_max_frames_;
+            uint32_t zero_copy_max_hold_;
+            uint32_t socket_hold_limit_;
+            boost::shared_ptr<ImageReleaseTracker> image_tracker_;
+            uint64_t next_image_id_;
+            uint32_t images_zero_copy_;
+            uint32_t images_copied_;
+
+            uint32_t result_batch_frames_;
+            uint32_t result_batch_time_;
+            std::vector<std::string> result_batch_;
+            uint64_t result_batch_start_;
+            uint32_t result_batches_sent_;
+            boost::mutex publish_mutex_;
+            boost::condition_variable batch_flush_cond_;
+            bool stop_batch_flush_;
+            boost::shared_ptr<boost::thread> batch_flush_thread_;
+
 
             int32_t avg_process_time;
             int32_t total_process_time;
@@ -0,0 +1,41 @@
+
+#ifndef INCLUDE_InairaPIXELPACKING_H_
+#define INCLUDE_InairaPIXELPACKING_H_
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace FrameProcessor
+{
+    /*
+    Lossless packing of uint16 pixels to their real bit depth (10, 12 or 14 bits). Pixels are packed
+    LSB first into a little-endian bit stream, so each group of four pixels fills exactly bits / 2
+    bytes. Groups are packed and unpacked with the BMI2 pext/pdep instructions where the CPU supports
+    them, and with shifts and masks otherwise. Packing may be done in place.
+    */
+    class InairaPixelPacking
+    {
+        public:
+            InairaPixelPacking();
+            virtual ~InairaPixelPacking();
+
+            bool configure(uint32_t bits);
+            bool enabled(void) const;
+            bool fits(const uint16_t* data, std::size_t num_pixels) const;
+            std::size_t pack(const uint16_t* data, uint8_t* packed, std::size_t num_pixels) const;
+            void unpack(const uint8_t* packed, uint16_t* data, std::size_t num_pixels) const;
+            bool useSimd(bool enable);
+
+            static std::size_t packedSize(std::size_t num_pixels, uint32_t bits);
+
+            uint32_t bits;
+
+        private:
+            void packTail(const uint16_t* data, uint8_t* packed, std::size_t num_pixels) const;
+            void unpackTail(const uint8_t* packed, uint16_t* data, std::size_t num_pixels) const;
+
+            bool use_bmi2_;
+    };
+}
+
+#endif /*INCLUDE_InairaPIXELPACKING_H_*/
@@ -0,0 +1,39 @@
+
+#ifndef INCLUDE_InairaPIXELVARIANCE_H_
+#define INCLUDE_InairaPIXELVARIANCE_H_
+
+#include <stdint.h>
+#include <vector>
+
+namespace FrameProcessor
+{
+    /*
+    Running per-pixel mean and variance of uint16 images. Each pixel keeps the 64-bit integer sum
+    and sum of squares of its values, vectorised with AVX2 where the CPU supports it. These are
+    exact, so the mean and variance read out at any point carry no accumulated rounding error or
+    cancellation, however many frames have been added.
+    */
+    class InairaPixelVariance
+    {
+        public:
+            InairaPixelVariance();
+            virtual ~InairaPixelVariance();
+
+            void reset(std::size_t num_pixels);
+            void clear(void);
+            bool full(void) const;
+            void add(const uint16_t* data);
+            void read(float* mean, float* variance) const;
+            bool useSimd(bool enable);
+
+            std::size_t num_pixels;
+            uint64_t frames;
+
+        private:
+            std::vector<uint64_t> sum_;
+            std::vector<uint64_t> sum_squares_;
+            bool use_avx2_;
+    };
+}
+
+#endif /*INCLUDE_InairaPIXELVARIANCE_H_*/
@@ -0,0 +1,68 @@
+
+#ifndef INCLUDE_InairaPIXELVARIANCEPLUGIN_H_
+#define INCLUDE_InairaPIXELVARIANCEPLUGIN_H_
+
+#include <boost/thread/mutex.hpp>
+
+#include "InairaProcessorPlugin.h"
+#include "InairaPixelVariance.h"
+
+namespace FrameProcessor
+{
+    /*
+    Keeps the running per-pixel mean and variance of the uint16 frames of the current acquisition,
+    passing the frames on unchanged. On command, or at the end of the acquisition, the mean and
+    variance images are written to raw float32 files and optionally pushed downstream as frames,
+    so that reference images can be produced without storing every frame.
+    */
+    class InairaPixelVariancePlugin : public InairaProcessorPlugin
+    {
+        public:
+            InairaPixelVariancePlugin();
+            virtual ~InairaPixelVariancePlugin();
+
+            void configure(OdinData::IpcMessage& config, OdinData::IpcMessage& reply);
+            void requestConfiguration(OdinData::IpcMessage& reply);
+            void status(OdinData::IpcMessage& status);
+            bool reset_statistics(void);
+
+        protected:
+            void process_end_of_acquisition(void);
+
+        private:
+            void process_frame(boost::shared_ptr<Frame> frame);
+            bool dump(void);
+            bool saveImage(const std::string& path, const std::vector<float>& image);
+            void pushImage(const std::string& dataset, const std::vector<float>& image);
+
+            static const std::string CONFIG_ENABLE;
+            static const std::string CONFIG_MEAN_FILE;
+            static const std::string CONFIG_VARIANCE_FILE;
+            static const std::string CONFIG_PUSH_IMAGES;
+            static const std::string CONFIG_DUMP_ON_END;
+            static const std::string CONFIG_DUMP;
+            static const std::string CONFIG_RESET;
+
+            bool enable_;                         //!< Enables the accumulation
+            std::string mean_file_;               //!< Raw float32 file for the mean image
+            std::string variance_file_;           //!< Raw float32 file for the variance image
+            bool push_images_;                    //!< Push the images downstream when dumped
+            bool dump_on_end_;                    //!< Dump at the end of each acquisition
+
+            InairaPixelVariance variance_;        //!< Per-pixel sums of the acquisition
+            boost::mutex variance_mutex_;         //!< Protects the sums and the image dimensions
+            dimensions_t dims_;                   //!< Image dimensions of the accumulation
+            bool reset_pending_;                  //!< Start a new accumulation on the next frame
+
+            uint64_t frames_skipped_;             //!< Number of frames not accumulated
+            uint64_t dumps_;                      //!< Number of successful dumps
+    };
+
+    /**
+     * Registration of this plugin through the ClassLoader.  This macro
+     * registers the class without needing to worry about name mangling
+     */
+    REGISTER(FrameProcessorPlugin, InairaPixelVariancePlugin, "InairaPixelVariancePlugin");
+}
+
+#endif /*INCLUDE_InairaPIXELVARIANCEPLUGIN_H_*/
@@ -16,6 +16,10 @@ using namespace log4cxx::helpers;
 #include "version.h"
 
 #include "InairaDefinitions.h"
+#include "InairaMetricsPage.h"
+#include "InairaPerfCounters.h"
+#include "InairaTrace.h"
+#include "InairaHotLog.h"
 
 namespace FrameProcessor
 {
@@ -24,7 +28,11 @@ namespace FrameProcessor
     {
         public:
             InairaProcessorPlugin(){};
-            virtual ~InairaProcessorPlugin(){};
+            virtual ~InairaProcessorPlugin()
+            {
+                // Log any hot path messages while their format literals are still loaded
+                Inaira::HotLog::instance().flush();
+            };
 
             int get_version_major() {return ODIN_DATA_VERSION_MAJOR;};
             int get_version_minor() {return ODIN_DATA_VERSION_MINOR;};
@@ -35,6 +43,91 @@ namespace FrameProcessor
         protected:
             virtual void process_frame(boost::shared_ptr<Frame> frame) = 0;
 
+            /**
+             * Handle the tracing configuration parameters common to all plugins: trace enables
+             * or disables recording of per-frame spans, and trace_dump writes the recorded spans
+             * to the given file as Chrome trace event JSON.
+             */
+            void configureTracing(OdinData::IpcMessage& config, OdinData::IpcMessage& reply)
+            {
+                if (config.has_param("trace"))
+                {
+                    tracer_.enable(config.get_param<bool>("trace"));
+                    LOG4CXX_INFO(logger_, "Tracing " << (tracer_.enabled() ? "enabled" : "disabled"));
+                }
+                if (config.has_param("trace_dump"))
+                {
+                    std::string trace_file = config.get_param<std::string>("trace_dump");
+                    std::size_t num_events = 0;
+                    if (tracer_.dump(trace_file, get_name(), num_events))
+                    {
+                        LOG4CXX_INFO(logger_, "Dumped " << num_events << " trace events to "
+                            << trace_file);
+                    }
+                    else
+                    {
+                        LOG4CXX_ERROR(logger_, "Failed to dump trace events to " << trace_file);
+                        reply.set_nack("Failed to dump trace to " + trace_file);
+                    }
+                }
+            }
+
+            /**
+             * Handle the metrics configuration parameter common to all plugins: metrics is the
+             * name of the shared memory page the plugin publishes its metrics to, or an empty
+             * string to stop publishing them.
+             */
+            void configureMetrics(OdinData::IpcMessage& config, OdinData::IpcMessage& reply)
+            {
+                if (config.has_param("metrics"))
+                {
+                    std::string metrics_name = config.get_param<std::string>("metrics");
+                    if (metrics_name.empty())
+                    {
+                        metrics_.destroy();
+                    }
+                    else if (metrics_.create(metrics_name))
+                    {
+                        LOG4CXX_INFO(logger_, "Publishing metrics to shared memory " << metrics_.name);
+                        if (metrics_.droppedBindings() > 0)
+                        {
+                            LOG4CXX_ERROR(logger_, metrics_.droppedBindings()
+                                << " metrics did not fit in the metrics page and are not published");
+                        }
+                    }
+                    else
+                    {
+                        LOG4CXX_ERROR(logger_, "Failed to create metrics page " << metrics_name
+                            << ": " << strerror(errno));
+                        reply.set_nack("Failed to create metrics page " + metrics_name);
+                    }
+                }
+            }
+
+            /**
+             * Handle the performance counter configuration parameter common to all plugins:
+             * perf_counters enables or disables reading per-thread perf_event counters around the
+             * hot stages of the plugin, resetting the totals reported in status when enabled.
+             */
+            void configurePerfCounters(OdinData::IpcMessage& config, OdinData::IpcMessage& reply)
+            {
+                if (config.has_param("perf_counters"))
+                {
+                    perf_.enable(config.get_param<bool>("perf_counters"));
+                    LOG4CXX_INFO(logger_, "Performance counters "
+                        << (perf_.enabled() ? "enabled" : "disabled"));
+                }
+            }
+
+            /** Per-stage performance counter totals **/
+            Inaira::PerfCounters perf_;
+
+            /** Shared memory page of metrics, published by each plugin after processing a frame **/
+            Inaira::MetricsPage metrics_;
+
+            /** Tracer for per-frame spans **/
+            Inaira::Tracer tracer_;
+
             /** Pointer to logger **/
             LoggerPtr logger_;
     };
@@ -0,0 +1,37 @@
+
+#ifndef INCLUDE_InairaWINDOWLUT_H_
+#define INCLUDE_InairaWINDOWLUT_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace FrameProcessor
+{
+    /*
+    Conversion of uint16 images to uint8 through a precomputed 64K entry lookup table, mapping a
+    window of width pixel values centred on level to the full uint8 range with an optional gamma.
+    The table is applied with AVX2 gathers where the CPU supports them. Conversion may be done in
+    place, writing the uint8 image over the start of the uint16 image.
+    */
+    class InairaWindowLut
+    {
+        public:
+            InairaWindowLut();
+            virtual ~InairaWindowLut();
+
+            bool configure(uint32_t level, uint32_t width, double gamma);
+            void convert(const uint16_t* data, uint8_t* converted, std::size_t num_pixels) const;
+            bool useSimd(bool enable);
+
+            uint32_t level;
+            uint32_t width;
+            double gamma;
+
+        private:
+            bool use_avx2_;
+            std::vector<uint8_t> table_;
+    };
+}
+
+#endif /*INCLUDE_InairaWINDOWLUT_H_*/
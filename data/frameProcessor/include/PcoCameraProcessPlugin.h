@@ -1,7 +1,16 @@
 #ifndef INCLUDE_PCOCAMERAPROCESSPLUGIN_H_
 #define INCLUDE_PCOCAMERAPROCESSPLUGIN_H_
 
+#include <boost/thread/mutex.hpp>
+
 #include "InairaProcessorPlugin.h"
+#include "InairaFrameCorrection.h"
+#include "InairaFrameStatistics.h"
+#include "InairaFocusMetric.h"
+#include "InairaFrameBinning.h"
+#include "InairaPixelPacking.h"
+#include "InairaLatencyHistogram.h"
+#include "InairaCrc32c.h"
 
 namespace FrameProcessor
 {
@@ -18,8 +27,81 @@ namespace FrameProcessor
 
         private:
             void process_frame(boost::shared_ptr<Frame> frame);
-            void decodeHeader(boost::shared_ptr<Frame> frame);
+            bool decodeHeader(boost::shared_ptr<Frame> frame);
+            void calculateStatistics(boost::shared_ptr<Frame> frame);
+            void correctFrame(boost::shared_ptr<Frame> frame);
+            void calculateFocus(boost::shared_ptr<Frame> frame);
+            void binFrame(boost::shared_ptr<Frame> frame);
+            void packFrame(boost::shared_ptr<Frame> frame);
+            void checkCameraImageNumber(uint32_t frame_number, uint32_t camera_image_number);
+            void recordLatency(boost::shared_ptr<Frame> frame, uint64_t process_start_ns);
+
+            static const std::string CONFIG_DARK_MAP_FILE;
+            static const std::string CONFIG_GAIN_MAP_FILE;
+            static const std::string CONFIG_BAD_PIXEL_FILE;
+            static const std::string CONFIG_CAPTURE_DARK_FRAMES;
+            static const std::string CONFIG_CAPTURE_FLAT_FRAMES;
+            static const std::string CONFIG_COMPUTE_STATS;
+            static const std::string CONFIG_STATS_HISTOGRAM_BINS;
+            static const std::string CONFIG_STATS_PIXEL_BITS;
+            static const std::string CONFIG_STATS_SATURATION_LEVEL;
+            static const std::string CONFIG_BINNING;
+            static const std::string CONFIG_BINNING_MODE;
+            static const std::string CONFIG_BINNING_SATURATION_LEVEL;
+            static const std::string CONFIG_PACK_BITS;
+            static const std::string CONFIG_COMPUTE_FOCUS;
+            static const std::string CONFIG_FOCUS_ROW_STEP;
+            static const std::string CONFIG_FOCUS_THRESHOLD;
+            static const std::string CONFIG_VERIFY_CHECKSUM;
+
+            InairaFrameCorrection correction_;    //!< Dark, flat and bad pixel correction
+            boost::mutex correction_mutex_;       //!< Protects the correction maps during loading
+
+            bool compute_stats_;                  //!< Enables the frame statistics stage
+            InairaFrameStatistics stats_;         //!< Frame statistics calculator
+            boost::mutex stats_mutex_;            //!< Protects the statistics reported in status
+            uint64_t stats_frames_;               //!< Number of frames with statistics calculated
+            double stats_mean_sum_;               //!< Sum of frame means for the average mean
+            uint64_t stats_saturated_total_;      //!< Total saturated pixels over all frames
+            uint64_t stats_saturated_frames_;     //!< Number of frames with saturated pixels
+            uint32_t last_min_;                   //!< Minimum of the last frame
+            uint32_t last_max_;                   //!< Maximum of the last frame
+            double last_mean_;                    //!< Mean of the last frame
+            double last_std_dev_;                 //!< Standard deviation of the last frame
+            std::vector<uint32_t> last_histogram_; //!< Histogram of the last frame
+
+            InairaFrameBinning binning_;          //!< In-place pixel binning
+            uint64_t frames_binned_;              //!< Number of frames binned
+
+            bool compute_focus_;                  //!< Enables the focus metric stage
+            InairaFocusMetric focus_;             //!< Focus metric calculator
+            double focus_threshold_;              //!< Focus below which frames are tagged blurred
+            double last_focus_;                   //!< Focus metric of the last frame
+            uint64_t focus_frames_;               //!< Number of frames with focus calculated
+            uint64_t blurred_frames_;             //!< Number of frames tagged as blurred
+
+            InairaPixelPacking packing_;          //!< Pixel packing to the sensor bit depth
+            uint64_t frames_packed_;              //!< Number of frames packed
+            uint64_t frames_not_packed_;          //!< Frames left unpacked as pixels overflowed
+
+            uint64_t frames_invalid_header_;      //!< Frames dropped with an invalid header
+
+            bool verify_checksum_;                //!< Verifies frame payload checksums
+            uint64_t frames_checksum_verified_;   //!< Frames with a matching payload checksum
+            uint64_t frames_checksum_mismatched_; //!< Frames with a mismatched payload checksum
+
+            boost::mutex latency_mutex_;          //!< Protects the latency histograms
+            InairaLatencyHistogram grab_to_ready_latency_;    //!< Receiver grab to frame ready
+            InairaLatencyHistogram ready_to_process_latency_; //!< Frame ready to processing start
+            InairaLatencyHistogram processing_latency_;       //!< Processing in this plugin
 
+            bool camera_tracking_;                //!< Camera image number tracking is active
+            uint32_t last_frame_number_;          //!< Frame number of the last tracked frame
+            uint32_t last_camera_image_number_;   //!< Camera image number of the last tracked frame
+            uint64_t camera_frames_lost_;         //!< Frames lost between camera and receiver
+            uint64_t camera_frame_gaps_;          //!< Number of gaps in the camera image numbers
+            uint64_t camera_frame_duplicates_;    //!< Number of repeated camera image numbers
+            uint64_t camera_frame_reordered_;     //!< Number of out of order camera image numbers
     };
 
     /*
@@ -0,0 +1,400 @@
+
+#include <blosc.h>
+
+#include <InairaCompressionPlugin.h>
+#include "DataBlockFrame.h"
+#include "DebugLevelLogger.h"
+#include "version.h"
+
+namespace FrameProcessor
+{
+    const std::string InairaCompressionPlugin::CONFIG_COMPRESSOR = "compressor";
+    const std::string InairaCompressionPlugin::CONFIG_LEVEL = "level";
+    const std::string InairaCompressionPlugin::CONFIG_SHUFFLE = "shuffle";
+    const std::string InairaCompressionPlugin::CONFIG_THREADS = "threads";
+    const std::string InairaCompressionPlugin::CONFIG_MAX_PENDING = "max_pending";
+
+    /**
+     * The constructor
+     */
+    InairaCompressionPlugin::InairaCompressionPlugin() :
+        compressor_("lz4"),
+        level_(1),
+        shuffle_("byte"),
+        threads_(4),
+        max_pending_(16),
+        stop_workers_(false),
+        pending_(0),
+        next_sequence_(0),
+        next_emit_(0),
+        frames_compressed_(0),
+        frames_failed_(0),
+        bytes_in_(0),
+        bytes_out_(0),
+        max_reorder_depth_(0)
+    {
+        logger_ = Logger::getLogger("FP.InairaCompressionPlugin");
+        LOG4CXX_INFO(logger_, "InairaCompressionPlugin version " <<
+            this->get_version_long() << " loaded with Blosc " << BLOSC_VERSION_STRING);
+
+        // Bind the counters published to the shared memory metrics page
+        metrics_.bind("frames_pending", pending_, Inaira::MetricGauge);
+        metrics_.bind("frames_compressed", frames_compressed_, Inaira::MetricCounter);
+        metrics_.bind("frames_failed", frames_failed_, Inaira::MetricCounter);
+        metrics_.bind("bytes_in", bytes_in_, Inaira::MetricCounter);
+        metrics_.bind("bytes_out", bytes_out_, Inaira::MetricCounter);
+
+        startWorkers();
+    }
+
+    InairaCompressionPlugin::~InairaCompressionPlugin()
+    {
+        LOG4CXX_TRACE(logger_, "InairaCompressionPlugin destructor.");
+        stopWorkers();
+    }
+
+    /**
+     * Configure the compression plugin. This plugin supports the following configuration
+     * parameters:
+     *
+     * - compressor_   <=> compressor
+     * - level_        <=> level
+     * - shuffle_      <=> shuffle
+     * - threads_      <=> threads
+     * - max_pending_  <=> max_pending
+     * - metrics_      <=> metrics
+     * - perf_         <=> perf_counters
+     *
+     * The compressor is any compressor supported by the Blosc library, e.g. "lz4", "lz4hc",
+     * "zstd" or "blosclz", with a compression level from 0 to 9. The shuffle filter is "byte",
+     * "bit" or "none"; byte shuffle suits uint16 images. Up to max_pending frames are held while
+     * they are compressed by threads worker threads, after which incoming frames wait. Changing the
+     * number of threads restarts the workers once the pending frames have been pushed.
+     *
+     * Setting metrics to a shared memory name publishes the pending frame and byte counters to a
+     * metrics page of that name as each frame is queued. An empty name stops publishing.
+     * Setting perf_counters reads hardware performance counters around the compression in each
+     * worker thread, reporting the totals and rates in status.
+     *
+     * \param[in] config - Reference to the configuration IpcMessage object.
+     * \param[in] reply - Reference to the reply IpcMessage object.
+     */
+    void InairaCompressionPlugin::configure(
+        OdinData::IpcMessage& config, OdinData::IpcMessage& reply)
+    {
+        configureTracing(config, reply);
+        configureMetrics(config, reply);
+        configurePerfCounters(config, reply);
+
+        if (config.has_param(InairaCompressionPlugin::CONFIG_THREADS))
+        {
+            uint32_t threads = config.get_param<unsigned int>(
+                InairaCompressionPlugin::CONFIG_THREADS);
+            if (threads == 0)
+            {
+                reply.set_nack("Number of compression threads must be at least 1");
+            }
+            else if (threads != threads_)
+            {
+                waitForPending();
+                stopWorkers();
+                threads_ = threads;
+                startWorkers();
+            }
+        }
+
+        boost::lock_guard<boost::mutex> lock(queue_mutex_);
+
+        if (config.has_param(InairaCompressionPlugin::CONFIG_COMPRESSOR))
+        {
+            std::string compressor = config.get_param<std::string>(
+                InairaCompressionPlugin::CONFIG_COMPRESSOR);
+            if (blosc_compname_to_compcode(compressor.c_str()) < 0)
+            {
+                LOG4CXX_ERROR(logger_, "Unsupported Blosc compressor " << compressor);
+                reply.set_nack("Unsupported compressor " + compressor);
+            }
+            else
+            {
+                compressor_ = compressor;
+            }
+        }
+        if (config.has_param(InairaCompressionPlugin::CONFIG_LEVEL))
+        {
+            uint32_t level = config.get_param<unsigned int>(InairaCompressionPlugin::CONFIG_LEVEL);
+            if (level > 9)
+            {
+                reply.set_nack("Compression level must be from 0 to 9");
+            }
+            else
+            {
+                level_ = level;
+            }
+        }
+        if (config.has_param(InairaCompressionPlugin::CONFIG_SHUFFLE))
+        {
+            std::string shuffle = config.get_param<std::string>(
+                InairaCompressionPlugin::CONFIG_SHUFFLE);
+            if (shuffle != "byte" && shuffle != "bit" && shuffle != "none")
+            {
+                reply.set_nack("Shuffle must be one of byte, bit or none");
+            }
+            else
+            {
+                shuffle_ = shuffle;
+            }
+        }
+        if (config.has_param(InairaCompressionPlugin::CONFIG_MAX_PENDING))
+        {
+            uint32_t max_pending = config.get_param<unsigned int>(
+                InairaCompressionPlugin::CONFIG_MAX_PENDING);
+            if (max_pending == 0)
+            {
+                reply.set_nack("Maximum pending frames must be at least 1");
+            }
+            else
+            {
+                max_pending_ = max_pending;
+                space_cond_.notify_all();
+            }
+        }
+    }
+
+    void InairaCompressionPlugin::requestConfiguration(OdinData::IpcMessage& reply)
+    {
+        std::string base_str = get_name() + "/";
+        reply.set_param(base_str + InairaCompressionPlugin::CONFIG_COMPRESSOR, compressor_);
+        reply.set_param(base_str + InairaCompressionPlugin::CONFIG_LEVEL, level_);
+        reply.set_param(base_str + InairaCompressionPlugin::CONFIG_SHUFFLE, shuffle_);
+        reply.set_param(base_str + InairaCompressionPlugin::CONFIG_THREADS, threads_);
+        reply.set_param(base_str + InairaCompressionPlugin::CONFIG_MAX_PENDING, max_pending_);
+    }
+
+    void InairaCompressionPlugin::status(OdinData::IpcMessage& status)
+    {
+        LOG4CXX_DEBUG(logger_, "Status requested for InairaCompressionPlugin");
+
+        std::string base_str = get_name() + "/";
+        perf_.status(status, base_str + "perf/");
+        {
+            boost::lock_guard<boost::mutex> lock(queue_mutex_);
+            status.set_param(base_str + "frames_pending", pending_);
+        }
+
+        uint64_t bytes_in = __atomic_load_n(&bytes_in_, __ATOMIC_RELAXED);
+        uint64_t bytes_out = __atomic_load_n(&bytes_out_, __ATOMIC_RELAXED);
+        status.set_param(base_str + "frames_compressed",
+            __atomic_load_n(&frames_compressed_, __ATOMIC_RELAXED));
+        status.set_param(base_str + "frames_failed",
+            __atomic_load_n(&frames_failed_, __ATOMIC_RELAXED));
+        status.set_param(base_str + "bytes_in", bytes_in);
+        status.set_param(base_str + "bytes_out", bytes_out);
+        status.set_param(base_str + "compression_ratio",
+            bytes_out ? static_cast<double>(bytes_in) / bytes_out : 0.0);
+
+        boost::lock_guard<boost::mutex> lock(emit_mutex_);
+        status.set_param(base_str + "max_reorder_depth", max_reorder_depth_);
+    }
+
+    bool InairaCompressionPlugin::reset_statistics(void)
+    {
+        __atomic_store_n(&frames_compressed_, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&frames_failed_, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&bytes_in_, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&bytes_out_, 0, __ATOMIC_RELAXED);
+
+        boost::lock_guard<boost::mutex> lock(emit_mutex_);
+        max_reorder_depth_ = 0;
+        return true;
+    }
+
+    /**
+     * Queue a frame for compression, waiting while the maximum number of frames are pending.
+     *
+     * \param[in] frame - the frame to compress
+     */
+    void InairaCompressionPlugin::process_frame(boost::shared_ptr<Frame> frame)
+    {
+        boost::unique_lock<boost::mutex> lock(queue_mutex_);
+        while (pending_ >= max_pending_)
+        {
+            space_cond_.wait(lock);
+        }
+
+        CompressionJob job;
+        job.sequence = next_sequence_++;
+        job.frame = frame;
+        queue_.push_back(job);
+        pending_++;
+        work_cond_.notify_one();
+
+        // Counters updated by the workers are published as they stand when the frame is queued,
+        // with the queue lock held for the pending frame count
+        metrics_.publish();
+    }
+
+    /**
+     * Push all pending frames downstream before the end of acquisition is passed on, so that it
+     * does not overtake them.
+     */
+    void InairaCompressionPlugin::process_end_of_acquisition(void)
+    {
+        waitForPending();
+        LOG4CXX_DEBUG_LEVEL(1, logger_, "End of acquisition after compressing "
+            << __atomic_load_n(&frames_compressed_, __ATOMIC_RELAXED) << " frames");
+    }
+
+    void InairaCompressionPlugin::startWorkers(void)
+    {
+        stop_workers_ = false;
+        for (uint32_t i = 0; i < threads_; i++)
+        {
+            workers_.push_back(boost::shared_ptr<boost::thread>(
+                new boost::thread(&InairaCompressionPlugin::workerLoop, this)));
+        }
+        LOG4CXX_INFO(logger_, "Started " << threads_ << " compression threads");
+    }
+
+    void InairaCompressionPlugin::stopWorkers(void)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(queue_mutex_);
+            stop_workers_ = true;
+            work_cond_.notify_all();
+        }
+        for (std::size_t i = 0; i < workers_.size(); i++)
+        {
+            workers_[i]->join();
+        }
+        workers_.clear();
+    }
+
+    /*
+     * Worker thread loop, compressing queued frames until the workers are stopped.
+     */
+    void InairaCompressionPlugin::workerLoop(void)
+    {
+        while (true)
+        {
+            CompressionJob job;
+            {
+                boost::unique_lock<boost::mutex> lock(queue_mutex_);
+                while (queue_.empty() && !stop_workers_)
+                {
+                    work_cond_.wait(lock);
+                }
+                if (queue_.empty())
+                {
+                    return;
+                }
+                job = queue_.front();
+                queue_.pop_front();
+            }
+
+            boost::shared_ptr<Frame> compressed = compressFrame(job.frame);
+            job.frame.reset();
+            emitFrame(job.sequence, compressed);
+        }
+    }
+
+    /*
+     * Compress a frame into a new frame, returning a null frame if compression fails. The failed
+     * frame is dropped rather than passed on uncompressed, as the writer would store its raw
+     * pixels as a Blosc chunk. The output block is sized for the worst case, so that blocks of the
+     * same size are reused.
+     */
+    boost::shared_ptr<Frame> InairaCompressionPlugin::compressFrame(boost::shared_ptr<Frame> frame)
+    {
+        Inaira::TraceSpan span(tracer_, "compress", frame->get_frame_number());
+        Inaira::PerfStageSpan perf_span(perf_, "compress");
+
+        std::string compressor;
+        int level;
+        int shuffle;
+        {
+            boost::lock_guard<boost::mutex> lock(queue_mutex_);
+            compressor = compressor_;
+            level = level_;
+            shuffle = (shuffle_ == "bit") ? BLOSC_BITSHUFFLE :
+                (shuffle_ == "byte") ? BLOSC_SHUFFLE : BLOSC_NOSHUFFLE;
+        }
+
+        FrameMetaData metadata = frame->get_meta_data_copy();
+        std::size_t image_size = frame->get_image_size();
+        std::size_t type_size = get_size_from_enum(metadata.get_data_type());
+        std::size_t block_size = image_size + BLOSC_MAX_OVERHEAD;
+
+        metadata.set_compression_type(blosc);
+        boost::shared_ptr<Frame> compressed(new DataBlockFrame(metadata, block_size));
+
+        int compressed_size = blosc_compress_ctx(level, shuffle, type_size, image_size,
+            frame->get_image_ptr(), compressed->get_data_ptr(), block_size, compressor.c_str(),
+            0, 1);
+
+        if (compressed_size <= 0)
+        {
+            LOG4CXX_ERROR(logger_, "Failed to compress frame " << frame->get_frame_number()
+                << " with error " << compressed_size << ", dropping frame");
+            __atomic_fetch_add(&frames_failed_, 1, __ATOMIC_RELAXED);
+            return boost::shared_ptr<Frame>();
+        }
+
+        compressed->set_image_size(compressed_size);
+        LOG4CXX_DEBUG_LEVEL(2, logger_, "Compressed frame " << frame->get_frame_number()
+            << " from " << image_size << " to " << compressed_size << " bytes");
+
+        __atomic_fetch_add(&frames_compressed_, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&bytes_in_, image_size, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&bytes_out_, compressed_size, __ATOMIC_RELAXED);
+        return compressed;
+    }
+
+    /*
+     * Hold a completed frame until all frames received before it have been pushed, then push it
+     * and any following frames that are already complete. A null frame, which failed to
+     * compress, takes its place in the sequence but is not pushed.
+     */
+    void InairaCompressionPlugin::emitFrame(uint64_t sequence, boost::shared_ptr<Frame> frame)
+    {
+        uint32_t emitted = 0;
+        {
+            boost::lock_guard<boost::mutex> lock(emit_mutex_);
+            completed_[sequence] = frame;
+            if (completed_.size() > max_reorder_depth_)
+            {
+                max_reorder_depth_ = completed_.size();
+            }
+
+            std::map<uint64_t, boost::shared_ptr<Frame> >::iterator next = completed_.begin();
+            while (next != completed_.end() && next->first == next_emit_)
+            {
+                if (next->second)
+                {
+                    this->push(next->second);
+                }
+                completed_.erase(next++);
+                next_emit_++;
+                emitted++;
+            }
+        }
+
+        if (emitted)
+        {
+            boost::lock_guard<boost::mutex> lock(queue_mutex_);
+            pending_ -= emitted;
+            space_cond_.notify_all();
+        }
+    }
+
+    /*
+     * Wait until all queued frames have been compressed and pushed downstream.
+     */
+    void InairaCompressionPlugin::waitForPending(void)
+    {
+        boost::unique_lock<boost::mutex> lock(queue_mutex_);
+        while (pending_ > 0)
+        {
+            space_cond_.wait(lock);
+        }
+    }
+}
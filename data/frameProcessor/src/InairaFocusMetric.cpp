@@ -0,0 +1,154 @@
+
+#include <InairaFocusMetric.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INAIRA_X86_SIMD
+#endif
+
+namespace FrameProcessor
+{
+#ifdef INAIRA_X86_SIMD
+    /*
+     * AVX2 kernel for the sum and sum of squares of the Laplacian of the interior pixels of a row,
+     * 8 at a time, starting from the second pixel. Returns the number of pixels processed.
+     */
+    __attribute__((target("avx2")))
+    static std::size_t laplacian_row_avx2(const uint16_t* above, const uint16_t* row,
+        const uint16_t* below, std::size_t num_interior, int64_t& sum, int64_t& sum_sq)
+    {
+        std::size_t num_vector = num_interior & ~static_cast<std::size_t>(7);
+        __m256i vsum = _mm256_setzero_si256();
+        __m256i vsum_sq = _mm256_setzero_si256();
+
+        for (std::size_t x = 1; x < num_vector + 1; x += 8)
+        {
+            __m256i centre = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)));
+            __m256i left = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1)));
+            __m256i right = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1)));
+            __m256i up = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x)));
+            __m256i down = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x)));
+
+            __m256i laplacian = _mm256_sub_epi32(_mm256_slli_epi32(centre, 2),
+                _mm256_add_epi32(_mm256_add_epi32(left, right), _mm256_add_epi32(up, down)));
+
+            // The row sum fits in 32-bit lanes, the squares are accumulated in 64-bit lanes
+            vsum = _mm256_add_epi32(vsum, laplacian);
+            vsum_sq = _mm256_add_epi64(vsum_sq, _mm256_mul_epi32(laplacian, laplacian));
+            laplacian = _mm256_srli_epi64(laplacian, 32);
+            vsum_sq = _mm256_add_epi64(vsum_sq, _mm256_mul_epi32(laplacian, laplacian));
+        }
+
+        int32_t lanes32[8];
+        int64_t lanes64[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes32), vsum);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes64), vsum_sq);
+        for (int i = 0; i < 8; i++)
+        {
+            sum += lanes32[i];
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            sum_sq += lanes64[i];
+        }
+        return num_vector;
+    }
+#endif
+
+    InairaFocusMetric::InairaFocusMetric() :
+        row_step(8),
+        use_avx2_(false)
+    {
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    InairaFocusMetric::~InairaFocusMetric()
+    {
+    }
+
+    /**
+     * Enable or disable the AVX2 implementation, which is only used where the CPU supports it.
+     * Disabling it selects the scalar implementation, e.g. to check the two agree.
+     *
+     * \param[in] enable - true to use AVX2 where the CPU supports it
+     * \return true if the AVX2 implementation is in use
+     */
+    bool InairaFocusMetric::useSimd(bool enable)
+    {
+        use_avx2_ = false;
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = enable && __builtin_cpu_supports("avx2");
+#endif
+        return use_avx2_;
+    }
+
+    /**
+     * Configure the row subsampling of the metric.
+     *
+     * \param[in] row_step - interval between the rows sampled, at least 1
+     * \return true if the configuration is valid, false otherwise
+     */
+    bool InairaFocusMetric::configure(uint32_t row_step)
+    {
+        if (row_step == 0)
+        {
+            return false;
+        }
+        this->row_step = row_step;
+        return true;
+    }
+
+    /**
+     * Calculate the focus metric of an image.
+     *
+     * \param[in] data - pointer to the image
+     * \param[in] width - image width in pixels
+     * \param[in] height - image height in pixels
+     * \return variance of the Laplacian over the sampled rows, zero if the image is too small
+     */
+    double InairaFocusMetric::calculate(const uint16_t* data, uint32_t width, uint32_t height) const
+    {
+        if (width < 3 || height < 3)
+        {
+            return 0.0;
+        }
+
+        std::size_t num_interior = width - 2;
+        int64_t sum = 0;
+        int64_t sum_sq = 0;
+        uint64_t count = 0;
+
+        for (uint32_t y = 1; y < height - 1; y += row_step)
+        {
+            const uint16_t* row = data + static_cast<std::size_t>(y) * width;
+            const uint16_t* above = row - width;
+            const uint16_t* below = row + width;
+
+            std::size_t offset = 0;
+#ifdef INAIRA_X86_SIMD
+            if (use_avx2_)
+            {
+                offset = laplacian_row_avx2(above, row, below, num_interior, sum, sum_sq);
+            }
+#endif
+            for (std::size_t x = offset + 1; x < num_interior + 1; x++)
+            {
+                int64_t laplacian = 4 * static_cast<int64_t>(row[x]) - row[x - 1] - row[x + 1]
+                    - above[x] - below[x];
+                sum += laplacian;
+                sum_sq += laplacian * laplacian;
+            }
+            count += num_interior;
+        }
+
+        double mean = static_cast<double>(sum) / count;
+        return static_cast<double>(sum_sq) / count - mean * mean;
+    }
+}
@@ -0,0 +1,171 @@
+
+#include <InairaFrameAccumulator.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INAIRA_X86_SIMD
+#endif
+
+namespace FrameProcessor
+{
+    // Maximum number of frames accumulated, so that the uint32 pixel sums cannot overflow
+    const uint32_t MAX_ACCUMULATED_FRAMES = 65536;
+
+#ifdef INAIRA_X86_SIMD
+    /*
+     * AVX2 kernel widening uint16 pixels and adding them to the uint32 sums, 16 at a time.
+     * Returns the number of pixels added, always a multiple of 16.
+     */
+    __attribute__((target("avx2")))
+    static std::size_t accumulate_avx2(uint32_t* sum, const uint16_t* data, std::size_t num_pixels)
+    {
+        std::size_t num_vector = num_pixels & ~static_cast<std::size_t>(15);
+
+        for (std::size_t i = 0; i < num_vector; i += 16)
+        {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(pixels));
+            __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(pixels, 1));
+
+            __m256i* sum_lo = reinterpret_cast<__m256i*>(sum + i);
+            __m256i* sum_hi = reinterpret_cast<__m256i*>(sum + i + 8);
+            _mm256_storeu_si256(sum_lo, _mm256_add_epi32(_mm256_loadu_si256(sum_lo), lo));
+            _mm256_storeu_si256(sum_hi, _mm256_add_epi32(_mm256_loadu_si256(sum_hi), hi));
+        }
+        return num_vector;
+    }
+#endif
+
+    InairaFrameAccumulator::InairaFrameAccumulator() :
+        frames(1),
+        mode("mean"),
+        frames_accumulated(0),
+        num_pixels(0),
+        output_sum_(false),
+        use_avx2_(false)
+    {
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    InairaFrameAccumulator::~InairaFrameAccumulator()
+    {
+    }
+
+    /**
+     * Enable or disable the AVX2 implementation, which is only used where the CPU supports it.
+     * Disabling it selects the scalar implementation, e.g. to check the two agree.
+     *
+     * \param[in] enable - true to use AVX2 where the CPU supports it
+     * \return true if the AVX2 implementation is in use
+     */
+    bool InairaFrameAccumulator::useSimd(bool enable)
+    {
+        use_avx2_ = false;
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = enable && __builtin_cpu_supports("avx2");
+#endif
+        return use_avx2_;
+    }
+
+    /**
+     * Configure the accumulation. A single frame disables accumulation. Any partially accumulated
+     * frames are discarded.
+     *
+     * \param[in] frames - number of frames accumulated into each output frame
+     * \param[in] mode - "sum" for a uint32 output frame or "mean" for a uint16 output frame
+     * \return true if the configuration is valid, false otherwise
+     */
+    bool InairaFrameAccumulator::configure(uint32_t frames, const std::string& mode)
+    {
+        if (frames == 0 || frames > MAX_ACCUMULATED_FRAMES || (mode != "sum" && mode != "mean"))
+        {
+            return false;
+        }
+
+        this->frames = frames;
+        this->mode = mode;
+        output_sum_ = (mode == "sum");
+        frames_accumulated = 0;
+        return true;
+    }
+
+    bool InairaFrameAccumulator::enabled(void) const
+    {
+        return frames > 1;
+    }
+
+    bool InairaFrameAccumulator::outputSum(void) const
+    {
+        return output_sum_;
+    }
+
+    std::size_t InairaFrameAccumulator::outputPixelSize(void) const
+    {
+        return output_sum_ ? sizeof(uint32_t) : sizeof(uint16_t);
+    }
+
+    /**
+     * Start a new accumulation, clearing the sums.
+     *
+     * \param[in] num_pixels - number of pixels in each frame
+     */
+    void InairaFrameAccumulator::reset(std::size_t num_pixels)
+    {
+        this->num_pixels = num_pixels;
+        sum_.assign(num_pixels, 0);
+        frames_accumulated = 0;
+    }
+
+    /**
+     * Add a frame of num_pixels pixels to the sums.
+     *
+     * \param[in] data - pointer to the image
+     */
+    void InairaFrameAccumulator::add(const uint16_t* data)
+    {
+        std::size_t start = 0;
+#ifdef INAIRA_X86_SIMD
+        if (use_avx2_)
+        {
+            start = accumulate_avx2(&sum_[0], data, num_pixels);
+        }
+#endif
+        for (std::size_t i = start; i < num_pixels; i++)
+        {
+            sum_[i] += data[i];
+        }
+        frames_accumulated++;
+    }
+
+    bool InairaFrameAccumulator::complete(void) const
+    {
+        return frames_accumulated >= frames;
+    }
+
+    /**
+     * Read out the accumulated frame, as uint32 sums or uint16 means rounded to nearest over the
+     * frames accumulated. This is done once per output frame, so the division is left scalar.
+     *
+     * \param[out] output - buffer of num_pixels * outputPixelSize() bytes
+     */
+    void InairaFrameAccumulator::read(void* output) const
+    {
+        if (output_sum_)
+        {
+            std::memcpy(output, &sum_[0], num_pixels * sizeof(uint32_t));
+            return;
+        }
+
+        uint16_t* mean = static_cast<uint16_t*>(output);
+        const uint64_t divisor = std::max<uint32_t>(frames_accumulated, 1);
+        for (std::size_t i = 0; i < num_pixels; i++)
+        {
+            mean[i] = static_cast<uint16_t>((sum_[i] + divisor / 2) / divisor);
+        }
+    }
+}
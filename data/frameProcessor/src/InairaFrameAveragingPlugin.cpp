@@ -0,0 +1,224 @@
+
+#include <InairaFrameAveragingPlugin.h>
+#include "DataBlockFrame.h"
+#include "DebugLevelLogger.h"
+#include "version.h"
+
+namespace FrameProcessor
+{
+    const std::string InairaFrameAveragingPlugin::CONFIG_FRAMES = "frames";
+    const std::string InairaFrameAveragingPlugin::CONFIG_MODE = "mode";
+
+    /**
+     * The constructor
+     */
+    InairaFrameAveragingPlugin::InairaFrameAveragingPlugin() :
+        group_active_(false),
+        group_(0),
+        frames_accumulated_(0),
+        frames_emitted_(0),
+        frames_passed_(0),
+        groups_discarded_(0)
+    {
+        logger_ = Logger::getLogger("FP.InairaFrameAveragingPlugin");
+        LOG4CXX_INFO(logger_, "InairaFrameAveragingPlugin version " <<
+            this->get_version_long() << " loaded.");
+
+        // Bind the counters published to the shared memory metrics page
+        metrics_.bind("frames_accumulated", frames_accumulated_, Inaira::MetricCounter);
+        metrics_.bind("frames_emitted", frames_emitted_, Inaira::MetricCounter);
+        metrics_.bind("frames_passed", frames_passed_, Inaira::MetricCounter);
+        metrics_.bind("groups_discarded", groups_discarded_, Inaira::MetricCounter);
+    }
+
+    InairaFrameAveragingPlugin::~InairaFrameAveragingPlugin()
+    {
+        LOG4CXX_TRACE(logger_, "InairaFrameAveragingPlugin destructor.");
+    }
+
+    /**
+     * Configure the averaging plugin. This plugin supports the following configuration
+     * parameters:
+     *
+     * - accumulator_  <=> frames, mode
+     * - metrics_      <=> metrics
+     * - perf_         <=> perf_counters
+     *
+     * Each group of frames consecutive frame numbers is accumulated into one output frame, with
+     * frame number equal to the group index. The "mean" mode outputs the rounded uint16 mean and
+     * the "sum" mode outputs the exact uint32 sum, which cannot overflow for up to 65536 frames.
+     * A single frame disables accumulation and passes frames on unchanged. Changing the
+     * configuration discards any partially accumulated group.
+     *
+     * Setting metrics to a shared memory name publishes the frame counters to a metrics page of
+     * that name after every frame. An empty name stops publishing.
+     *
+     * \param[in] config - Reference to the configuration IpcMessage object.
+     * \param[in] reply - Reference to the reply IpcMessage object.
+     */
+    void InairaFrameAveragingPlugin::configure(
+        OdinData::IpcMessage& config, OdinData::IpcMessage& reply)
+    {
+        configureTracing(config, reply);
+        configureMetrics(config, reply);
+        configurePerfCounters(config, reply);
+
+        if (config.has_param(InairaFrameAveragingPlugin::CONFIG_FRAMES) ||
+            config.has_param(InairaFrameAveragingPlugin::CONFIG_MODE))
+        {
+            boost::lock_guard<boost::mutex> lock(accumulator_mutex_);
+            uint32_t frames = config.get_param<unsigned int>(
+                InairaFrameAveragingPlugin::CONFIG_FRAMES, accumulator_.frames);
+            std::string mode = config.get_param<std::string>(
+                InairaFrameAveragingPlugin::CONFIG_MODE, accumulator_.mode);
+
+            if (frames == accumulator_.frames && mode == accumulator_.mode)
+            {
+                return;
+            }
+
+            discardGroup();
+            if (!accumulator_.configure(frames, mode))
+            {
+                LOG4CXX_ERROR(logger_, "Invalid averaging configuration: frames " << frames
+                    << " mode " << mode);
+                reply.set_nack("Invalid averaging configuration");
+            }
+        }
+    }
+
+    void InairaFrameAveragingPlugin::requestConfiguration(OdinData::IpcMessage& reply)
+    {
+        std::string base_str = get_name() + "/";
+        boost::lock_guard<boost::mutex> lock(accumulator_mutex_);
+        reply.set_param(base_str + InairaFrameAveragingPlugin::CONFIG_FRAMES, accumulator_.frames);
+        reply.set_param(base_str + InairaFrameAveragingPlugin::CONFIG_MODE, accumulator_.mode);
+    }
+
+    void InairaFrameAveragingPlugin::status(OdinData::IpcMessage& status)
+    {
+        LOG4CXX_DEBUG(logger_, "Status requested for InairaFrameAveragingPlugin");
+
+        std::string base_str = get_name() + "/";
+        perf_.status(status, base_str + "perf/");
+        boost::lock_guard<boost::mutex> lock(accumulator_mutex_);
+        status.set_param(base_str + "frames_accumulated", frames_accumulated_);
+        status.set_param(base_str + "frames_emitted", frames_emitted_);
+        status.set_param(base_str + "frames_passed", frames_passed_);
+        status.set_param(base_str + "groups_discarded", groups_discarded_);
+        status.set_param(base_str + "group_frames",
+            group_active_ ? accumulator_.frames_accumulated : 0);
+    }
+
+    bool InairaFrameAveragingPlugin::reset_statistics(void)
+    {
+        boost::lock_guard<boost::mutex> lock(accumulator_mutex_);
+        frames_accumulated_ = 0;
+        frames_emitted_ = 0;
+        frames_passed_ = 0;
+        groups_discarded_ = 0;
+        return true;
+    }
+
+    /**
+     * Accumulate a uint16 frame into the group for its frame number. A frame belonging to a
+     * later group, or with different dimensions, discards the incomplete current group, so that
+     * dropped frames never mix groups. The input frame is released on return.
+     *
+     * \param[in] frame - the frame to accumulate
+     */
+    void InairaFrameAveragingPlugin::process_frame(boost::shared_ptr<Frame> frame)
+    {
+        boost::unique_lock<boost::mutex> lock(accumulator_mutex_);
+
+        if (!accumulator_.enabled() || frame->get_meta_data().get_data_type() != raw_16bit)
+        {
+            frames_passed_++;
+            metrics_.publish();
+            lock.unlock();
+            this->push(frame);
+            return;
+        }
+
+        const dimensions_t& dims = frame->get_meta_data().get_dimensions();
+        std::size_t num_pixels = frame->get_image_size() / sizeof(uint16_t);
+        uint64_t group = frame->get_frame_number() / accumulator_.frames;
+
+        if (group_active_ && (group != group_ ||
+            dims != group_metadata_.get_dimensions() || num_pixels != accumulator_.num_pixels))
+        {
+            discardGroup();
+        }
+        if (!group_active_)
+        {
+            startGroup(frame, group);
+        }
+
+        Inaira::TraceSpan span(tracer_, "accumulate", frame->get_frame_number());
+        Inaira::PerfStageSpan perf_span(perf_, "accumulate");
+        accumulator_.add(static_cast<const uint16_t*>(frame->get_image_ptr()));
+        frames_accumulated_++;
+        perf_span.end();
+        span.end();
+
+        if (accumulator_.complete())
+        {
+            emitGroup();
+        }
+        metrics_.publish();
+    }
+
+    /**
+     * Discard any incomplete group at the end of the acquisition.
+     */
+    void InairaFrameAveragingPlugin::process_end_of_acquisition(void)
+    {
+        boost::lock_guard<boost::mutex> lock(accumulator_mutex_);
+        discardGroup();
+        LOG4CXX_DEBUG_LEVEL(1, logger_, "End of acquisition after emitting "
+            << frames_emitted_ << " averaged frames");
+    }
+
+    void InairaFrameAveragingPlugin::startGroup(boost::shared_ptr<Frame> frame, uint64_t group)
+    {
+        group_metadata_ = frame->get_meta_data_copy();
+        group_ = group;
+        group_active_ = true;
+        accumulator_.reset(frame->get_image_size() / sizeof(uint16_t));
+    }
+
+    /*
+     * Read the completed group out into a new frame and push it. The group is only pushed while
+     * the accumulator mutex is held, so that configuration cannot change the accumulator under it.
+     */
+    void InairaFrameAveragingPlugin::emitGroup(void)
+    {
+        FrameMetaData metadata = group_metadata_;
+        metadata.set_frame_number(group_);
+        metadata.set_data_type(accumulator_.outputSum() ? raw_32bit : raw_16bit);
+        metadata.set_parameter<uint32_t>("averaged_frames", accumulator_.frames_accumulated);
+        metadata.set_parameter<std::string>("averaging_mode", accumulator_.mode);
+
+        std::size_t output_size = accumulator_.num_pixels * accumulator_.outputPixelSize();
+        boost::shared_ptr<Frame> output(new DataBlockFrame(metadata, output_size));
+        accumulator_.read(output->get_data_ptr());
+
+        LOG4CXX_DEBUG_LEVEL(2, logger_, "Emitting frame " << group_ << " from "
+            << accumulator_.frames_accumulated << " frames");
+
+        group_active_ = false;
+        frames_emitted_++;
+        this->push(output);
+    }
+
+    void InairaFrameAveragingPlugin::discardGroup(void)
+    {
+        if (group_active_)
+        {
+            LOG4CXX_WARN(logger_, "Discarding incomplete group " << group_ << " of "
+                << accumulator_.frames_accumulated << " frames");
+            groups_discarded_++;
+            group_active_ = false;
+        }
+    }
+}
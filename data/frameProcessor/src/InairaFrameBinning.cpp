@@ -0,0 +1,127 @@
+
+#include <InairaFrameBinning.h>
+
+#include <algorithm>
+
+namespace FrameProcessor
+{
+    InairaFrameBinning::InairaFrameBinning() :
+        factor(1),
+        mode("sum"),
+        saturation_level(0xFFFF),
+        mean_(false)
+    {
+    }
+
+    InairaFrameBinning::~InairaFrameBinning()
+    {
+    }
+
+    /**
+     * Configure the binning. A factor of 1 disables binning.
+     *
+     * \param[in] factor - binning factor in each dimension, 1, 2 or 4
+     * \param[in] mode - "sum" or "mean"
+     * \param[in] saturation_level - input pixel value at or above which a pixel is saturated
+     * \return true if the configuration is valid, false otherwise
+     */
+    bool InairaFrameBinning::configure(
+        uint32_t factor, const std::string& mode, uint32_t saturation_level)
+    {
+        if ((factor != 1 && factor != 2 && factor != 4) ||
+            (mode != "sum" && mode != "mean") ||
+            saturation_level == 0 || saturation_level > 0xFFFF)
+        {
+            return false;
+        }
+
+        this->factor = factor;
+        this->mode = mode;
+        this->saturation_level = saturation_level;
+        mean_ = (mode == "mean");
+        return true;
+    }
+
+    bool InairaFrameBinning::enabled(void) const
+    {
+        return factor > 1;
+    }
+
+    /**
+     * Bin an image in place. Any rows or columns beyond a whole number of bins are discarded.
+     *
+     * \param[in] data - pointer to the image, overwritten by the binned image
+     * \param[in] width - image width in pixels
+     * \param[in] height - image height in pixels
+     * \param[out] binned_width - binned image width in pixels
+     * \param[out] binned_height - binned image height in pixels
+     */
+    void InairaFrameBinning::bin(uint16_t* data, uint32_t width, uint32_t height,
+        uint32_t& binned_width, uint32_t& binned_height)
+    {
+        binned_width = width / factor;
+        binned_height = height / factor;
+
+        bin_sum_.resize(binned_width);
+        bin_max_.resize(binned_width);
+
+        const uint32_t bin_pixels = factor * factor;
+        const uint16_t saturated_output = mean_ ? saturation_level : 0xFFFF;
+
+        for (uint32_t row = 0; row < binned_height; row++)
+        {
+            std::fill(bin_sum_.begin(), bin_sum_.end(), 0);
+            std::fill(bin_max_.begin(), bin_max_.end(), 0);
+
+            // Accumulate all input rows of the bin before writing, as the output row may overlap
+            // the first input row
+            for (uint32_t dy = 0; dy < factor; dy++)
+            {
+                const uint16_t* input_row = data + (std::size_t)(row * factor + dy) * width;
+                if (factor == 2)
+                {
+                    sumRow<2>(input_row, binned_width);
+                }
+                else
+                {
+                    sumRow<4>(input_row, binned_width);
+                }
+            }
+
+            uint16_t* output_row = data + (std::size_t)row * binned_width;
+            for (uint32_t col = 0; col < binned_width; col++)
+            {
+                uint32_t value = mean_ ?
+                    (bin_sum_[col] + bin_pixels / 2) / bin_pixels :
+                    std::min<uint32_t>(bin_sum_[col], 0xFFFF);
+                output_row[col] = (bin_max_[col] >= saturation_level) ?
+                    saturated_output : static_cast<uint16_t>(value);
+            }
+        }
+    }
+
+    /*
+     * Add one input row into the bin sums and maxima. The fixed factor lets the compiler unroll
+     * and vectorise the inner loop.
+     */
+    template <uint32_t Factor>
+    void InairaFrameBinning::sumRow(const uint16_t* row, uint32_t binned_width)
+    {
+        uint32_t* sum = bin_sum_.data();
+        uint16_t* max = bin_max_.data();
+
+        for (uint32_t col = 0; col < binned_width; col++)
+        {
+            const uint16_t* pixels = row + col * Factor;
+            uint32_t bin_sum = 0;
+            uint16_t bin_max = max[col];
+            for (uint32_t dx = 0; dx < Factor; dx++)
+            {
+                bin_sum += pixels[dx];
+                bin_max = std::max(bin_max, pixels[dx]);
+            }
+            sum[col] += bin_sum;
+            max[col] = bin_max;
+        }
+    }
+}
@@ -0,0 +1,530 @@
+
+#include <InairaFrameCorrection.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INAIRA_X86_SIMD
+#endif
+
+namespace FrameProcessor
+{
+    // Maximum number of frames in a capture, so that the uint32 pixel sums cannot overflow
+    const uint32_t MAX_CAPTURE_FRAMES = 65536;
+
+#ifdef INAIRA_X86_SIMD
+    /*
+     * AVX2 kernel correcting pixels as (raw - dark) * gain, 16 at a time, rounding to nearest and
+     * clamping to the uint16 range. Either map may be null. Returns the number of pixels
+     * corrected, always a multiple of 16.
+     */
+    __attribute__((target("avx2")))
+    static std::size_t correct_avx2(uint16_t* data, const float* dark, const float* gain,
+        std::size_t num_pixels)
+    {
+        std::size_t num_vector = num_pixels & ~static_cast<std::size_t>(15);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 max_value = _mm256_set1_ps(65535.0f);
+
+        for (std::size_t i = 0; i < num_vector; i += 16)
+        {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(pixels)));
+            __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(pixels, 1)));
+
+            lo = _mm256_sub_ps(lo, dark ? _mm256_loadu_ps(dark + i) : zero);
+            hi = _mm256_sub_ps(hi, dark ? _mm256_loadu_ps(dark + i + 8) : zero);
+            lo = _mm256_mul_ps(lo, gain ? _mm256_loadu_ps(gain + i) : one);
+            hi = _mm256_mul_ps(hi, gain ? _mm256_loadu_ps(gain + i + 8) : one);
+
+            lo = _mm256_min_ps(_mm256_max_ps(lo, zero), max_value);
+            hi = _mm256_min_ps(_mm256_max_ps(hi, zero), max_value);
+
+            // Convert with the default round to nearest, and narrow undoing the lane interleave
+            __m256i words = _mm256_packus_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+            words = _mm256_permute4x64_epi64(words, 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), words);
+        }
+        return num_vector;
+    }
+#endif
+
+    /*
+     * the constructor
+     */
+    InairaFrameCorrection::InairaFrameCorrection() :
+        dark_map_pixels(0),
+        gain_map_pixels(0),
+        bad_pixels(0),
+        capture_frames_remaining(0),
+        frames_corrected(0),
+        frames_mismatched(0),
+        bad_pixel_width_(0),
+        bad_pixel_height_(0),
+        capture_type_(CaptureNone),
+        capture_frames_(0),
+        capture_width_(0),
+        capture_height_(0),
+        use_avx2_(false)
+    {
+        logger_ = Logger::getLogger("FP.InairaFrameCorrection");
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    InairaFrameCorrection::~InairaFrameCorrection()
+    {
+    }
+
+    /**
+     * Enable or disable the AVX2 implementation, which is only used where the CPU supports it.
+     * Disabling it selects the scalar implementation, e.g. to check the two agree.
+     *
+     * \param[in] enable - true to use AVX2 where the CPU supports it
+     * \return true if the AVX2 implementation is in use
+     */
+    bool InairaFrameCorrection::useSimd(bool enable)
+    {
+        use_avx2_ = false;
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = enable && __builtin_cpu_supports("avx2");
+#endif
+        return use_avx2_;
+    }
+
+    /**
+     * Load the dark map from a raw float32 file. An empty path clears the map.
+     *
+     * \param[in] path - path of the dark map file
+     * \return true if the map was loaded or cleared, false otherwise
+     */
+    bool InairaFrameCorrection::loadDarkMap(const std::string& path)
+    {
+        if (!loadMap(path, dark_map_))
+        {
+            return false;
+        }
+        dark_map_file = path;
+        dark_map_pixels = dark_map_.size();
+        return true;
+    }
+
+    /**
+     * Load the gain map from a raw float32 file. An empty path clears the map.
+     *
+     * \param[in] path - path of the gain map file
+     * \return true if the map was loaded or cleared, false otherwise
+     */
+    bool InairaFrameCorrection::loadGainMap(const std::string& path)
+    {
+        if (!loadMap(path, gain_map_))
+        {
+            return false;
+        }
+        gain_map_file = path;
+        gain_map_pixels = gain_map_.size();
+        return true;
+    }
+
+    /**
+     * Load the bad pixel list from a text file with the column and row of one pixel per line.
+     * Blank lines and lines starting with # are ignored. An empty path clears the list.
+     *
+     * \param[in] path - path of the bad pixel file
+     * \return true if the list was loaded or cleared, false otherwise
+     */
+    bool InairaFrameCorrection::loadBadPixels(const std::string& path)
+    {
+        std::vector<std::pair<uint32_t, uint32_t> > pixels;
+
+        if (!path.empty())
+        {
+            std::ifstream bad_pixel_stream(path.c_str());
+            if (!bad_pixel_stream)
+            {
+                LOG4CXX_ERROR(logger_, "Unable to open bad pixel file " << path);
+                return false;
+            }
+
+            std::string line;
+            uint32_t line_number = 0;
+            while (std::getline(bad_pixel_stream, line))
+            {
+                line_number++;
+                std::size_t start = line.find_first_not_of(" \t\r");
+                if (start == std::string::npos || line[start] == '#')
+                {
+                    continue;
+                }
+
+                std::istringstream line_stream(line);
+                uint32_t col, row;
+                if (!(line_stream >> col >> row))
+                {
+                    LOG4CXX_ERROR(logger_, "Invalid bad pixel entry at line " << line_number
+                        << " of " << path);
+                    return false;
+                }
+                pixels.push_back(std::make_pair(col, row));
+            }
+        }
+
+        bad_pixel_list_.swap(pixels);
+        bad_pixel_map_.clear();
+        bad_pixel_width_ = 0;
+        bad_pixel_height_ = 0;
+        bad_pixel_file = path;
+        bad_pixels = bad_pixel_list_.size();
+        LOG4CXX_INFO(logger_, "Loaded " << bad_pixels << " bad pixels");
+        return true;
+    }
+
+    bool InairaFrameCorrection::enabled(void) const
+    {
+        return !dark_map_.empty() || !gain_map_.empty() || !bad_pixel_list_.empty();
+    }
+
+    /**
+     * Correct an image in place. The image is not corrected if a loaded map does not match the
+     * image size.
+     *
+     * \param[in] data - pointer to the image
+     * \param[in] width - image width in pixels
+     * \param[in] height - image height in pixels
+     * \return true if the image was corrected, false otherwise
+     */
+    bool InairaFrameCorrection::apply(uint16_t* data, uint32_t width, uint32_t height)
+    {
+        std::size_t num_pixels = static_cast<std::size_t>(width) * height;
+
+        if ((!dark_map_.empty() && dark_map_.size() != num_pixels) ||
+            (!gain_map_.empty() && gain_map_.size() != num_pixels))
+        {
+            if (frames_mismatched++ == 0)
+            {
+                LOG4CXX_WARN(logger_, "Correction maps do not match image of " << width << "x"
+                    << height << " pixels, not correcting");
+            }
+            return false;
+        }
+
+        if (!dark_map_.empty() || !gain_map_.empty())
+        {
+            correctPixels(data, num_pixels);
+        }
+
+        if (!bad_pixel_list_.empty())
+        {
+            if (width != bad_pixel_width_ || height != bad_pixel_height_)
+            {
+                buildBadPixels(width, height);
+            }
+
+            // Interpolate from the corrected neighbours, which are never themselves bad
+            for (std::size_t i = 0; i < bad_pixel_map_.size(); i++)
+            {
+                const BadPixel& bad_pixel = bad_pixel_map_[i];
+                if (bad_pixel.neighbours.empty())
+                {
+                    continue;
+                }
+                uint32_t sum = 0;
+                for (std::size_t n = 0; n < bad_pixel.neighbours.size(); n++)
+                {
+                    sum += data[bad_pixel.neighbours[n]];
+                }
+                data[bad_pixel.index] = static_cast<uint16_t>(
+                    (sum + bad_pixel.neighbours.size() / 2) / bad_pixel.neighbours.size());
+            }
+        }
+
+        frames_corrected++;
+        return true;
+    }
+
+    /**
+     * Start capturing a dark or flat map by averaging the next frames. A flat capture is
+     * corrected by the current dark map when the map is built.
+     *
+     * \param[in] type - type of map to capture
+     * \param[in] frames - number of frames to average
+     * \return true if the capture was started, false otherwise
+     */
+    bool InairaFrameCorrection::startCapture(CaptureType type, uint32_t frames)
+    {
+        if (type == CaptureNone || frames == 0 || frames > MAX_CAPTURE_FRAMES)
+        {
+            return false;
+        }
+
+        capture_type_ = type;
+        capture_frames_ = frames;
+        capture_frames_remaining = frames;
+        capture_width_ = 0;
+        capture_height_ = 0;
+        capture_sum_.clear();
+
+        LOG4CXX_INFO(logger_, "Capturing " << captureName() << " map from " << frames << " frames");
+        return true;
+    }
+
+    bool InairaFrameCorrection::capturing(void) const
+    {
+        return capture_type_ != CaptureNone;
+    }
+
+    /**
+     * Add an uncorrected image to the current capture, building and saving the map once the
+     * requested number of frames has been added. The capture restarts if the image size changes.
+     *
+     * \param[in] data - pointer to the image
+     * \param[in] width - image width in pixels
+     * \param[in] height - image height in pixels
+     */
+    void InairaFrameCorrection::capture(const uint16_t* data, uint32_t width, uint32_t height)
+    {
+        if (!capturing())
+        {
+            return;
+        }
+
+        if (width != capture_width_ || height != capture_height_)
+        {
+            if (!capture_sum_.empty())
+            {
+                LOG4CXX_WARN(logger_, "Image size changed during " << captureName()
+                    << " capture, restarting");
+            }
+            capture_width_ = width;
+            capture_height_ = height;
+            capture_sum_.assign(static_cast<std::size_t>(width) * height, 0);
+            capture_frames_remaining = capture_frames_;
+        }
+
+        uint32_t* sum = capture_sum_.data();
+        for (std::size_t i = 0; i < capture_sum_.size(); i++)
+        {
+            sum[i] += data[i];
+        }
+
+        if (--capture_frames_remaining == 0)
+        {
+            finishCapture();
+        }
+    }
+
+    std::string InairaFrameCorrection::captureName(void) const
+    {
+        switch (capture_type_)
+        {
+            case CaptureDark:
+                return "dark";
+            case CaptureFlat:
+                return "flat";
+            default:
+                return "none";
+        }
+    }
+
+    /*
+     * Build the captured map from the summed frames, save it to the configured map file if any
+     * and make it the active map. The gain map normalises each pixel of the dark corrected flat
+     * to the mean response, with zero gain for pixels with no response.
+     */
+    void InairaFrameCorrection::finishCapture(void)
+    {
+        std::size_t num_pixels = capture_sum_.size();
+        std::vector<float> map(num_pixels);
+        float scale = 1.0f / capture_frames_;
+
+        if (capture_type_ == CaptureDark)
+        {
+            for (std::size_t i = 0; i < num_pixels; i++)
+            {
+                map[i] = capture_sum_[i] * scale;
+            }
+            if (!dark_map_file.empty())
+            {
+                saveMap(dark_map_file, map);
+            }
+            dark_map_.swap(map);
+            dark_map_pixels = dark_map_.size();
+        }
+        else
+        {
+            bool subtract_dark = (dark_map_.size() == num_pixels);
+            double response_sum = 0.0;
+            for (std::size_t i = 0; i < num_pixels; i++)
+            {
+                map[i] = capture_sum_[i] * scale - (subtract_dark ? dark_map_[i] : 0.0f);
+                response_sum += std::max(map[i], 0.0f);
+            }
+            float mean_response = static_cast<float>(response_sum / num_pixels);
+            for (std::size_t i = 0; i < num_pixels; i++)
+            {
+                map[i] = (map[i] > 0.0f) ? mean_response / map[i] : 0.0f;
+            }
+            if (!gain_map_file.empty())
+            {
+                saveMap(gain_map_file, map);
+            }
+            gain_map_.swap(map);
+            gain_map_pixels = gain_map_.size();
+        }
+
+        LOG4CXX_INFO(logger_, "Completed " << captureName() << " map capture of "
+            << capture_width_ << "x" << capture_height_ << " pixels from " << capture_frames_
+            << " frames");
+
+        capture_type_ = CaptureNone;
+        capture_sum_.clear();
+        std::vector<uint32_t>().swap(capture_sum_);
+    }
+
+    /*
+     * Load a raw float32 map file, or clear the map if the path is empty.
+     */
+    bool InairaFrameCorrection::loadMap(const std::string& path, std::vector<float>& map)
+    {
+        if (path.empty())
+        {
+            map.clear();
+            return true;
+        }
+
+        std::ifstream map_stream(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!map_stream)
+        {
+            LOG4CXX_ERROR(logger_, "Unable to open correction map file " << path);
+            return false;
+        }
+
+        std::streamsize map_bytes = map_stream.tellg();
+        if (map_bytes <= 0 || map_bytes % sizeof(float))
+        {
+            LOG4CXX_ERROR(logger_, "Correction map file " << path << " has invalid size "
+                << map_bytes);
+            return false;
+        }
+
+        std::vector<float> loaded(map_bytes / sizeof(float));
+        map_stream.seekg(0);
+        if (!map_stream.read(reinterpret_cast<char*>(loaded.data()), map_bytes))
+        {
+            LOG4CXX_ERROR(logger_, "Failed to read correction map file " << path);
+            return false;
+        }
+
+        map.swap(loaded);
+        LOG4CXX_INFO(logger_, "Loaded correction map of " << map.size() << " pixels from " << path);
+        return true;
+    }
+
+    /*
+     * Save a map as a raw float32 file.
+     */
+    bool InairaFrameCorrection::saveMap(const std::string& path, const std::vector<float>& map)
+    {
+        std::ofstream map_stream(path.c_str(), std::ios::binary | std::ios::trunc);
+        map_stream.write(reinterpret_cast<const char*>(map.data()), map.size() * sizeof(float));
+        if (!map_stream)
+        {
+            LOG4CXX_ERROR(logger_, "Failed to save correction map file " << path);
+            return false;
+        }
+        LOG4CXX_INFO(logger_, "Saved correction map of " << map.size() << " pixels to " << path);
+        return true;
+    }
+
+    /*
+     * Resolve the bad pixel list for an image size, finding the good pixels among the eight
+     * neighbours of each bad pixel. Pixels outside the image are dropped.
+     */
+    void InairaFrameCorrection::buildBadPixels(uint32_t width, uint32_t height)
+    {
+        std::vector<bool> is_bad(static_cast<std::size_t>(width) * height, false);
+        for (std::size_t i = 0; i < bad_pixel_list_.size(); i++)
+        {
+            uint32_t col = bad_pixel_list_[i].first;
+            uint32_t row = bad_pixel_list_[i].second;
+            if (col < width && row < height)
+            {
+                is_bad[static_cast<std::size_t>(row) * width + col] = true;
+            }
+        }
+
+        bad_pixel_map_.clear();
+        for (std::size_t i = 0; i < bad_pixel_list_.size(); i++)
+        {
+            int64_t col = bad_pixel_list_[i].first;
+            int64_t row = bad_pixel_list_[i].second;
+            if (col >= width || row >= height)
+            {
+                continue;
+            }
+
+            BadPixel bad_pixel;
+            bad_pixel.index = static_cast<std::size_t>(row) * width + col;
+            for (int64_t dy = -1; dy <= 1; dy++)
+            {
+                for (int64_t dx = -1; dx <= 1; dx++)
+                {
+                    int64_t n_col = col + dx;
+                    int64_t n_row = row + dy;
+                    if ((dx == 0 && dy == 0) || n_col < 0 || n_row < 0 ||
+                        n_col >= width || n_row >= height)
+                    {
+                        continue;
+                    }
+                    std::size_t n_index = static_cast<std::size_t>(n_row) * width + n_col;
+                    if (!is_bad[n_index])
+                    {
+                        bad_pixel.neighbours.push_back(n_index);
+                    }
+                }
+            }
+            bad_pixel_map_.push_back(bad_pixel);
+        }
+
+        bad_pixel_width_ = width;
+        bad_pixel_height_ = height;
+        bad_pixels = bad_pixel_map_.size();
+    }
+
+    /*
+     * Apply the dark and gain maps to the pixels.
+     */
+    void InairaFrameCorrection::correctPixels(uint16_t* data, std::size_t num_pixels)
+    {
+        const float* dark = dark_map_.empty() ? NULL : dark_map_.data();
+        const float* gain = gain_map_.empty() ? NULL : gain_map_.data();
+
+        std::size_t offset = 0;
+#ifdef INAIRA_X86_SIMD
+        if (use_avx2_)
+        {
+            offset = correct_avx2(data, dark, gain, num_pixels);
+        }
+#endif
+        for (std::size_t i = offset; i < num_pixels; i++)
+        {
+            float value = data[i];
+            if (dark)
+            {
+                value -= dark[i];
+            }
+            if (gain)
+            {
+                value *= gain[i];
+            }
+            value = std::min(std::max(value, 0.0f), 65535.0f);
+            data[i] = static_cast<uint16_t>(std::nearbyint(value));
+        }
+    }
+}
@@ -0,0 +1,151 @@
+
+#include <InairaFrameHistory.h>
+#include "DataBlockFrame.h"
+
+namespace FrameProcessor
+{
+    /*
+     * the constructor
+     */
+    InairaFrameHistory::InairaFrameHistory() :
+        pre_frames(0),
+        post_frames(0),
+        max_bytes(0),
+        copy_frames(false),
+        frames_held(0),
+        bytes_held(0),
+        frames_flushed(0),
+        frames_evicted(0),
+        triggers(0),
+        post_remaining_(0)
+    {
+        logger_ = Logger::getLogger("FP.InairaFrameHistory");
+    }
+
+    InairaFrameHistory::~InairaFrameHistory()
+    {
+        clear();
+    }
+
+    /**
+     * Configure the depth and memory cap of the history. Any frames currently held are released.
+     *
+     * \param[in] pre_frames - number of frames to keep before a trigger, zero disables the history
+     * \param[in] post_frames - number of frames to forward after a trigger
+     * \param[in] max_bytes - maximum image bytes to hold, zero for no limit
+     * \param[in] copy_frames - hold copies of frames rather than references to the originals
+     */
+    void InairaFrameHistory::configure(uint32_t pre_frames, uint32_t post_frames, std::size_t max_bytes, bool copy_frames)
+    {
+        clear();
+        this->pre_frames = pre_frames;
+        this->post_frames = post_frames;
+        this->max_bytes = max_bytes;
+        this->copy_frames = copy_frames;
+        LOG4CXX_INFO(logger_, "Frame history set to " << pre_frames << " frames before and "
+                     << post_frames << " after a trigger, holding up to " << max_bytes << " bytes"
+                     << (copy_frames ? " as copies" : ""));
+    }
+
+    bool InairaFrameHistory::enabled(void) const
+    {
+        return (pre_frames > 0) || (post_frames > 0);
+    }
+
+    /**
+     * Add a frame to the history, evicting the oldest frames to stay within the configured depth
+     * and memory cap.
+     *
+     * \param[in] frame - the frame to hold
+     */
+    void InairaFrameHistory::store(boost::shared_ptr<Frame> frame)
+    {
+        if(pre_frames == 0)
+        {
+            return;
+        }
+
+        std::size_t frame_bytes = frame->get_image_size();
+        if(max_bytes && frame_bytes > max_bytes)
+        {
+            frames_evicted++;
+            return;
+        }
+
+        if(copy_frames)
+        {
+            // Copy the image only, releasing the shared memory buffer with the original frame
+            boost::shared_ptr<Frame> frame_copy(new DataBlockFrame(
+                frame->get_meta_data(), frame->get_image_ptr(), frame_bytes
+            ));
+            frame_copy->set_image_size(frame_bytes);
+            frame = frame_copy;
+        }
+
+        frames_.push_back(frame);
+        bytes_held += frame_bytes;
+
+        while((frames_.size() > pre_frames) || (max_bytes && bytes_held > max_bytes))
+        {
+            bytes_held -= frames_.front()->get_image_size();
+            frames_.pop_front();
+            frames_evicted++;
+        }
+        frames_held = frames_.size();
+    }
+
+    /**
+     * Trigger the history on a defective frame. The held frames are returned, oldest first, to be
+     * forwarded before the defective frame, and the following post_frames frames will be marked as
+     * context by postTriggerFrame.
+     *
+     * \return the held frames in acquisition order
+     */
+    std::vector<boost::shared_ptr<Frame> > InairaFrameHistory::trigger(void)
+    {
+        std::vector<boost::shared_ptr<Frame> > context(frames_.begin(), frames_.end());
+        frames_.clear();
+        frames_held = 0;
+        bytes_held = 0;
+
+        frames_flushed += context.size();
+        post_remaining_ = post_frames;
+        triggers++;
+
+        return context;
+    }
+
+    /**
+     * Check if the current frame falls within the post-trigger window of the last defective frame.
+     * This must be called once for every frame processed.
+     *
+     * \return true if the frame should be forwarded as context
+     */
+    bool InairaFrameHistory::postTriggerFrame(void)
+    {
+        if(post_remaining_ == 0)
+        {
+            return false;
+        }
+        post_remaining_--;
+        return true;
+    }
+
+    /**
+     * Release all held frames and cancel any post-trigger window.
+     */
+    void InairaFrameHistory::clear(void)
+    {
+        frames_.clear();
+        frames_held = 0;
+        bytes_held = 0;
+        post_remaining_ = 0;
+    }
+
+    void InairaFrameHistory::resetStatistics(void)
+    {
+        frames_flushed = 0;
+        frames_evicted = 0;
+        triggers = 0;
+    }
+}
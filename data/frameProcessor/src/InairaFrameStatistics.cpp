@@ -0,0 +1,278 @@
+
+#include <InairaFrameStatistics.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INAIRA_X86_SIMD
+#endif
+
+namespace FrameProcessor
+{
+    // Number of pixels processed per block, sized so a block stays resident in L1 cache while the
+    // histogram is filled and so the 32-bit vector sums of a block cannot overflow
+    const std::size_t STATS_BLOCK_PIXELS = 4096;
+
+    // Number of interleaved sub-histograms, avoiding store-to-load stalls on repeated bins
+    const std::size_t STATS_SUB_HISTOGRAMS = 4;
+
+#ifdef INAIRA_X86_SIMD
+    /*
+     * AVX2 kernel for the minimum, maximum, sum, sum of squares and saturated pixel count of a
+     * block of pixels. Returns the number of pixels processed, always a multiple of 16.
+     */
+    __attribute__((target("avx2")))
+    static std::size_t block_moments_avx2(const uint16_t* data, std::size_t num_pixels,
+        uint16_t saturation_level, uint16_t& min, uint16_t& max, uint64_t& sum, uint64_t& sum_sq,
+        uint64_t& saturated)
+    {
+        std::size_t num_vector = num_pixels & ~static_cast<std::size_t>(15);
+        if(num_vector == 0)
+        {
+            return 0;
+        }
+
+        __m256i vmin = _mm256_set1_epi16(static_cast<short>(0xFFFF));
+        __m256i vmax = _mm256_setzero_si256();
+        __m256i vsum = _mm256_setzero_si256();
+        __m256i vsum_sq = _mm256_setzero_si256();
+        __m256i vsat_level = _mm256_set1_epi16(static_cast<short>(saturation_level));
+        uint64_t sat_bits = 0;
+
+        for(std::size_t i = 0; i < num_vector; i += 16)
+        {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            vmin = _mm256_min_epu16(vmin, pixels);
+            vmax = _mm256_max_epu16(vmax, pixels);
+
+            // Pixels at or above the saturation level are unchanged by a max with that level
+            __m256i is_sat = _mm256_cmpeq_epi16(_mm256_max_epu16(pixels, vsat_level), pixels);
+            sat_bits += __builtin_popcount(_mm256_movemask_epi8(is_sat));
+
+            // Widen to 32 bits for the sum, and to 64 bits for the squares
+            __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(pixels));
+            __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(pixels, 1));
+            vsum = _mm256_add_epi32(vsum, _mm256_add_epi32(lo, hi));
+
+            vsum_sq = _mm256_add_epi64(vsum_sq, _mm256_mul_epu32(lo, lo));
+            vsum_sq = _mm256_add_epi64(vsum_sq, _mm256_mul_epu32(hi, hi));
+            lo = _mm256_srli_epi64(lo, 32);
+            hi = _mm256_srli_epi64(hi, 32);
+            vsum_sq = _mm256_add_epi64(vsum_sq, _mm256_mul_epu32(lo, lo));
+            vsum_sq = _mm256_add_epi64(vsum_sq, _mm256_mul_epu32(hi, hi));
+        }
+
+        uint16_t lanes16[16];
+        uint32_t lanes32[8];
+        uint64_t lanes64[4];
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes16), vmin);
+        min = *std::min_element(lanes16, lanes16 + 16);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes16), vmax);
+        max = *std::max_element(lanes16, lanes16 + 16);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes32), vsum);
+        sum = 0;
+        for(int i = 0; i < 8; i++)
+        {
+            sum += lanes32[i];
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes64), vsum_sq);
+        sum_sq = lanes64[0] + lanes64[1] + lanes64[2] + lanes64[3];
+
+        // Each saturated 16-bit pixel sets two bits in the byte mask
+        saturated = sat_bits / 2;
+
+        return num_vector;
+    }
+#endif
+
+    /*
+     * the constructor
+     */
+    InairaFrameStatistics::InairaFrameStatistics() :
+        histogram_bins(0),
+        pixel_bits(16),
+        saturation_level(0xFFFF),
+        min(0),
+        max(0),
+        mean(0.0),
+        std_dev(0.0),
+        saturated(0),
+        use_avx2_(false),
+        histogram_shift_(0)
+    {
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = __builtin_cpu_supports("avx2");
+#endif
+        configure(16, 16, 0xFFFF);
+    }
+
+    InairaFrameStatistics::~InairaFrameStatistics()
+    {
+    }
+
+    /**
+     * Enable or disable the AVX2 implementation, which is only used where the CPU supports it.
+     * Disabling it selects the scalar implementation, e.g. to check the two agree.
+     *
+     * \param[in] enable - true to use AVX2 where the CPU supports it
+     * \return true if the AVX2 implementation is in use
+     */
+    bool InairaFrameStatistics::useSimd(bool enable)
+    {
+        use_avx2_ = false;
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = enable && __builtin_cpu_supports("avx2");
+#endif
+        return use_avx2_;
+    }
+
+    /**
+     * Configure the histogram and saturation level.
+     *
+     * \param[in] histogram_bins - number of histogram bins, a power of two no larger than 2^pixel_bits
+     * \param[in] pixel_bits - significant bits per pixel, setting the range covered by the histogram
+     * \param[in] saturation_level - pixel value at or above which a pixel is counted as saturated
+     * \return true if the configuration is valid
+     */
+    bool InairaFrameStatistics::configure(uint32_t histogram_bins, uint32_t pixel_bits, uint32_t saturation_level)
+    {
+        if(pixel_bits == 0 || pixel_bits > 16 || histogram_bins == 0 ||
+           (histogram_bins & (histogram_bins - 1)) != 0 || histogram_bins > (1u << pixel_bits) ||
+           saturation_level > 0xFFFF)
+        {
+            return false;
+        }
+
+        uint32_t bin_bits = 0;
+        while((1u << bin_bits) < histogram_bins)
+        {
+            bin_bits++;
+        }
+
+        this->histogram_bins = histogram_bins;
+        this->pixel_bits = pixel_bits;
+        this->saturation_level = saturation_level;
+        histogram_shift_ = pixel_bits - bin_bits;
+        histogram.assign(histogram_bins, 0);
+        sub_histograms_.assign(histogram_bins * STATS_SUB_HISTOGRAMS, 0);
+        return true;
+    }
+
+    /**
+     * Calculate the statistics of an image in a single pass.
+     *
+     * \param[in] data - pointer to the image pixels
+     * \param[in] num_pixels - number of pixels in the image
+     */
+    void InairaFrameStatistics::calculate(const uint16_t* data, std::size_t num_pixels)
+    {
+        uint64_t total_sum = 0;
+        double total_sum_sq = 0.0;
+
+        min = 0xFFFF;
+        max = 0;
+        saturated = 0;
+        std::fill(sub_histograms_.begin(), sub_histograms_.end(), 0);
+
+        for(std::size_t offset = 0; offset < num_pixels; offset += STATS_BLOCK_PIXELS)
+        {
+            std::size_t block_pixels = std::min(STATS_BLOCK_PIXELS, num_pixels - offset);
+            uint64_t sum = 0;
+            uint64_t sum_sq = 0;
+
+            calculateBlock(data + offset, block_pixels, sum, sum_sq);
+            fillHistogram(data + offset, block_pixels);
+
+            total_sum += sum;
+            total_sum_sq += static_cast<double>(sum_sq);
+        }
+
+        for(uint32_t bin = 0; bin < histogram_bins; bin++)
+        {
+            histogram[bin] = 0;
+            for(std::size_t sub = 0; sub < STATS_SUB_HISTOGRAMS; sub++)
+            {
+                histogram[bin] += sub_histograms_[sub * histogram_bins + bin];
+            }
+        }
+
+        if(num_pixels == 0)
+        {
+            min = 0;
+            mean = 0.0;
+            std_dev = 0.0;
+            return;
+        }
+        mean = static_cast<double>(total_sum) / num_pixels;
+        double variance = (total_sum_sq / num_pixels) - (mean * mean);
+        std_dev = variance > 0.0 ? std::sqrt(variance) : 0.0;
+    }
+
+    /*
+     * Accumulate the moments, extrema and saturation count of a block of pixels.
+     */
+    void InairaFrameStatistics::calculateBlock(const uint16_t* data, std::size_t num_pixels,
+                                               uint64_t& sum, uint64_t& sum_sq)
+    {
+        std::size_t done = 0;
+        sum = 0;
+        sum_sq = 0;
+
+#ifdef INAIRA_X86_SIMD
+        if(use_avx2_)
+        {
+            uint16_t block_min, block_max;
+            uint64_t block_saturated;
+            done = block_moments_avx2(data, num_pixels, saturation_level,
+                                      block_min, block_max, sum, sum_sq, block_saturated);
+            if(done)
+            {
+                min = std::min<uint32_t>(min, block_min);
+                max = std::max<uint32_t>(max, block_max);
+                saturated += block_saturated;
+            }
+        }
+#endif
+
+        for(std::size_t i = done; i < num_pixels; i++)
+        {
+            uint32_t pixel = data[i];
+            min = std::min(min, pixel);
+            max = std::max(max, pixel);
+            sum += pixel;
+            sum_sq += static_cast<uint64_t>(pixel) * pixel;
+            saturated += (pixel >= saturation_level);
+        }
+    }
+
+    /*
+     * Fill the interleaved sub-histograms from a block of pixels. Pixels above the histogram range
+     * are counted in the last bin.
+     */
+    void InairaFrameStatistics::fillHistogram(const uint16_t* data, std::size_t num_pixels)
+    {
+        const uint32_t last_bin = histogram_bins - 1;
+        uint32_t* hist0 = &sub_histograms_[0];
+        uint32_t* hist1 = hist0 + histogram_bins;
+        uint32_t* hist2 = hist1 + histogram_bins;
+        uint32_t* hist3 = hist2 + histogram_bins;
+
+        std::size_t i = 0;
+        for(; i + 4 <= num_pixels; i += 4)
+        {
+            hist0[std::min<uint32_t>(data[i] >> histogram_shift_, last_bin)]++;
+            hist1[std::min<uint32_t>(data[i + 1] >> histogram_shift_, last_bin)]++;
+            hist2[std::min<uint32_t>(data[i + 2] >> histogram_shift_, last_bin)]++;
+            hist3[std::min<uint32_t>(data[i + 3] >> histogram_shift_, last_bin)]++;
+        }
+        for(; i < num_pixels; i++)
+        {
+            hist0[std::min<uint32_t>(data[i] >> histogram_shift_, last_bin)]++;
+        }
+    }
+}
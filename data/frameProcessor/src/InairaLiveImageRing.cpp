@@ -0,0 +1,163 @@
+
+#include <InairaLiveImageRing.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace FrameProcessor
+{
+    /*
+     * the constructor
+     */
+    InairaLiveImageRing::InairaLiveImageRing() :
+        num_slots(0),
+        max_image_size(0),
+        images_written(0),
+        images_skipped(0),
+        segment_(NULL),
+        segment_size_(0),
+        slot_size_(0)
+    {
+        logger_ = Logger::getLogger("FP.InairaLiveImageRing");
+    }
+
+    InairaLiveImageRing::~InairaLiveImageRing()
+    {
+        destroy();
+    }
+
+    /**
+     * Create and map the shared memory segment for the ring, replacing any existing segment of the
+     * same name.
+     *
+     * \param[in] name - POSIX shared memory name of the ring
+     * \param[in] num_slots - number of images held in the ring
+     * \param[in] max_image_size - largest image size in bytes that can be written to a slot
+     * \return true if the ring was created, false if it could not be or the name or number of
+     * slots is invalid
+     */
+    bool InairaLiveImageRing::create(const std::string& name, uint32_t num_slots, std::size_t max_image_size)
+    {
+        destroy();
+
+        if(name.empty() || num_slots == 0)
+        {
+            LOG4CXX_ERROR(logger_, "Invalid live image ring name '" << name << "' or number of slots "
+                          << num_slots);
+            return false;
+        }
+
+        this->name = (name[0] == '/') ? name : "/" + name;
+        this->num_slots = num_slots;
+        this->max_image_size = max_image_size;
+
+        // Round slots up to a cache line so each slot header and image starts aligned
+        slot_size_ = ((Inaira::LIVE_IMAGE_SLOT_HEADER_SIZE + max_image_size + 63) / 64) * 64;
+        segment_size_ = Inaira::LIVE_IMAGE_RING_HEADER_SIZE + (std::size_t)slot_size_ * num_slots;
+
+        int fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if(fd < 0)
+        {
+            LOG4CXX_ERROR(logger_, "Failed to open shared memory " << this->name << ": " << strerror(errno));
+            return false;
+        }
+        if(ftruncate(fd, segment_size_) != 0)
+        {
+            LOG4CXX_ERROR(logger_, "Failed to size shared memory " << this->name << ": " << strerror(errno));
+            close(fd);
+            shm_unlink(this->name.c_str());
+            return false;
+        }
+        void* addr = mmap(NULL, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if(addr == MAP_FAILED)
+        {
+            LOG4CXX_ERROR(logger_, "Failed to map shared memory " << this->name << ": " << strerror(errno));
+            shm_unlink(this->name.c_str());
+            return false;
+        }
+        segment_ = static_cast<uint8_t*>(addr);
+
+        Inaira::LiveImageRingHeader* header = reinterpret_cast<Inaira::LiveImageRingHeader*>(segment_);
+        header->version = Inaira::LIVE_IMAGE_RING_VERSION;
+        header->num_slots = num_slots;
+        header->slot_size = slot_size_;
+        header->max_image_size = max_image_size;
+        header->write_count = 0;
+        // Publish the magic last so readers never see a partially initialised header
+        __atomic_store_n(&header->magic, Inaira::LIVE_IMAGE_RING_MAGIC, __ATOMIC_RELEASE);
+
+        LOG4CXX_INFO(logger_, "Created live image ring " << this->name << " with " << num_slots
+                     << " slots of " << max_image_size << " bytes");
+        return true;
+    }
+
+    /**
+     * Unmap and remove the shared memory segment of the ring.
+     */
+    void InairaLiveImageRing::destroy(void)
+    {
+        if(segment_)
+        {
+            munmap(segment_, segment_size_);
+            shm_unlink(name.c_str());
+            segment_ = NULL;
+            segment_size_ = 0;
+        }
+    }
+
+    bool InairaLiveImageRing::isOpen(void) const
+    {
+        return segment_ != NULL;
+    }
+
+    /**
+     * Write a frame image into the next slot of the ring. The slot sequence is made odd for the
+     * duration of the write, then the write count is advanced to publish the slot as the newest.
+     *
+     * \param[in] frame - the frame to write
+     * \param[in] classification - index of the frame classification
+     * \param[in] score - score of the classification
+     * \return true if the image was written, false if it does not fit in a slot or is not 2-D
+     */
+    bool InairaLiveImageRing::write(boost::shared_ptr<Frame> frame, uint32_t classification, float score)
+    {
+        // Only row-major 2-D images can be shown, not e.g. packed frames with 1-D dimensions
+        const FrameMetaData& meta_data = frame->get_meta_data();
+        const dimensions_t& dims = meta_data.get_dimensions();
+        std::size_t image_size = frame->get_image_size();
+        if(!segment_ || image_size > max_image_size || dims.size() != 2)
+        {
+            images_skipped++;
+            return false;
+        }
+
+        Inaira::LiveImageRingHeader* header = reinterpret_cast<Inaira::LiveImageRingHeader*>(segment_);
+        uint64_t write_count = header->write_count;
+        uint8_t* slot_ptr = segment_ + Inaira::LIVE_IMAGE_RING_HEADER_SIZE
+            + (std::size_t)slot_size_ * (write_count % num_slots);
+        Inaira::LiveImageSlotHeader* slot = reinterpret_cast<Inaira::LiveImageSlotHeader*>(slot_ptr);
+
+        uint64_t sequence = slot->sequence;
+        __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        slot->frame_number = frame->get_frame_number();
+        slot->classification = classification;
+        slot->score = score;
+        slot->shape[0] = dims[0];
+        slot->shape[1] = dims[1];
+        slot->data_type = meta_data.get_data_type();
+        slot->image_size = image_size;
+        memcpy(slot_ptr + Inaira::LIVE_IMAGE_SLOT_HEADER_SIZE, frame->get_image_ptr(), image_size);
+
+        __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+        __atomic_store_n(&header->write_count, write_count + 1, __ATOMIC_RELEASE);
+
+        images_written++;
+        return true;
+    }
+}
@@ -1,6 +1,9 @@
 
 #include <InairaMLCppflow.h>
 
+#include <dirent.h>
+#include <sys/stat.h>
+
 namespace FrameProcessor
 {
     /*
@@ -8,10 +11,14 @@ namespace FrameProcessor
      */
     InairaMLCppflow::InairaMLCppflow() :
         input_layer_name("serving_default_input_1:0"),
-        output_layer_name("StatefulPartitionedCall:0")
+        output_layer_name("StatefulPartitionedCall:0"),
+        parameter_bytes(0),
+        warmed_up_(false)
     {
+        // Time the creation of the TensorFlow context as the first startup phase
+        Inaira::StartupPhase phase(startup, "tf_init");
+
         logger_ = Logger::getLogger("FP.InairaCppFlow");
-        logger_->setLevel(Level::getAll());
         LOG4CXX_TRACE(logger_, "Inaira cppflow link loaded");
 
         LOG4CXX_DEBUG(logger_, "SETTING GPU CONFIG OPTIONS");
@@ -32,6 +39,8 @@ namespace FrameProcessor
 
     bool InairaMLCppflow::loadModel(std::string file_name)
     {
+        Inaira::StartupPhase phase(startup, "model_load");
+
         /*we use a pointer to the model so we don't have to have it initialized straight away*/
         try{
 
@@ -42,6 +51,9 @@ namespace FrameProcessor
             LOG4CXX_ERROR(logger_, "Error loading model: " << e.what());
             return false;
         }
+        parameter_bytes = variablesSize(file_name);
+        LOG4CXX_INFO(logger_, "Loaded model " << file_name << " with " << parameter_bytes
+                     << " bytes of parameters");
         return true;
     }
 
@@ -69,7 +81,7 @@ namespace FrameProcessor
 
         }
 
-        LOG4CXX_DEBUG(logger_, "Extracting Frame Data");
+        INAIRA_HOTLOG_DEBUG(logger_, "Extracting Frame Data");
         const void* frame_data = frame->get_image_ptr();
         const FrameMetaData meta_data = frame->get_meta_data();
         std::size_t size = frame->get_image_size();
@@ -97,17 +109,59 @@ namespace FrameProcessor
         input = cppflow::expand_dims(input, 2);
         input = cppflow::expand_dims(input, 0);
 
-        LOG4CXX_DEBUG(logger_, "Running model on Frame Data");
+        /*The first inference initialises the graph and kernels, so is timed as the warm-up phase
+          that completes startup
+        */
+        uint64_t warm_up_start_ns = warmed_up_ ? 0 : Inaira::monotonic_clock_ns();
+
+        INAIRA_HOTLOG_DEBUG(logger_, "Running model on Frame Data");
         cppflow::model runable_model = *(model.get());
         cppflow::tensor result = runable_model({{input_layer_name, input}},
                                                {output_layer_name})[0];
+
+        if(!warmed_up_)
+        {
+            startup.record("warm_up", warm_up_start_ns, Inaira::monotonic_clock_ns());
+            startup.complete();
+            warmed_up_ = true;
+            LOG4CXX_INFO(logger_, "Model startup complete: " << startup.report());
+        }
         
-        LOG4CXX_DEBUG(logger_, "Returning Model Results");
+        INAIRA_HOTLOG_DEBUG(logger_, "Returning Model Results");
         std::vector<float> return_values = result.get_data<float>();
         
         return return_values;
     }
 
+    /*
+     * Calculate the size of the parameters of a SavedModel from the size of the variable data
+     * shards in its variables directory, which hold the raw values of every weight.
+     */
+    uint64_t InairaMLCppflow::variablesSize(const std::string& model_dir)
+    {
+        std::string variables_dir = model_dir + "/variables";
+        DIR* dir = opendir(variables_dir.c_str());
+        if(!dir)
+        {
+            return 0;
+        }
+
+        uint64_t size = 0;
+        struct dirent* entry;
+        while((entry = readdir(dir)) != NULL)
+        {
+            struct stat file_stat;
+            std::string name = entry->d_name;
+            if(name.compare(0, 15, "variables.data-") == 0 &&
+               stat((variables_dir + "/" + name).c_str(), &file_stat) == 0)
+            {
+                size += file_stat.st_size;
+            }
+        }
+        closedir(dir);
+        return size;
+    }
+
     void InairaMLCppflow::test_deallocator(void* buffer, std::size_t len, void* arg)
     {
         int* int_arg = static_cast<int*>(arg);
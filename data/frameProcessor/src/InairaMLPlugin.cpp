@@ -19,34 +19,128 @@ namespace FrameProcessor
     const std::string InairaMLPlugin::CONFIG_RESULT_DEST = "result_socket_addr";
     const std::string InairaMLPlugin::CONFIG_SEND_RESULTS = "send_results";
     const std::string InairaMLPlugin::CONFIG_SEND_IMAGE = "send_image";
+    const std::string InairaMLPlugin::CONFIG_ZERO_COPY_IMAGE = "zero_copy_image";
+    const std::string InairaMLPlugin::CONFIG_ZERO_COPY_MAX_FRAMES = "zero_copy_max_frames";
+    const std::string InairaMLPlugin::CONFIG_ZERO_COPY_MAX_HOLD = "zero_copy_max_hold_ms";
+    const std::string InairaMLPlugin::CONFIG_RESULT_BATCH_FRAMES = "result_batch_frames";
+    const std::string InairaMLPlugin::CONFIG_RESULT_BATCH_TIME = "result_batch_ms";
+    const std::string InairaMLPlugin::CONFIG_DEFECTIVE_STORAGE = "defective_storage";
+    const std::string InairaMLPlugin::CONFIG_DEFECTIVE_STORAGE_RATE = "defective_storage_rate";
+    const std::string InairaMLPlugin::CONFIG_GOOD_STORAGE = "good_storage";
+    const std::string InairaMLPlugin::CONFIG_GOOD_STORAGE_RATE = "good_storage_rate";
+    const std::string InairaMLPlugin::CONFIG_LIVE_VIEW_PLUGIN = "live_view_plugin";
+    const std::string InairaMLPlugin::CONFIG_HISTORY_PRE_FRAMES = "history_pre_frames";
+    const std::string InairaMLPlugin::CONFIG_HISTORY_POST_FRAMES = "history_post_frames";
+    const std::string InairaMLPlugin::CONFIG_HISTORY_MAX_MB = "history_max_mb";
+    const std::string InairaMLPlugin::CONFIG_HISTORY_COPY_FRAMES = "history_copy_frames";
+    const std::string InairaMLPlugin::CONFIG_LIVE_RING_NAME = "live_ring_name";
+    const std::string InairaMLPlugin::CONFIG_LIVE_RING_SLOTS = "live_ring_slots";
+    const std::string InairaMLPlugin::CONFIG_LIVE_RING_MAX_IMAGE_SIZE = "live_ring_max_image_size";
+    const std::string InairaMLPlugin::CONFIG_LIVE_RING_FRAME_FREQUENCY = "live_ring_frame_frequency";
+    const std::string InairaMLPlugin::CONFIG_CONVERT_8BIT = "convert_8bit";
+    const std::string InairaMLPlugin::CONFIG_WINDOW_LEVEL = "window_level";
+    const std::string InairaMLPlugin::CONFIG_WINDOW_WIDTH = "window_width";
+    const std::string InairaMLPlugin::CONFIG_WINDOW_GAMMA = "window_gamma";
+    const std::string InairaMLPlugin::CONFIG_SKIP_BLURRED = "skip_blurred";
+    const std::string InairaMLPlugin::CONFIG_VERIFY_CHECKSUM = "verify_checksum";
+    const std::string InairaMLPlugin::STORAGE_ALL = "all";
+    const std::string InairaMLPlugin::STORAGE_EVERY_N = "every_n";
+    const std::string InairaMLPlugin::STORAGE_PER_SECOND = "per_second";
+    const std::string InairaMLPlugin::STORAGE_NONE = "none";
 
 
     /**
      * The constructor
      */
     InairaMLPlugin::InairaMLPlugin() :
-        publish_socket_(ZMQ_PUB),
+        publish_socket_(OdinData::IpcContext::Instance().get(), ZMQ_PUB),
         is_bound_(false),
         decode_header(false),
+        live_ring_slots_(4),
+        live_ring_max_image_size_(0),
+        live_ring_frame_frequency_(1),
+        live_ring_frame_count_(0),
+        convert_8bit_(false),
+        frames_converted_(0),
+        skip_blurred_(false),
+        frames_skipped_blurred_(0),
+        frames_invalid_header_(0),
+        verify_checksum_(true),
+        frames_checksum_verified_(0),
+        frames_checksum_mismatched_(0),
         send_results_(false),
         send_image_(false),
+        zero_copy_image_(true),
+        zero_copy_max_frames_(4),
+        zero_copy_max_hold_(100),
+        socket_hold_limit_(0),
+        image_tracker_(new ImageReleaseTracker),
+        next_image_id_(0),
+        images_zero_copy_(0),
+        images_copied_(0),
+        result_batch_frames_(0),
+        result_batch_time_(0),
+        result_batch_start_(0),
+        result_batches_sent_(0),
+        stop_batch_flush_(false),
         avg_process_time(0),
         total_process_time(0),
         num_processed(0)
     {
         //Setup logging
         logger_ = Logger::getLogger("FP.InairaMLPlugin");
-        logger_->setLevel(Level::getAll());
         LOG4CXX_TRACE(logger_, "InairaMLPlugin version " <<
                       this->get_version_long() << " loaded.");
 
         classes[0] = "Bad";
         classes[1] = "Good";
+        datasets[0] = "defective";
+        datasets[1] = "good";
+
+        for(int i = 0; i < 2; i++)
+        {
+            storage_[i].mode = STORAGE_ALL;
+            storage_[i].rate = 1;
+            storage_[i].frames_seen = 0;
+            storage_[i].window_count = 0;
+            storage_[i].window_start = 0;
+            storage_[i].written = 0;
+            storage_[i].dropped = 0;
+        }
+
+        image_tracker_->max_hold_time = 0;
+
+        // Bind the counters and latency histograms published to the shared memory metrics page
+        metrics_.bind("frames_invalid_header", frames_invalid_header_, Inaira::MetricCounter);
+        metrics_.bind("checksum/frames_verified", frames_checksum_verified_, Inaira::MetricCounter);
+        metrics_.bind("checksum/frames_mismatched", frames_checksum_mismatched_, Inaira::MetricCounter);
+        metrics_.bind("frames_skipped_blurred", frames_skipped_blurred_, Inaira::MetricCounter);
+        metrics_.bind("frames_converted", frames_converted_, Inaira::MetricCounter);
+        metrics_.bind("result_batches_sent", result_batches_sent_, Inaira::MetricCounter);
+        for(int i = 0; i < 2; i++)
+        {
+            metrics_.bind("storage/" + datasets[i] + "/written", storage_[i].written, Inaira::MetricCounter);
+            metrics_.bind("storage/" + datasets[i] + "/dropped", storage_[i].dropped, Inaira::MetricCounter);
+        }
+        metrics_.bind("live_ring/images_written", live_ring_.images_written, Inaira::MetricCounter);
+        metrics_.bind("images_zero_copy", images_zero_copy_, Inaira::MetricCounter);
+        metrics_.bind("images_copied", images_copied_, Inaira::MetricCounter);
+        ready_to_process_latency_.bindMetrics(metrics_, "latency/ready_to_process/");
+        process_to_result_latency_.bindMetrics(metrics_, "latency/process_to_result/");
+        total_latency_.bindMetrics(metrics_, "latency/total/");
+
+        batch_flush_thread_.reset(new boost::thread(&InairaMLPlugin::batchFlushLoop, this));
     }
 
     InairaMLPlugin::~InairaMLPlugin()
     {
         LOG4CXX_TRACE(logger_, "InairaMLPlugin Destructor.");
+        {
+            boost::lock_guard<boost::mutex> lock(publish_mutex_);
+            stop_batch_flush_ = true;
+            batch_flush_cond_.notify_all();
+        }
+        batch_flush_thread_->join();
     }
 
 
@@ -55,13 +149,95 @@ namespace FrameProcessor
      * to configure the plugin, and any response can be added to the reply IpcMessage.  This
      * plugin supports the following configuration parameters:
      * 
-     * - xx_      <=> xx
+     * - zero_copy_image_      <=> zero_copy_image
+     * - zero_copy_max_frames_ <=> zero_copy_max_frames
+     * - zero_copy_max_hold_   <=> zero_copy_max_hold_ms
+     * - result_batch_frames_  <=> result_batch_frames
+     * - result_batch_time_    <=> result_batch_ms
+     *
+     * - storage_[0]        <=> defective_storage, defective_storage_rate
+     * - storage_[1]        <=> good_storage, good_storage_rate
+     * - live_view_plugin_  <=> live_view_plugin
+     *
+     * The storage mode of each class is one of "all", "every_n" (forward 1 in every rate frames),
+     * "per_second" (forward up to rate frames per second) or "none". Frames that are not stored
+     * are dropped, or passed only to the named live view plugin if one is configured.
+     *
+     * - history_           <=> history_pre_frames, history_post_frames, history_max_mb,
+     *                          history_copy_frames
+     *
+     * When the frame history is enabled, frames that are not stored are held in a ring of up to
+     * history_pre_frames frames (and history_max_mb megabytes). On a defective classification the
+     * ring is flushed downstream ahead of the defective frame, and the next history_post_frames
+     * frames are forwarded for storage regardless of their storage policy. Setting
+     * history_copy_frames holds copies of the images, releasing the shared memory buffers.
+     *
+     * - live_ring_         <=> live_ring_name, live_ring_slots, live_ring_max_image_size,
+     *                          live_ring_frame_frequency
+     *
+     * When live_ring_name is set, every live_ring_frame_frequency-th frame is also written with its
+     * classification and score into a shared memory ring of live_ring_slots images for readers on
+     * the same host. The ring is created on the next frame, sized for live_ring_max_image_size
+     * bytes per image, or for the size of that frame if zero. live_ring_slots must be at least 1.
+     *
+     * - convert_8bit_      <=> convert_8bit
+     * - window_lut_        <=> window_level, window_width, window_gamma
+     *
+     * When convert_8bit is set, uint16 frames are converted in place to uint8 before the model is
+     * run, mapping window_width pixel values centred on window_level to the uint8 range with the
+     * given gamma. Downstream plugins receive the converted uint8 frame.
+     *
+     * - skip_blurred_      <=> skip_blurred
+     *
+     * When skip_blurred is set, frames tagged as blurred by an upstream plugin are not run through
+     * the model. They are passed only to the live view plugin, if one is configured. Frames are
+     * tagged by PcoCameraProcessPlugin with compute_focus set, which decodes the frame header
+     * itself, so decode_header is normally false in this plugin when chained after it.
+     *
+     * - verify_checksum_   <=> verify_checksum
+     *
+     * When decode_header and verify_checksum are set, frames whose header carries a payload CRC32C
+     * calculated by the receiver are verified. Mismatched frames are counted, logged and tagged
+     * with the "payload_checksum_error" metadata parameter, but are still processed.
+     *
+     * When zero_copy_image is set, live images reference the frame data directly rather than being
+     * copied, holding the shared memory buffer until ZeroMQ releases the message. New images are
+     * copied instead while zero_copy_max_frames images are held, or the oldest held image has
+     * been held for longer than zero_copy_max_hold_ms. ZeroMQ cannot drop a message once it is
+     * queued to a subscriber, so the hold time is bounded by heartbeating the result socket
+     * connections every half limit: a subscriber that has not read up to a heartbeat by the end of
+     * the limit is disconnected, releasing the images queued to it, and reconnects for later images.
+     * Images are always copied if the socket is not bound with heartbeats for the current limit,
+     * e.g. with a ZeroMQ library too old to support them or a limit below 2 ms. The limit, whether
+     * it is enforced, the number of images held and the age of the oldest are reported in status.
+     *
+     * Results are batched when either result_batch_frames is greater than one or result_batch_ms
+     * is non-zero. A batch is sent once it holds result_batch_frames results or result_batch_ms
+     * has elapsed since its first result, whichever comes first.
+     *
+     * - tracer_           <=> trace, trace_dump
+     *
+     * When trace is set, the decode, preprocess, inference, publish and push spans of each frame
+     * are recorded, and written as Chrome trace event JSON to the file given by trace_dump.
+     *
+     * - metrics_          <=> metrics
+     * - perf_             <=> perf_counters
+     *
+     * When metrics is set to a shared memory name, the frame counters and latency histograms are
+     * published to a metrics page of that name after every frame. An empty name stops publishing.
+     *
+     * When perf_counters is set, hardware performance counters are read around the preprocess,
+     * inference, live_ring_copy and history_store stages, and the instructions per cycle and cache
+     * and branch miss rates of each stage are reported in status.
      *
      * \param[in] config - Reference to the configuration IpcMessage object.
      * \param[in] reply - Reference to the reply IpcMessage object.
      */
     void InairaMLPlugin::configure(OdinData::IpcMessage& config, OdinData::IpcMessage& reply)
     {
+        configureTracing(config, reply);
+        configureMetrics(config, reply);
+        configurePerfCounters(config, reply);
 
         if(config.has_param(InairaMLPlugin::CONFIG_MODEL_INPUT_LAYER))
         {
@@ -86,10 +262,143 @@ namespace FrameProcessor
         {
             send_image_ = config.get_param<bool>(InairaMLPlugin::CONFIG_SEND_IMAGE);
         }
+        if(config.has_param(InairaMLPlugin::CONFIG_ZERO_COPY_IMAGE))
+        {
+            zero_copy_image_ = config.get_param<bool>(InairaMLPlugin::CONFIG_ZERO_COPY_IMAGE);
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_ZERO_COPY_MAX_FRAMES))
+        {
+            zero_copy_max_frames_ = config.get_param<unsigned int>(InairaMLPlugin::CONFIG_ZERO_COPY_MAX_FRAMES);
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_ZERO_COPY_MAX_HOLD))
+        {
+            zero_copy_max_hold_ = config.get_param<unsigned int>(InairaMLPlugin::CONFIG_ZERO_COPY_MAX_HOLD);
+        }
+        {
+            boost::lock_guard<boost::mutex> lock(publish_mutex_);
+            if(config.has_param(InairaMLPlugin::CONFIG_RESULT_BATCH_FRAMES))
+            {
+                result_batch_frames_ = config.get_param<unsigned int>(InairaMLPlugin::CONFIG_RESULT_BATCH_FRAMES);
+            }
+            if(config.has_param(InairaMLPlugin::CONFIG_RESULT_BATCH_TIME))
+            {
+                result_batch_time_ = config.get_param<unsigned int>(InairaMLPlugin::CONFIG_RESULT_BATCH_TIME);
+            }
+            // Flush any partial batch if batching has been switched off, and wake the flush
+            // thread to apply a changed time window
+            if(!batchingResults() && !result_batch_.empty())
+            {
+                sendResultBatch();
+            }
+            batch_flush_cond_.notify_all();
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_DEFECTIVE_STORAGE_RATE))
+        {
+            storage_[0].rate = config.get_param<unsigned int>(InairaMLPlugin::CONFIG_DEFECTIVE_STORAGE_RATE);
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_GOOD_STORAGE_RATE))
+        {
+            storage_[1].rate = config.get_param<unsigned int>(InairaMLPlugin::CONFIG_GOOD_STORAGE_RATE);
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_DEFECTIVE_STORAGE))
+        {
+            if(!setStoragePolicy(storage_[0], config.get_param<std::string>(InairaMLPlugin::CONFIG_DEFECTIVE_STORAGE)))
+            {
+                reply.set_nack("Invalid defective frame storage mode");
+            }
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_GOOD_STORAGE))
+        {
+            if(!setStoragePolicy(storage_[1], config.get_param<std::string>(InairaMLPlugin::CONFIG_GOOD_STORAGE)))
+            {
+                reply.set_nack("Invalid good frame storage mode");
+            }
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_LIVE_VIEW_PLUGIN))
+        {
+            live_view_plugin_ = config.get_param<std::string>(InairaMLPlugin::CONFIG_LIVE_VIEW_PLUGIN);
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_HISTORY_PRE_FRAMES) ||
+           config.has_param(InairaMLPlugin::CONFIG_HISTORY_POST_FRAMES) ||
+           config.has_param(InairaMLPlugin::CONFIG_HISTORY_MAX_MB) ||
+           config.has_param(InairaMLPlugin::CONFIG_HISTORY_COPY_FRAMES))
+        {
+            uint32_t pre_frames = config.get_param<unsigned int>(
+                InairaMLPlugin::CONFIG_HISTORY_PRE_FRAMES, history_.pre_frames);
+            uint32_t post_frames = config.get_param<unsigned int>(
+                InairaMLPlugin::CONFIG_HISTORY_POST_FRAMES, history_.post_frames);
+            std::size_t max_mb = config.get_param<unsigned int>(
+                InairaMLPlugin::CONFIG_HISTORY_MAX_MB, history_.max_bytes / (1024 * 1024));
+            bool copy_frames = config.get_param<bool>(
+                InairaMLPlugin::CONFIG_HISTORY_COPY_FRAMES, history_.copy_frames);
+            history_.configure(pre_frames, post_frames, max_mb * 1024 * 1024, copy_frames);
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_LIVE_RING_NAME) ||
+           config.has_param(InairaMLPlugin::CONFIG_LIVE_RING_SLOTS) ||
+           config.has_param(InairaMLPlugin::CONFIG_LIVE_RING_MAX_IMAGE_SIZE))
+        {
+            // The ring is written on the processing thread, so hold the lock while it is replaced
+            boost::lock_guard<boost::mutex> lock(live_ring_mutex_);
+            uint32_t slots = config.get_param<unsigned int>(
+                InairaMLPlugin::CONFIG_LIVE_RING_SLOTS, live_ring_slots_);
+            if(slots == 0)
+            {
+                reply.set_nack("Number of live image ring slots must be at least 1");
+            }
+            else
+            {
+                live_ring_name_ = config.get_param<std::string>(
+                    InairaMLPlugin::CONFIG_LIVE_RING_NAME, live_ring_name_);
+                live_ring_slots_ = slots;
+                live_ring_max_image_size_ = config.get_param<unsigned int>(
+                    InairaMLPlugin::CONFIG_LIVE_RING_MAX_IMAGE_SIZE, live_ring_max_image_size_);
+
+                // The ring is recreated with the new settings on the next frame
+                live_ring_.destroy();
+            }
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_LIVE_RING_FRAME_FREQUENCY))
+        {
+            live_ring_frame_frequency_ = config.get_param<unsigned int>(InairaMLPlugin::CONFIG_LIVE_RING_FRAME_FREQUENCY);
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_CONVERT_8BIT))
+        {
+            convert_8bit_ = config.get_param<bool>(InairaMLPlugin::CONFIG_CONVERT_8BIT);
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_WINDOW_LEVEL) ||
+           config.has_param(InairaMLPlugin::CONFIG_WINDOW_WIDTH) ||
+           config.has_param(InairaMLPlugin::CONFIG_WINDOW_GAMMA))
+        {
+            uint32_t level = config.get_param<unsigned int>(
+                InairaMLPlugin::CONFIG_WINDOW_LEVEL, window_lut_.level);
+            uint32_t width = config.get_param<unsigned int>(
+                InairaMLPlugin::CONFIG_WINDOW_WIDTH, window_lut_.width);
+            double gamma = config.get_param<double>(
+                InairaMLPlugin::CONFIG_WINDOW_GAMMA, window_lut_.gamma);
+            if(!window_lut_.configure(level, width, gamma))
+            {
+                LOG4CXX_ERROR(logger_, "Invalid window configuration: level " << level
+                    << " width " << width << " gamma " << gamma);
+                reply.set_nack("Invalid window configuration");
+            }
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_SKIP_BLURRED))
+        {
+            skip_blurred_ = config.get_param<bool>(InairaMLPlugin::CONFIG_SKIP_BLURRED);
+        }
+        if(config.has_param(InairaMLPlugin::CONFIG_VERIFY_CHECKSUM))
+        {
+            verify_checksum_ = config.get_param<bool>(InairaMLPlugin::CONFIG_VERIFY_CHECKSUM);
+        }
         if(config.has_param(InairaMLPlugin::CONFIG_RESULT_DEST))
         {
             setSocketAddr(config.get_param<std::string>(InairaMLPlugin::CONFIG_RESULT_DEST));
         }
+        else if(is_bound_ && socket_hold_limit_ != zero_copy_max_hold_)
+        {
+            // Rebind so that subscribers reconnect with heartbeats for the new hold limit
+            setSocketAddr(data_socket_addr_);
+        }
         //send configuration to the plugin
         if(config.has_param(InairaMLPlugin::CONFIG_MODEL_PATH))
         {
@@ -97,6 +406,10 @@ namespace FrameProcessor
                 InairaMLPlugin::CONFIG_MODEL_PATH
             );
             model_.loadModel(model_path);
+
+            // Sample the memory usage with the model loaded, before any frames are processed
+            boost::lock_guard<boost::mutex> lock(memory_mutex_);
+            memory_.read();
         }
     }
 
@@ -108,6 +421,33 @@ namespace FrameProcessor
         reply.set_param(base_str + InairaMLPlugin::CONFIG_MODEL_PATH, model_path);
         reply.set_param(base_str + InairaMLPlugin::CONFIG_MODEL_INPUT_LAYER, model_.input_layer_name);
         reply.set_param(base_str + InairaMLPlugin::CONFIG_MODEL_OUTPUT_LAYER, model_.output_layer_name);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_ZERO_COPY_IMAGE, zero_copy_image_);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_ZERO_COPY_MAX_FRAMES, zero_copy_max_frames_);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_ZERO_COPY_MAX_HOLD, zero_copy_max_hold_);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_RESULT_BATCH_FRAMES, result_batch_frames_);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_RESULT_BATCH_TIME, result_batch_time_);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_DEFECTIVE_STORAGE, storage_[0].mode);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_DEFECTIVE_STORAGE_RATE, storage_[0].rate);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_GOOD_STORAGE, storage_[1].mode);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_GOOD_STORAGE_RATE, storage_[1].rate);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_LIVE_VIEW_PLUGIN, live_view_plugin_);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_HISTORY_PRE_FRAMES, history_.pre_frames);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_HISTORY_POST_FRAMES, history_.post_frames);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_HISTORY_MAX_MB, (uint32_t)(history_.max_bytes / (1024 * 1024)));
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_HISTORY_COPY_FRAMES, history_.copy_frames);
+        {
+            boost::lock_guard<boost::mutex> lock(live_ring_mutex_);
+            reply.set_param(base_str + InairaMLPlugin::CONFIG_LIVE_RING_NAME, live_ring_name_);
+            reply.set_param(base_str + InairaMLPlugin::CONFIG_LIVE_RING_SLOTS, live_ring_slots_);
+            reply.set_param(base_str + InairaMLPlugin::CONFIG_LIVE_RING_MAX_IMAGE_SIZE, live_ring_max_image_size_);
+        }
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_LIVE_RING_FRAME_FREQUENCY, live_ring_frame_frequency_);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_CONVERT_8BIT, convert_8bit_);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_WINDOW_LEVEL, window_lut_.level);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_WINDOW_WIDTH, window_lut_.width);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_WINDOW_GAMMA, window_lut_.gamma);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_SKIP_BLURRED, skip_blurred_);
+        reply.set_param(base_str + InairaMLPlugin::CONFIG_VERIFY_CHECKSUM, verify_checksum_);
     }
 
     void InairaMLPlugin::status(OdinData::IpcMessage& status)
@@ -116,9 +456,64 @@ namespace FrameProcessor
         LOG4CXX_DEBUG(logger_, "Status requested for InairaMLPlugin");
 
         std::string base_str = get_name() + "/";
+        perf_.status(status, base_str + "perf/");
         status.set_param(base_str + "avg_process_time", avg_process_time);
         status.set_param(base_str + "num_processed", num_processed);
+        status.set_param(base_str + "result_batches_sent", result_batches_sent_);
+        status.set_param(base_str + "frames_converted", frames_converted_);
+        status.set_param(base_str + "frames_skipped_blurred", frames_skipped_blurred_);
+        status.set_param(base_str + "frames_invalid_header", frames_invalid_header_);
+        status.set_param(base_str + "checksum/frames_verified", frames_checksum_verified_);
+        status.set_param(base_str + "checksum/frames_mismatched", frames_checksum_mismatched_);
 
+        // The heap figures count every malloc allocation in the process, the TensorFlow CPU
+        // allocator among them. The heap peak is sampled once per frame after inference, while
+        // rss_peak_bytes is tracked by the kernel and so also covers transients within inference.
+        {
+            boost::lock_guard<boost::mutex> lock(memory_mutex_);
+            memory_.read();
+            status.set_param(base_str + "memory/rss_bytes", memory_.rss_bytes);
+            status.set_param(base_str + "memory/rss_peak_bytes", memory_.rss_peak_bytes);
+            status.set_param(base_str + "memory/virtual_bytes", memory_.virtual_bytes);
+            status.set_param(base_str + "memory/heap_in_use_bytes", memory_.heap_in_use_bytes);
+            status.set_param(base_str + "memory/heap_peak_bytes", memory_.heap_peak_bytes);
+        }
+        status.set_param(base_str + "model/parameter_bytes", model_.parameter_bytes);
+        model_.startup.status(status, base_str + "startup/");
+        {
+            boost::lock_guard<boost::mutex> lock(latency_mutex_);
+            ready_to_process_latency_.status(status, base_str + "latency/ready_to_process/");
+            process_to_result_latency_.status(status, base_str + "latency/process_to_result/");
+            total_latency_.status(status, base_str + "latency/total/");
+        }
+        for(int i = 0; i < 2; i++)
+        {
+            status.set_param(base_str + "storage/" + datasets[i] + "/written", storage_[i].written);
+            status.set_param(base_str + "storage/" + datasets[i] + "/dropped", storage_[i].dropped);
+        }
+        status.set_param(base_str + "history/frames_held", history_.frames_held);
+        status.set_param(base_str + "history/bytes_held", (uint64_t)history_.bytes_held);
+        status.set_param(base_str + "history/frames_flushed", history_.frames_flushed);
+        status.set_param(base_str + "history/frames_evicted", history_.frames_evicted);
+        status.set_param(base_str + "history/triggers", history_.triggers);
+        status.set_param(base_str + "live_ring/images_written", live_ring_.images_written);
+        status.set_param(base_str + "live_ring/images_skipped", live_ring_.images_skipped);
+
+        boost::lock_guard<boost::mutex> lock(image_tracker_->mutex);
+        status.set_param(base_str + "images_zero_copy", images_zero_copy_);
+        status.set_param(base_str + "images_copied", images_copied_);
+        status.set_param(base_str + "images_held", (uint32_t)image_tracker_->held_images.size());
+        status.set_param(base_str + "max_image_hold_ms", image_tracker_->max_hold_time);
+        uint32_t oldest_hold_time = 0;
+        if(!image_tracker_->held_images.empty())
+        {
+            oldest_hold_time = (Inaira::monotonic_clock_ns() -
+                image_tracker_->held_images.begin()->second) / 1000000;
+        }
+        status.set_param(base_str + "oldest_image_hold_ms", oldest_hold_time);
+        status.set_param(base_str + "image_hold_limit_ms", zero_copy_max_hold_);
+        status.set_param(base_str + "image_hold_limit_enforced", holdLimitEnforced());
+        status.set_param(base_str + "image_hold_limit_exceeded", oldest_hold_time > zero_copy_max_hold_);
 
     }
 
@@ -126,19 +521,72 @@ namespace FrameProcessor
     {
         total_process_time = 0;
         num_processed = 0;
+        images_zero_copy_ = 0;
+        images_copied_ = 0;
+        result_batches_sent_ = 0;
+        frames_converted_ = 0;
+        frames_skipped_blurred_ = 0;
+        frames_invalid_header_ = 0;
+        frames_checksum_verified_ = 0;
+        frames_checksum_mismatched_ = 0;
+        {
+            boost::lock_guard<boost::mutex> lock(latency_mutex_);
+            ready_to_process_latency_.reset();
+            process_to_result_latency_.reset();
+            total_latency_.reset();
+        }
+        for(int i = 0; i < 2; i++)
+        {
+            storage_[i].written = 0;
+            storage_[i].dropped = 0;
+        }
+        history_.resetStatistics();
+        live_ring_.images_written = 0;
+        live_ring_.images_skipped = 0;
+
+        boost::lock_guard<boost::mutex> lock(image_tracker_->mutex);
+        image_tracker_->max_hold_time = 0;
         return true;
     }
 
     void InairaMLPlugin::process_frame(boost::shared_ptr<Frame> frame)
     {
-        LOG4CXX_DEBUG(logger_, "Process Frame Called");
+        INAIRA_HOTLOG_DEBUG(logger_, "Process frame {} called", frame->get_frame_number());
+        uint64_t process_start_ns = Inaira::monotonic_clock_ns();
         boost::posix_time::ptime then = boost::posix_time::microsec_clock::local_time();
-        if(decode_header)
+        if(decode_header && !decodeHeader(frame))
+        {
+            metrics_.publish();
+            return;
+        }
+        if(skip_blurred_ && frame->get_meta_data().has_parameter("blurred") &&
+           frame->get_meta_data().get_parameter<bool>("blurred"))
+        {
+            INAIRA_HOTLOG_DEBUG(logger_, "Skipping blurred frame {}", frame->get_frame_number());
+            frames_skipped_blurred_++;
+            metrics_.publish();
+            if(!live_view_plugin_.empty())
+            {
+                this->push(live_view_plugin_, frame);
+            }
+            return;
+        }
+        if(convert_8bit_ && frame->get_meta_data().get_data_type() == raw_16bit)
         {
-            decodeHeader(frame);
+            convertFrame(frame);
         }
 
+        Inaira::TraceSpan inference_span(tracer_, "inference", frame->get_frame_number());
+        Inaira::PerfStageSpan inference_perf_span(perf_, "inference");
         std::vector<float> result = model_.runModel(frame);
+        inference_perf_span.end();
+        inference_span.end();
+        {
+            // Sample the heap while the model outputs are still held, so that the heap peak
+            // follows the frames rather than the status requests
+            boost::lock_guard<boost::mutex> lock(memory_mutex_);
+            memory_.sampleHeap();
+        }
         boost::posix_time::ptime now = boost::posix_time::microsec_clock::local_time();
         uint32_t frame_process_time = (now - then).total_milliseconds();
         
@@ -147,80 +595,389 @@ namespace FrameProcessor
         num_processed += 1;
         avg_process_time = total_process_time / num_processed;
 
-        LOG4CXX_DEBUG(logger_, "Frame Processing took " << frame_process_time <<"ms");
-        LOG4CXX_DEBUG(logger_, "Average Processing time over " << num_processed << "Frames: " << avg_process_time);
+        INAIRA_HOTLOG_DEBUG(logger_, "Frame Processing took {}ms", frame_process_time);
+        INAIRA_HOTLOG_DEBUG(logger_, "Average Processing time over {} Frames: {}", num_processed, avg_process_time);
 
         int max = int(std::distance(result.begin(), max_element(result.begin(), result.end())));
-        LOG4CXX_DEBUG(logger_, "Image Result: " << classes[max] << ", score: " << result[max]);
-        if(max == 0)
-            frame->meta_data().set_dataset_name("defective");
-        else
-            frame->meta_data().set_dataset_name("good");
+        INAIRA_HOTLOG_DEBUG(logger_, "Image Result: {}, score: {}", classes[max], result[max]);
+        frame->meta_data().set_dataset_name(datasets[max]);
+
+        writeLiveRing(frame, max, result[max]);
 
+        Inaira::TraceSpan publish_span(tracer_, "publish", frame->get_frame_number());
+        boost::unique_lock<boost::mutex> publish_lock(publish_mutex_);
         if(send_results_)
         {
             std::string results = sendResults(frame->get_frame_number(), frame_process_time, result);
 
-            if(send_image_)
+            if(batchingResults())
+            {
+                // Batched results are sent on their own, so images go out without a results part
+                batchResults(results);
+                if(send_image_)
+                {
+                    InairaMLPlugin::LiveImageData live_image = sendImage(frame);
+                    publishImage(frame, live_image);
+                }
+            }
+            else if(send_image_)
             {
                 InairaMLPlugin::LiveImageData live_image = sendImage(frame);
-                publish_socket_.send(results, ZMQ_SNDMORE);
-                publish_socket_.send(live_image.json_header, ZMQ_SNDMORE);
-                publish_socket_.send(frame->get_image_size(), live_image.frame_data_ptr, 0);
-
+                publish_socket_.send(results.data(), results.size(), ZMQ_SNDMORE);
+                publishImage(frame, live_image);
             }
             else
             {
-                publish_socket_.send(results);
+                publish_socket_.send(results.data(), results.size(), 0);
             }
         }
         else
         {
             if(send_image_)
             {
-            InairaMLPlugin::LiveImageData live_image = sendImage(frame);
-            publish_socket_.send(live_image.json_header, ZMQ_SNDMORE);
-            publish_socket_.send(frame->get_image_size(), live_image.frame_data_ptr, 0);
+                InairaMLPlugin::LiveImageData live_image = sendImage(frame);
+                publishImage(frame, live_image);
+            }
+        }
+
+        publish_lock.unlock();
+        publish_span.end();
+        recordLatency(frame, process_start_ns);
+        metrics_.publish();
+
+        Inaira::TraceSpan push_span(tracer_, "push", frame->get_frame_number());
+        bool store = storeFrame(storage_[max]);
+        if(history_.enabled())
+        {
+            // Frames following a defective frame are stored as context
+            store |= history_.postTriggerFrame();
+
+            // Flush the frames held before a defective frame downstream ahead of it
+            if(max == 0)
+            {
+                std::vector<boost::shared_ptr<Frame> > context = history_.trigger();
+                INAIRA_HOTLOG_DEBUG(logger_, "Flushing {} history frames before defective frame", context.size());
+                for(std::size_t i = 0; i < context.size(); i++)
+                {
+                    this->push(context[i]);
+                }
+            }
+        }
+
+        if(store)
+        {
+            this->push(frame);
+        }
+        else
+        {
+            Inaira::PerfStageSpan perf_span(perf_, "history_store");
+            history_.store(frame);
+            perf_span.end();
+            if(!live_view_plugin_.empty())
+            {
+                this->push(live_view_plugin_, frame);
             }
         }
-        this->push(frame);
     }
 
-    void InairaMLPlugin::decodeHeader(boost::shared_ptr<Frame> frame)
+    /**
+     * Send any partially filled result batch at the end of an acquisition, so that consumers
+     * are not left waiting for the results of the final frames, and release the frame history.
+     */
+    void InairaMLPlugin::process_end_of_acquisition(void)
     {
-        LOG4CXX_DEBUG(logger_, "Decoding Frame Header");
+        // Release any frames held in the history so their buffers are returned
+        history_.clear();
+
+        boost::lock_guard<boost::mutex> lock(publish_mutex_);
+        if(!result_batch_.empty())
+        {
+            sendResultBatch();
+        }
+    }
+
+    /**
+     * Decode the frame header at the start of the frame buffer into the frame metadata. The host
+     * acquisition timestamps are added as metadata parameters when valid. Frames without a valid
+     * header of the current version, or whose image does not fit in the frame buffer, are counted
+     * and dropped. The decoded fields update a copy of the existing metadata, so that parameters
+     * tagged by an upstream plugin, e.g. blurred, are kept.
+     *
+     * \param[in] frame - the frame to decode
+     * \return true if the header is valid, false otherwise
+     */
+    bool InairaMLPlugin::decodeHeader(boost::shared_ptr<Frame> frame)
+    {
+        INAIRA_HOTLOG_DEBUG(logger_, "Decoding Frame Header");
         
+        Inaira::TraceSpan span(tracer_, "decode", frame->get_frame_number());
         Inaira::FrameHeader* hdr_ptr = static_cast<Inaira::FrameHeader*>(frame->get_data_ptr());
 
-            FrameMetaData metadata;
+        if(!Inaira::valid_frame_header(hdr_ptr))
+        {
+            LOG4CXX_ERROR(logger_, "Dropping frame with invalid header: magic 0x" << std::hex
+                << hdr_ptr->magic << std::dec << " version " << hdr_ptr->version
+                << " size " << hdr_ptr->header_size);
+            frames_invalid_header_++;
+            return false;
+        }
+
+        // Drop frames whose image does not fit in the frame buffer, as conversion and inference
+        // walk the image from its offset
+        if(!Inaira::valid_frame_image(hdr_ptr, frame->get_data_size(),
+            dataTypeSize((DataType)hdr_ptr->frame_data_type)))
+        {
+            LOG4CXX_ERROR(logger_, "Dropping frame number " << hdr_ptr->frame_number
+                << " with invalid image: offset " << hdr_ptr->image_offset
+                << " size " << hdr_ptr->frame_size
+                << " for " << hdr_ptr->frame_width << "x" << hdr_ptr->frame_height
+                << " pixels in a buffer of " << frame->get_data_size() << " bytes");
+            frames_invalid_header_++;
+            return false;
+        }
+
+        // Verify the payload CRC32C calculated by the receiver on acquisition
+        bool checksum_error = false;
+        if(verify_checksum_ && (hdr_ptr->status_flags & Inaira::FramePayloadChecksum))
+        {
+            Inaira::TraceSpan checksum_span(tracer_, "checksum", frame->get_frame_number());
+            Inaira::PerfStageSpan checksum_perf_span(perf_, "checksum");
+            if(Inaira::valid_payload_checksum(hdr_ptr))
+            {
+                frames_checksum_verified_++;
+            }
+            else
+            {
+                LOG4CXX_ERROR(logger_, "Payload checksum mismatch for frame number "
+                    << hdr_ptr->frame_number << ": header CRC 0x" << std::hex
+                    << hdr_ptr->payload_crc << std::dec);
+                frames_checksum_mismatched_++;
+                checksum_error = true;
+            }
+        }
+
+            FrameMetaData metadata = frame->get_meta_data_copy();
 
             metadata.set_dataset_name("inaira");
             metadata.set_data_type((DataType)hdr_ptr->frame_data_type);
             metadata.set_frame_number(hdr_ptr->frame_number);
             metadata.set_compression_type(no_compression);
             dimensions_t dims(2);
-            dims[1] = hdr_ptr->frame_height;
-            dims[0] = hdr_ptr->frame_width;
+            dims[0] = hdr_ptr->frame_height;
+            dims[1] = hdr_ptr->frame_width;
             metadata.set_dimensions(dims);
+            metadata.set_parameter<uint32_t>("frame_status_flags", hdr_ptr->status_flags);
+            if(hdr_ptr->status_flags & Inaira::FrameHostTimestamps)
+            {
+                metadata.set_parameter<uint64_t>("acquisition_start_ns",
+                    hdr_ptr->acquisition_start_ns);
+                metadata.set_parameter<uint64_t>("acquisition_end_ns",
+                    hdr_ptr->acquisition_end_ns);
+            }
+            if(hdr_ptr->status_flags & Inaira::FrameMonotonicTimestamps)
+            {
+                metadata.set_parameter<uint64_t>("grab_mono_ns", hdr_ptr->grab_mono_ns);
+                metadata.set_parameter<uint64_t>("ready_mono_ns", hdr_ptr->ready_mono_ns);
+            }
+            if(hdr_ptr->status_flags & Inaira::FrameCameraTimestamp)
+            {
+                metadata.set_parameter<uint32_t>("camera_image_number",
+                    hdr_ptr->camera_image_number);
+                metadata.set_parameter<uint64_t>("camera_timestamp", hdr_ptr->camera_timestamp);
+            }
+            if(hdr_ptr->status_flags & Inaira::FramePayloadChecksum)
+            {
+                metadata.set_parameter<uint32_t>("payload_crc", hdr_ptr->payload_crc);
+                if(checksum_error)
+                {
+                    metadata.set_parameter<bool>("payload_checksum_error", true);
+                }
+            }
 
             frame->set_meta_data(metadata);
-            frame->set_image_offset(sizeof(Inaira::FrameHeader));
-            frame->set_image_size(hdr_ptr->frame_height*hdr_ptr->frame_width * sizeof(uint8_t));
+            frame->set_image_offset(hdr_ptr->image_offset);
+            frame->set_image_size(hdr_ptr->frame_height*hdr_ptr->frame_width *
+                dataTypeSize((DataType)hdr_ptr->frame_data_type));
+            return true;
+    }
+
+    /**
+     * Record the latency of a frame from being notified ready by the receiver to processing
+     * starting in this plugin, from processing starting to the result being published, and from
+     * the image grab completing to the result being published. The receiver timestamps are
+     * carried in the frame metadata, on the monotonic clock shared by all processes on the host.
+     *
+     * \param[in] frame - the processed frame
+     * \param[in] process_start_ns - monotonic clock when processing of the frame started
+     */
+    void InairaMLPlugin::recordLatency(boost::shared_ptr<Frame> frame, uint64_t process_start_ns)
+    {
+        const FrameMetaData& metadata = frame->get_meta_data();
+        uint64_t grab_ns = 0;
+        uint64_t ready_ns = 0;
+        if(metadata.has_parameter("ready_mono_ns"))
+        {
+            grab_ns = metadata.get_parameter<uint64_t>("grab_mono_ns");
+            ready_ns = metadata.get_parameter<uint64_t>("ready_mono_ns");
+        }
+        uint64_t result_ns = Inaira::monotonic_clock_ns();
+
+        boost::lock_guard<boost::mutex> lock(latency_mutex_);
+        ready_to_process_latency_.record(ready_ns, process_start_ns);
+        process_to_result_latency_.record(process_start_ns, result_ns);
+        total_latency_.record(grab_ns, result_ns);
+    }
+
+    /**
+     * Return the size in bytes of a pixel of the given data type.
+     *
+     * \param[in] data_type - the frame data type
+     * \return pixel size in bytes
+     */
+    std::size_t InairaMLPlugin::dataTypeSize(DataType data_type)
+    {
+        switch(data_type)
+        {
+            case raw_16bit:
+                return sizeof(uint16_t);
+            case raw_32bit:
+            case raw_float:
+                return sizeof(uint32_t);
+            case raw_64bit:
+                return sizeof(uint64_t);
+            default:
+                return sizeof(uint8_t);
+        }
+    }
+
+    /**
+     * Convert a uint16 frame in place to uint8 through the window lookup table, so that the model
+     * and downstream plugins operate on half the data. The data type and image size of the frame
+     * are updated to match.
+     *
+     * \param[in] frame - the frame to convert
+     */
+    void InairaMLPlugin::convertFrame(boost::shared_ptr<Frame> frame)
+    {
+        Inaira::TraceSpan span(tracer_, "preprocess", frame->get_frame_number());
+        Inaira::PerfStageSpan perf_span(perf_, "preprocess");
+        uint16_t* image = static_cast<uint16_t*>(frame->get_image_ptr());
+        std::size_t num_pixels = frame->get_image_size() / sizeof(uint16_t);
+
+        window_lut_.convert(image, reinterpret_cast<uint8_t*>(image), num_pixels);
+
+        frame->meta_data().set_data_type(raw_8bit);
+        frame->set_image_size(num_pixels);
+        frames_converted_++;
     }
 
     std::string InairaMLPlugin::sendResults(uint32_t frame_number, uint32_t process_time, std::vector<float> results)
     {
-        LOG4CXX_DEBUG(logger_, "Creating Json structure");
+        INAIRA_HOTLOG_DEBUG(logger_, "Creating Json structure for frame {}", frame_number);
         OdinData::JsonDict json;
         json.add("frame_number", frame_number);
         json.add("process_time", process_time);
         json.add("result", results);
         
         std::string json_str = json.str();
-        LOG4CXX_DEBUG(logger_, "Json:" << json_str);
+        INAIRA_HOTLOG_DEBUG(logger_, "Json for frame {} is {} bytes", frame_number, json_str.size());
         return json_str;
     }
 
+    /**
+     * Check if results are currently configured to be batched.
+     *
+     * \return true if results are batched
+     */
+    bool InairaMLPlugin::batchingResults(void)
+    {
+        return (result_batch_frames_ > 1) || (result_batch_time_ > 0);
+    }
+
+    /**
+     * Add the results of a frame to the current batch, sending the batch once it is full or its
+     * time window has elapsed. A partial batch whose window elapses before the next results
+     * arrive is sent by the batch flush thread, and one left at the end of an acquisition by
+     * process_end_of_acquisition. Called with the publish mutex held.
+     *
+     * \param[in] results - JSON encoded results of a single frame
+     */
+    void InairaMLPlugin::batchResults(const std::string& results)
+    {
+        uint64_t now = Inaira::monotonic_clock_ns();
+        if(result_batch_.empty())
+        {
+            // Wake the flush thread to time the window of the new batch
+            result_batch_start_ = now;
+            batch_flush_cond_.notify_all();
+        }
+        result_batch_.push_back(results);
+
+        bool batch_full = result_batch_frames_ && (result_batch_.size() >= result_batch_frames_);
+        bool batch_expired = result_batch_time_ &&
+            ((now - result_batch_start_) / 1000000 >= result_batch_time_);
+
+        if(batch_full || batch_expired)
+        {
+            sendResultBatch();
+        }
+    }
+
+    /**
+     * Send the current batch of results as a single message. The per-frame results are kept
+     * intact in a list, so consumers can reconstruct the per-frame stream:
+     *
+     *   {"batch_size": N, "results": [{"frame_number": ..., "process_time": ..., "result": [...]}, ...]}
+     *
+     * Called with the publish mutex held, as the batch is also sent by the batch flush thread.
+     */
+    void InairaMLPlugin::sendResultBatch(void)
+    {
+        std::string batch_str = "{\"batch_size\":" + std::to_string(result_batch_.size()) + ",\"results\":[";
+        for(std::size_t i = 0; i < result_batch_.size(); i++)
+        {
+            if(i > 0)
+            {
+                batch_str += ",";
+            }
+            batch_str += result_batch_[i];
+        }
+        batch_str += "]}";
+
+        INAIRA_HOTLOG_DEBUG(logger_, "Sending batch of {} results", result_batch_.size());
+        publish_socket_.send(batch_str.data(), batch_str.size(), 0);
+        result_batch_.clear();
+        result_batches_sent_++;
+    }
+
+    /**
+     * Batch flush thread, sending a partial result batch once its result_batch_ms window has
+     * elapsed, so that results are not held beyond the window when frames slow down or stop.
+     * The thread sleeps until the window of the current batch ends, or until a new batch is
+     * started or the batching is reconfigured.
+     */
+    void InairaMLPlugin::batchFlushLoop(void)
+    {
+        boost::unique_lock<boost::mutex> lock(publish_mutex_);
+        while(!stop_batch_flush_)
+        {
+            if(result_batch_.empty() || !result_batch_time_)
+            {
+                batch_flush_cond_.wait(lock);
+                continue;
+            }
+
+            uint64_t elapsed_ms = (Inaira::monotonic_clock_ns() - result_batch_start_) / 1000000;
+            if(elapsed_ms >= result_batch_time_)
+            {
+                sendResultBatch();
+                continue;
+            }
+            batch_flush_cond_.timed_wait(lock,
+                boost::posix_time::milliseconds(result_batch_time_ - elapsed_ms));
+        }
+    }
+
     InairaMLPlugin::LiveImageData InairaMLPlugin::sendImage(boost::shared_ptr<Frame> frame)
     {
         OdinData::JsonDict json;
@@ -250,9 +1007,224 @@ namespace FrameProcessor
         // publish_socket_.send(frame->get_image_size(), frame_data_copy, 0);
     }
 
+    /**
+     * Publish the header and image parts of a live image message. If zero-copy publishing is
+     * enabled the image part references the frame data directly and holds the frame until
+     * ZeroMQ releases the message. If too many images are already held, or the oldest has been
+     * held for longer than the configured limit (e.g. by a slow subscriber), the image is copied
+     * instead so that no further shared memory buffers are held. Images already held are
+     * released once ZeroMQ has sent them, or dropped them on disconnecting a subscriber that has
+     * fallen behind by the limit.
+     *
+     * \param[in] frame - the frame the image is taken from
+     * \param[in] live_image - the image header and data pointer returned by sendImage
+     */
+    void InairaMLPlugin::publishImage(boost::shared_ptr<Frame> frame, InairaMLPlugin::LiveImageData& live_image)
+    {
+        publish_socket_.send(live_image.json_header.data(), live_image.json_header.size(), ZMQ_SNDMORE);
+
+        if(zero_copy_image_ && canHoldImage())
+        {
+            ImageReleaseHint* hint = new ImageReleaseHint;
+            hint->frame = frame;
+            hint->tracker = image_tracker_;
+            hint->image_id = next_image_id_++;
+            {
+                boost::lock_guard<boost::mutex> lock(image_tracker_->mutex);
+                image_tracker_->held_images[hint->image_id] = Inaira::monotonic_clock_ns();
+            }
+
+            // The message takes ownership of the hint, calling releaseImage once sent or dropped
+            zmq::message_t image_msg(live_image.frame_data_ptr, frame->get_image_size(),
+                                     &InairaMLPlugin::releaseImage, hint);
+            publish_socket_.send(image_msg, 0);
+            images_zero_copy_++;
+        }
+        else
+        {
+            publish_socket_.send(live_image.frame_data_ptr, frame->get_image_size(), 0);
+            images_copied_++;
+        }
+    }
+
+    /**
+     * Check if another image can be held by a zero-copy message without exceeding the
+     * configured number of held frames or maximum hold time.
+     *
+     * \return true if the image can be sent without copying
+     */
+    bool InairaMLPlugin::canHoldImage(void)
+    {
+        if(!holdLimitEnforced())
+        {
+            return false;
+        }
+
+        boost::lock_guard<boost::mutex> lock(image_tracker_->mutex);
+
+        if(image_tracker_->held_images.size() >= zero_copy_max_frames_)
+        {
+            return false;
+        }
+        if(!image_tracker_->held_images.empty())
+        {
+            uint64_t held_ns = Inaira::monotonic_clock_ns() - image_tracker_->held_images.begin()->second;
+            if(held_ns / 1000000 > zero_copy_max_hold_)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Check that the result socket was bound with heartbeats bounding the time a queued message
+     * can be held to the current zero_copy_max_hold_ms.
+     *
+     * \return true if the hold time of zero-copy images is bounded
+     */
+    bool InairaMLPlugin::holdLimitEnforced(void) const
+    {
+        return is_bound_ && socket_hold_limit_ >= 2 && socket_hold_limit_ == zero_copy_max_hold_;
+    }
+
+    /**
+     * ZeroMQ free callback for zero-copy image messages. This is called from a ZeroMQ I/O thread
+     * once the message has left the socket, dropping the reference to the frame so that the
+     * shared memory buffer can be released back to the frame receiver.
+     *
+     * \param[in] data - pointer to the image data (unused)
+     * \param[in] hint - pointer to the ImageReleaseHint created when the image was published
+     */
+    void InairaMLPlugin::releaseImage(void* data, void* hint)
+    {
+        ImageReleaseHint* release_hint = static_cast<ImageReleaseHint*>(hint);
+        {
+            ImageReleaseTracker& tracker = *(release_hint->tracker);
+            boost::lock_guard<boost::mutex> lock(tracker.mutex);
+
+            std::map<uint64_t, uint64_t>::iterator it =
+                tracker.held_images.find(release_hint->image_id);
+            if(it != tracker.held_images.end())
+            {
+                uint32_t hold_time = (Inaira::monotonic_clock_ns() - it->second) / 1000000;
+                if(hold_time > tracker.max_hold_time)
+                {
+                    tracker.max_hold_time = hold_time;
+                }
+                tracker.held_images.erase(it);
+            }
+        }
+        delete release_hint;
+    }
+
+    /**
+     * Set the storage mode of a frame classification, resetting its sampling state.
+     *
+     * \param[in] policy - the storage policy of the classification
+     * \param[in] mode - the storage mode name
+     * \return true if the mode is valid
+     */
+    bool InairaMLPlugin::setStoragePolicy(InairaMLPlugin::StoragePolicy& policy, std::string mode)
+    {
+        if(mode != STORAGE_ALL && mode != STORAGE_EVERY_N && mode != STORAGE_PER_SECOND && mode != STORAGE_NONE)
+        {
+            LOG4CXX_ERROR(logger_, "Invalid storage mode: " << mode);
+            return false;
+        }
+        policy.mode = mode;
+        policy.frames_seen = 0;
+        policy.window_count = 0;
+        policy.window_start = Inaira::monotonic_clock_ns();
+        LOG4CXX_INFO(logger_, "Storage mode set to " << mode << " with rate " << policy.rate);
+        return true;
+    }
+
+    /**
+     * Decide if a frame should be forwarded for storage according to the policy of its
+     * classification, updating the written and dropped counters.
+     *
+     * \param[in] policy - the storage policy of the frame classification
+     * \return true if the frame should be forwarded for storage
+     */
+    bool InairaMLPlugin::storeFrame(InairaMLPlugin::StoragePolicy& policy)
+    {
+        bool store = true;
+
+        if(policy.mode == STORAGE_NONE)
+        {
+            store = false;
+        }
+        else if(policy.mode == STORAGE_EVERY_N)
+        {
+            store = (policy.rate > 0) && (policy.frames_seen % policy.rate == 0);
+        }
+        else if(policy.mode == STORAGE_PER_SECOND)
+        {
+            uint64_t now = Inaira::monotonic_clock_ns();
+            if(now - policy.window_start >= 1000000000)
+            {
+                policy.window_start = now;
+                policy.window_count = 0;
+            }
+            store = policy.window_count < policy.rate;
+            if(store)
+            {
+                policy.window_count++;
+            }
+        }
+        policy.frames_seen++;
+
+        if(store)
+        {
+            policy.written++;
+        }
+        else
+        {
+            policy.dropped++;
+        }
+        return store;
+    }
+
+    /**
+     * Write a frame into the shared memory live image ring, creating the ring if necessary. Only
+     * every live_ring_frame_frequency-th frame is written, and nothing is written if no ring name
+     * is configured. The ring lock is held so that configure cannot replace the ring mid-write.
+     *
+     * \param[in] frame - the classified frame
+     * \param[in] classification - index of the frame classification
+     * \param[in] score - score of the classification
+     */
+    void InairaMLPlugin::writeLiveRing(boost::shared_ptr<Frame> frame, uint32_t classification, float score)
+    {
+        boost::lock_guard<boost::mutex> lock(live_ring_mutex_);
+        if(live_ring_name_.empty())
+        {
+            return;
+        }
+        if(live_ring_frame_frequency_ == 0 || (live_ring_frame_count_++ % live_ring_frame_frequency_) != 0)
+        {
+            return;
+        }
+
+        if(!live_ring_.isOpen())
+        {
+            std::size_t max_image_size = live_ring_max_image_size_ ? live_ring_max_image_size_ : frame->get_image_size();
+            if(!live_ring_.create(live_ring_name_, live_ring_slots_, max_image_size))
+            {
+                LOG4CXX_ERROR(logger_, "Disabling live image ring " << live_ring_name_);
+                live_ring_name_ = "";
+                return;
+            }
+        }
+        Inaira::PerfStageSpan perf_span(perf_, "live_ring_copy");
+        live_ring_.write(frame, classification, score);
+    }
+
     void InairaMLPlugin::setSocketAddr(std::string value)
     {
-        if(publish_socket_.has_bound_endpoint(value))
+        boost::lock_guard<boost::mutex> lock(publish_mutex_);
+        if(is_bound_ && value == data_socket_addr_ && socket_hold_limit_ == zero_copy_max_hold_)
         {
             LOG4CXX_WARN(logger_, "Socket already bound to " << value <<". Ignoring");
             return;
@@ -260,13 +1232,37 @@ namespace FrameProcessor
 
         try
         {
-            uint32_t linger = 0;
+            int linger = 0;
             publish_socket_.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
-            publish_socket_.unbind(data_socket_addr_.c_str());
+            if(is_bound_)
+            {
+                publish_socket_.unbind(data_socket_addr_);
+            }
 
             is_bound_ = false;
             data_socket_addr_ = value;
 
+            // Heartbeats disconnect subscribers that fall more than the zero-copy hold limit
+            // behind, dropping their queued messages. They apply to connections made after
+            // binding, and are only supported from ZeroMQ 4.2
+            socket_hold_limit_ = 0;
+#ifdef ZMQ_HEARTBEAT_IVL
+            int heartbeat_ivl = zero_copy_max_hold_ / 2;
+            int heartbeat_timeout = zero_copy_max_hold_ - heartbeat_ivl;
+            if(heartbeat_ivl > 0)
+            {
+                publish_socket_.setsockopt(ZMQ_HEARTBEAT_IVL, &heartbeat_ivl, sizeof(heartbeat_ivl));
+                publish_socket_.setsockopt(ZMQ_HEARTBEAT_TIMEOUT, &heartbeat_timeout,
+                    sizeof(heartbeat_timeout));
+                socket_hold_limit_ = zero_copy_max_hold_;
+            }
+#endif
+            if(socket_hold_limit_ == 0 && zero_copy_image_)
+            {
+                LOG4CXX_WARN(logger_, "Zero-copy image hold limit of " << zero_copy_max_hold_
+                    << "ms cannot be enforced, live images will be copied");
+            }
+
             LOG4CXX_INFO(logger_, "Setting Result Socket Address to " << data_socket_addr_);
             publish_socket_.bind(data_socket_addr_);
             is_bound_ = true;
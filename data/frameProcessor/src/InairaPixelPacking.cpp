@@ -0,0 +1,278 @@
+
+#include <InairaPixelPacking.h>
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INAIRA_X86_SIMD
+#endif
+
+namespace FrameProcessor
+{
+    // Number of pixels in a packing group, packing to a whole number of bytes for even bit depths
+    const std::size_t PACK_GROUP_PIXELS = 4;
+
+    /*
+     * Return a mask selecting the low bits of each of the four pixels in a 64-bit group.
+     */
+    static uint64_t group_mask(uint32_t bits)
+    {
+        uint64_t pixel_mask = (1ULL << bits) - 1;
+        return pixel_mask | (pixel_mask << 16) | (pixel_mask << 32) | (pixel_mask << 48);
+    }
+
+#ifdef INAIRA_X86_SIMD
+    __attribute__((target("bmi2")))
+    static void pack_groups_bmi2(const uint16_t* data, uint8_t* packed, std::size_t num_groups,
+        uint32_t bits)
+    {
+        const uint64_t mask = group_mask(bits);
+        const std::size_t group_bytes = bits / 2;
+        for (std::size_t group = 0; group < num_groups; group++)
+        {
+            uint64_t pixels;
+            std::memcpy(&pixels, data + group * PACK_GROUP_PIXELS, sizeof(pixels));
+            uint64_t value = _pext_u64(pixels, mask);
+            std::memcpy(packed + group * group_bytes, &value, sizeof(value));
+        }
+    }
+
+    __attribute__((target("bmi2")))
+    static void unpack_groups_bmi2(const uint8_t* packed, uint16_t* data, std::size_t num_groups,
+        uint32_t bits)
+    {
+        const uint64_t mask = group_mask(bits);
+        const std::size_t group_bytes = bits / 2;
+        for (std::size_t group = 0; group < num_groups; group++)
+        {
+            uint64_t value;
+            std::memcpy(&value, packed + group * group_bytes, sizeof(value));
+            uint64_t pixels = _pdep_u64(value, mask);
+            std::memcpy(data + group * PACK_GROUP_PIXELS, &pixels, sizeof(pixels));
+        }
+    }
+#endif
+
+    static void pack_groups(const uint16_t* data, uint8_t* packed, std::size_t num_groups,
+        uint32_t bits)
+    {
+        const std::size_t group_bytes = bits / 2;
+        for (std::size_t group = 0; group < num_groups; group++)
+        {
+            const uint16_t* pixels = data + group * PACK_GROUP_PIXELS;
+            uint64_t value = (uint64_t)pixels[0] | ((uint64_t)pixels[1] << bits) |
+                ((uint64_t)pixels[2] << (2 * bits)) | ((uint64_t)pixels[3] << (3 * bits));
+            std::memcpy(packed + group * group_bytes, &value, sizeof(value));
+        }
+    }
+
+    static void unpack_groups(const uint8_t* packed, uint16_t* data, std::size_t num_groups,
+        uint32_t bits)
+    {
+        const uint64_t pixel_mask = (1ULL << bits) - 1;
+        const std::size_t group_bytes = bits / 2;
+        for (std::size_t group = 0; group < num_groups; group++)
+        {
+            uint64_t value;
+            std::memcpy(&value, packed + group * group_bytes, sizeof(value));
+            uint16_t* pixels = data + group * PACK_GROUP_PIXELS;
+            for (std::size_t idx = 0; idx < PACK_GROUP_PIXELS; idx++)
+            {
+                pixels[idx] = static_cast<uint16_t>((value >> (idx * bits)) & pixel_mask);
+            }
+        }
+    }
+
+    InairaPixelPacking::InairaPixelPacking() :
+        bits(0),
+        use_bmi2_(false)
+    {
+#ifdef INAIRA_X86_SIMD
+        use_bmi2_ = __builtin_cpu_supports("bmi2");
+#endif
+    }
+
+    InairaPixelPacking::~InairaPixelPacking()
+    {
+    }
+
+    /**
+     * Configure the packed bit depth. A bit depth of 0 disables packing.
+     *
+     * \param[in] bits - packed bits per pixel, 0, 10, 12 or 14
+     * \return true if the bit depth is supported, false otherwise
+     */
+    bool InairaPixelPacking::configure(uint32_t bits)
+    {
+        if (bits != 0 && bits != 10 && bits != 12 && bits != 14)
+        {
+            return false;
+        }
+        this->bits = bits;
+        return true;
+    }
+
+    /**
+     * Enable or disable the BMI2 implementation, which is only used where the CPU supports it.
+     * Disabling it selects the shift and mask implementation, e.g. to check the two agree.
+     *
+     * \param[in] enable - true to use BMI2 where the CPU supports it
+     * \return true if the BMI2 implementation is in use
+     */
+    bool InairaPixelPacking::useSimd(bool enable)
+    {
+        use_bmi2_ = false;
+#ifdef INAIRA_X86_SIMD
+        use_bmi2_ = enable && __builtin_cpu_supports("bmi2");
+#endif
+        return use_bmi2_;
+    }
+
+    bool InairaPixelPacking::enabled(void) const
+    {
+        return bits != 0;
+    }
+
+    /**
+     * Return the size in bytes of a packed image.
+     *
+     * \param[in] num_pixels - number of pixels in the image
+     * \param[in] bits - packed bits per pixel
+     * \return packed size in bytes
+     */
+    std::size_t InairaPixelPacking::packedSize(std::size_t num_pixels, uint32_t bits)
+    {
+        return (num_pixels * bits + 7) / 8;
+    }
+
+    /**
+     * Check that all pixels fit in the packed bit depth, so that packing is lossless.
+     *
+     * \param[in] data - pointer to the pixels
+     * \param[in] num_pixels - number of pixels
+     * \return true if no pixel has bits set above the packed bit depth
+     */
+    bool InairaPixelPacking::fits(const uint16_t* data, std::size_t num_pixels) const
+    {
+        // An OR reduction has no early exit, letting the compiler vectorise it
+        uint16_t all_bits = 0;
+        for (std::size_t idx = 0; idx < num_pixels; idx++)
+        {
+            all_bits |= data[idx];
+        }
+        return (all_bits >> bits) == 0;
+    }
+
+    /**
+     * Pack pixels to the configured bit depth. The packed output may be the same buffer as the
+     * input pixels, as each group is written no further than the end of the pixels it was read
+     * from.
+     *
+     * \param[in] data - pointer to the pixels
+     * \param[out] packed - pointer to the packed output, at least packedSize() bytes
+     * \param[in] num_pixels - number of pixels
+     * \return packed size in bytes
+     */
+    std::size_t InairaPixelPacking::pack(
+        const uint16_t* data, uint8_t* packed, std::size_t num_pixels) const
+    {
+        // Groups are written as 8-byte words, so the final group is packed by the tail to
+        // avoid writing beyond the end of the packed output
+        std::size_t num_groups = num_pixels / PACK_GROUP_PIXELS;
+        num_groups = num_groups ? num_groups - 1 : 0;
+
+#ifdef INAIRA_X86_SIMD
+        if (use_bmi2_)
+        {
+            pack_groups_bmi2(data, packed, num_groups, bits);
+        }
+        else
+#endif
+        {
+            pack_groups(data, packed, num_groups, bits);
+        }
+
+        std::size_t offset = num_groups * PACK_GROUP_PIXELS;
+        packTail(data + offset, packed + num_groups * (bits / 2), num_pixels - offset);
+
+        return packedSize(num_pixels, bits);
+    }
+
+    /**
+     * Unpack pixels from the configured bit depth. The output must not overlap the packed input.
+     *
+     * \param[in] packed - pointer to the packed input
+     * \param[out] data - pointer to the unpacked pixels
+     * \param[in] num_pixels - number of pixels
+     */
+    void InairaPixelPacking::unpack(
+        const uint8_t* packed, uint16_t* data, std::size_t num_pixels) const
+    {
+        // Groups are read as 8-byte words, so the final group is unpacked by the tail to
+        // avoid reading beyond the end of the packed input
+        std::size_t num_groups = num_pixels / PACK_GROUP_PIXELS;
+        num_groups = num_groups ? num_groups - 1 : 0;
+
+#ifdef INAIRA_X86_SIMD
+        if (use_bmi2_)
+        {
+            unpack_groups_bmi2(packed, data, num_groups, bits);
+        }
+        else
+#endif
+        {
+            unpack_groups(packed, data, num_groups, bits);
+        }
+
+        std::size_t offset = num_groups * PACK_GROUP_PIXELS;
+        unpackTail(packed + num_groups * (bits / 2), data + offset, num_pixels - offset);
+    }
+
+    /*
+     * Pack the remaining pixels a byte at a time.
+     */
+    void InairaPixelPacking::packTail(
+        const uint16_t* data, uint8_t* packed, std::size_t num_pixels) const
+    {
+        uint32_t accumulator = 0;
+        uint32_t accumulated_bits = 0;
+        for (std::size_t idx = 0; idx < num_pixels; idx++)
+        {
+            accumulator |= static_cast<uint32_t>(data[idx]) << accumulated_bits;
+            accumulated_bits += bits;
+            while (accumulated_bits >= 8)
+            {
+                *packed++ = static_cast<uint8_t>(accumulator);
+                accumulator >>= 8;
+                accumulated_bits -= 8;
+            }
+        }
+        if (accumulated_bits)
+        {
+            *packed = static_cast<uint8_t>(accumulator);
+        }
+    }
+
+    /*
+     * Unpack the remaining pixels a byte at a time.
+     */
+    void InairaPixelPacking::unpackTail(
+        const uint8_t* packed, uint16_t* data, std::size_t num_pixels) const
+    {
+        const uint32_t pixel_mask = (1U << bits) - 1;
+        uint32_t accumulator = 0;
+        uint32_t accumulated_bits = 0;
+        for (std::size_t idx = 0; idx < num_pixels; idx++)
+        {
+            while (accumulated_bits < bits)
+            {
+                accumulator |= static_cast<uint32_t>(*packed++) << accumulated_bits;
+                accumulated_bits += 8;
+            }
+            data[idx] = static_cast<uint16_t>(accumulator & pixel_mask);
+            accumulator >>= bits;
+            accumulated_bits -= bits;
+        }
+    }
+}
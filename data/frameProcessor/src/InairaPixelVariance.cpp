@@ -0,0 +1,155 @@
+
+#include <InairaPixelVariance.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INAIRA_X86_SIMD
+#endif
+
+namespace FrameProcessor
+{
+    // Maximum number of frames added, so that the uint64 sums of squares cannot overflow
+    const uint64_t MAX_VARIANCE_FRAMES = 0xFFFFFFFFULL;
+
+#ifdef INAIRA_X86_SIMD
+    /*
+     * AVX2 kernel adding uint16 pixels and their squares to the uint64 sums, 8 at a time. The
+     * squares are formed in 32 bits, which 65535^2 fits, before widening. Returns the number of
+     * pixels added, always a multiple of 8.
+     */
+    __attribute__((target("avx2")))
+    static std::size_t add_avx2(uint64_t* sum, uint64_t* sum_squares, const uint16_t* data,
+        std::size_t num_pixels)
+    {
+        std::size_t num_vector = num_pixels & ~static_cast<std::size_t>(7);
+
+        for (std::size_t i = 0; i < num_vector; i += 8)
+        {
+            __m256i pixels = _mm256_cvtepu16_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+            __m256i squares = _mm256_mullo_epi32(pixels, pixels);
+
+            __m256i pixels_lo = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(pixels));
+            __m256i pixels_hi = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(pixels, 1));
+            __m256i squares_lo = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(squares));
+            __m256i squares_hi = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(squares, 1));
+
+            __m256i* s_lo = reinterpret_cast<__m256i*>(sum + i);
+            __m256i* s_hi = reinterpret_cast<__m256i*>(sum + i + 4);
+            __m256i* q_lo = reinterpret_cast<__m256i*>(sum_squares + i);
+            __m256i* q_hi = reinterpret_cast<__m256i*>(sum_squares + i + 4);
+            _mm256_storeu_si256(s_lo, _mm256_add_epi64(_mm256_loadu_si256(s_lo), pixels_lo));
+            _mm256_storeu_si256(s_hi, _mm256_add_epi64(_mm256_loadu_si256(s_hi), pixels_hi));
+            _mm256_storeu_si256(q_lo, _mm256_add_epi64(_mm256_loadu_si256(q_lo), squares_lo));
+            _mm256_storeu_si256(q_hi, _mm256_add_epi64(_mm256_loadu_si256(q_hi), squares_hi));
+        }
+        return num_vector;
+    }
+#endif
+
+    InairaPixelVariance::InairaPixelVariance() :
+        num_pixels(0),
+        frames(0),
+        use_avx2_(false)
+    {
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    InairaPixelVariance::~InairaPixelVariance()
+    {
+    }
+
+    /**
+     * Enable or disable the AVX2 implementation, which is only used where the CPU supports it.
+     * Disabling it selects the scalar implementation, e.g. to check the two agree.
+     *
+     * \param[in] enable - true to use AVX2 where the CPU supports it
+     * \return true if the AVX2 implementation is in use
+     */
+    bool InairaPixelVariance::useSimd(bool enable)
+    {
+        use_avx2_ = false;
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = enable && __builtin_cpu_supports("avx2");
+#endif
+        return use_avx2_;
+    }
+
+    /**
+     * Start a new accumulation, clearing the sums.
+     *
+     * \param[in] num_pixels - number of pixels in each frame
+     */
+    void InairaPixelVariance::reset(std::size_t num_pixels)
+    {
+        this->num_pixels = num_pixels;
+        sum_.assign(num_pixels, 0);
+        sum_squares_.assign(num_pixels, 0);
+        frames = 0;
+    }
+
+    /**
+     * Clear the accumulation and release the sums.
+     */
+    void InairaPixelVariance::clear(void)
+    {
+        num_pixels = 0;
+        frames = 0;
+        std::vector<uint64_t>().swap(sum_);
+        std::vector<uint64_t>().swap(sum_squares_);
+    }
+
+    bool InairaPixelVariance::full(void) const
+    {
+        return frames >= MAX_VARIANCE_FRAMES;
+    }
+
+    /**
+     * Add a frame of num_pixels pixels to the sums.
+     *
+     * \param[in] data - pointer to the image
+     */
+    void InairaPixelVariance::add(const uint16_t* data)
+    {
+        std::size_t start = 0;
+#ifdef INAIRA_X86_SIMD
+        if (use_avx2_)
+        {
+            start = add_avx2(&sum_[0], &sum_squares_[0], data, num_pixels);
+        }
+#endif
+        for (std::size_t i = start; i < num_pixels; i++)
+        {
+            uint64_t value = data[i];
+            sum_[i] += value;
+            sum_squares_[i] += value * value;
+        }
+        frames++;
+    }
+
+    /**
+     * Read out the per-pixel mean and unbiased sample variance. The variance numerator
+     * n * sum(x^2) - sum(x)^2 is formed exactly in 128 bits. The variance is zero for fewer than
+     * two frames.
+     *
+     * \param[out] mean - buffer of num_pixels means
+     * \param[out] variance - buffer of num_pixels variances
+     */
+    void InairaPixelVariance::read(float* mean, float* variance) const
+    {
+        const double n = static_cast<double>(frames);
+        const double scale = (frames > 1) ? 1.0 / (n * (n - 1.0)) : 0.0;
+
+        for (std::size_t i = 0; i < num_pixels; i++)
+        {
+            mean[i] = frames ? static_cast<float>(sum_[i] / n) : 0.0f;
+
+            unsigned __int128 numerator =
+                static_cast<unsigned __int128>(frames) * sum_squares_[i] -
+                static_cast<unsigned __int128>(sum_[i]) * sum_[i];
+            variance[i] = static_cast<float>(static_cast<double>(numerator) * scale);
+        }
+    }
+}
@@ -0,0 +1,280 @@
+
+#include <fstream>
+
+#include <InairaPixelVariancePlugin.h>
+#include "DataBlockFrame.h"
+#include "DebugLevelLogger.h"
+#include "version.h"
+
+namespace FrameProcessor
+{
+    const std::string InairaPixelVariancePlugin::CONFIG_ENABLE = "enable";
+    const std::string InairaPixelVariancePlugin::CONFIG_MEAN_FILE = "mean_file";
+    const std::string InairaPixelVariancePlugin::CONFIG_VARIANCE_FILE = "variance_file";
+    const std::string InairaPixelVariancePlugin::CONFIG_PUSH_IMAGES = "push_images";
+    const std::string InairaPixelVariancePlugin::CONFIG_DUMP_ON_END = "dump_on_end";
+    const std::string InairaPixelVariancePlugin::CONFIG_DUMP = "dump";
+    const std::string InairaPixelVariancePlugin::CONFIG_RESET = "reset";
+
+    /**
+     * The constructor
+     */
+    InairaPixelVariancePlugin::InairaPixelVariancePlugin() :
+        enable_(false),
+        push_images_(false),
+        dump_on_end_(true),
+        reset_pending_(true),
+        frames_skipped_(0),
+        dumps_(0)
+    {
+        logger_ = Logger::getLogger("FP.InairaPixelVariancePlugin");
+        LOG4CXX_INFO(logger_, "InairaPixelVariancePlugin version " <<
+            this->get_version_long() << " loaded.");
+
+        // Bind the counters published to the shared memory metrics page
+        metrics_.bind("enable", enable_);
+        metrics_.bind("frames_accumulated", variance_.frames, Inaira::MetricGauge);
+        metrics_.bind("frames_skipped", frames_skipped_, Inaira::MetricCounter);
+        metrics_.bind("dumps", dumps_, Inaira::MetricCounter);
+    }
+
+    InairaPixelVariancePlugin::~InairaPixelVariancePlugin()
+    {
+        LOG4CXX_TRACE(logger_, "InairaPixelVariancePlugin destructor.");
+    }
+
+    /**
+     * Configure the pixel variance plugin. This plugin supports the following configuration
+     * parameters:
+     *
+     * - enable_         <=> enable
+     * - mean_file_      <=> mean_file
+     * - variance_file_  <=> variance_file
+     * - push_images_    <=> push_images
+     * - dump_on_end_    <=> dump_on_end
+     * - metrics_        <=> metrics
+     * - perf_           <=> perf_counters
+     *
+     * and the commands dump, which writes the mean and variance of the frames accumulated so far,
+     * and reset, which starts a new accumulation. Either file may be empty to skip it. The mean
+     * file of a dark acquisition can be loaded directly as the PCO dark map. When push_images is
+     * set the images are also pushed downstream as float frames of the "mean" and "variance"
+     * datasets. A new accumulation starts with the first frame after each end of acquisition.
+     * Setting metrics to a shared memory name publishes the frame counters to a metrics page of
+     * that name after every frame.
+     *
+     * \param[in] config - Reference to the configuration IpcMessage object.
+     * \param[in] reply - Reference to the reply IpcMessage object.
+     */
+    void InairaPixelVariancePlugin::configure(
+        OdinData::IpcMessage& config, OdinData::IpcMessage& reply)
+    {
+        configureTracing(config, reply);
+        configureMetrics(config, reply);
+        configurePerfCounters(config, reply);
+
+        boost::lock_guard<boost::mutex> lock(variance_mutex_);
+
+        if (config.has_param(InairaPixelVariancePlugin::CONFIG_ENABLE))
+        {
+            enable_ = config.get_param<bool>(InairaPixelVariancePlugin::CONFIG_ENABLE);
+            if (!enable_)
+            {
+                variance_.clear();
+                reset_pending_ = true;
+            }
+        }
+        if (config.has_param(InairaPixelVariancePlugin::CONFIG_MEAN_FILE))
+        {
+            mean_file_ = config.get_param<std::string>(InairaPixelVariancePlugin::CONFIG_MEAN_FILE);
+        }
+        if (config.has_param(InairaPixelVariancePlugin::CONFIG_VARIANCE_FILE))
+        {
+            variance_file_ = config.get_param<std::string>(
+                InairaPixelVariancePlugin::CONFIG_VARIANCE_FILE);
+        }
+        if (config.has_param(InairaPixelVariancePlugin::CONFIG_PUSH_IMAGES))
+        {
+            push_images_ = config.get_param<bool>(InairaPixelVariancePlugin::CONFIG_PUSH_IMAGES);
+        }
+        if (config.has_param(InairaPixelVariancePlugin::CONFIG_DUMP_ON_END))
+        {
+            dump_on_end_ = config.get_param<bool>(InairaPixelVariancePlugin::CONFIG_DUMP_ON_END);
+        }
+        if (config.has_param(InairaPixelVariancePlugin::CONFIG_DUMP) &&
+            config.get_param<bool>(InairaPixelVariancePlugin::CONFIG_DUMP))
+        {
+            if (!dump())
+            {
+                reply.set_nack("Failed to dump pixel mean and variance");
+            }
+        }
+        if (config.has_param(InairaPixelVariancePlugin::CONFIG_RESET) &&
+            config.get_param<bool>(InairaPixelVariancePlugin::CONFIG_RESET))
+        {
+            LOG4CXX_INFO(logger_, "Resetting pixel variance after " << variance_.frames
+                << " frames");
+            variance_.clear();
+            reset_pending_ = true;
+        }
+    }
+
+    void InairaPixelVariancePlugin::requestConfiguration(OdinData::IpcMessage& reply)
+    {
+        std::string base_str = get_name() + "/";
+        boost::lock_guard<boost::mutex> lock(variance_mutex_);
+        reply.set_param(base_str + InairaPixelVariancePlugin::CONFIG_ENABLE, enable_);
+        reply.set_param(base_str + InairaPixelVariancePlugin::CONFIG_MEAN_FILE, mean_file_);
+        reply.set_param(base_str + InairaPixelVariancePlugin::CONFIG_VARIANCE_FILE, variance_file_);
+        reply.set_param(base_str + InairaPixelVariancePlugin::CONFIG_PUSH_IMAGES, push_images_);
+        reply.set_param(base_str + InairaPixelVariancePlugin::CONFIG_DUMP_ON_END, dump_on_end_);
+    }
+
+    void InairaPixelVariancePlugin::status(OdinData::IpcMessage& status)
+    {
+        LOG4CXX_DEBUG(logger_, "Status requested for InairaPixelVariancePlugin");
+
+        std::string base_str = get_name() + "/";
+        perf_.status(status, base_str + "perf/");
+        boost::lock_guard<boost::mutex> lock(variance_mutex_);
+        status.set_param(base_str + "frames", variance_.frames);
+        status.set_param(base_str + "pixels", static_cast<uint64_t>(variance_.num_pixels));
+        status.set_param(base_str + "frames_skipped", frames_skipped_);
+        status.set_param(base_str + "dumps", dumps_);
+    }
+
+    bool InairaPixelVariancePlugin::reset_statistics(void)
+    {
+        boost::lock_guard<boost::mutex> lock(variance_mutex_);
+        frames_skipped_ = 0;
+        dumps_ = 0;
+        return true;
+    }
+
+    /**
+     * Add a uint16 frame to the per-pixel sums and pass it on. A change of image dimensions
+     * starts a new accumulation.
+     *
+     * \param[in] frame - the frame to accumulate
+     */
+    void InairaPixelVariancePlugin::process_frame(boost::shared_ptr<Frame> frame)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(variance_mutex_);
+            if (enable_)
+            {
+                const FrameMetaData& metadata = frame->get_meta_data();
+                std::size_t num_pixels = frame->get_image_size() / sizeof(uint16_t);
+
+                if (metadata.get_data_type() != raw_16bit || variance_.full())
+                {
+                    frames_skipped_++;
+                }
+                else
+                {
+                    if (!reset_pending_ && (metadata.get_dimensions() != dims_ ||
+                        num_pixels != variance_.num_pixels))
+                    {
+                        LOG4CXX_WARN(logger_, "Image size changed, restarting pixel variance "
+                            "after " << variance_.frames << " frames");
+                        reset_pending_ = true;
+                    }
+                    if (reset_pending_)
+                    {
+                        dims_ = metadata.get_dimensions();
+                        variance_.reset(num_pixels);
+                        reset_pending_ = false;
+                    }
+                    Inaira::TraceSpan span(tracer_, "accumulate", frame->get_frame_number());
+                    Inaira::PerfStageSpan perf_span(perf_, "accumulate");
+                    variance_.add(static_cast<const uint16_t*>(frame->get_image_ptr()));
+                }
+            }
+            metrics_.publish();
+        }
+
+        this->push(frame);
+    }
+
+    /**
+     * Dump the mean and variance if required, and start a new accumulation with the next frame.
+     */
+    void InairaPixelVariancePlugin::process_end_of_acquisition(void)
+    {
+        boost::lock_guard<boost::mutex> lock(variance_mutex_);
+        if (enable_ && dump_on_end_ && variance_.frames)
+        {
+            dump();
+        }
+        reset_pending_ = true;
+    }
+
+    /*
+     * Write the mean and variance images to the configured files and push them downstream if
+     * required. Called with the variance mutex held.
+     */
+    bool InairaPixelVariancePlugin::dump(void)
+    {
+        if (!variance_.frames)
+        {
+            LOG4CXX_ERROR(logger_, "No frames accumulated to dump pixel variance");
+            return false;
+        }
+
+        std::vector<float> mean(variance_.num_pixels);
+        std::vector<float> variance(variance_.num_pixels);
+        variance_.read(&mean[0], &variance[0]);
+
+        bool success = true;
+        if (!mean_file_.empty())
+        {
+            success = saveImage(mean_file_, mean) && success;
+        }
+        if (!variance_file_.empty())
+        {
+            success = saveImage(variance_file_, variance) && success;
+        }
+        if (push_images_)
+        {
+            pushImage("mean", mean);
+            pushImage("variance", variance);
+        }
+
+        LOG4CXX_INFO(logger_, "Dumped pixel mean and variance of " << variance_.frames
+            << " frames");
+        if (success)
+        {
+            dumps_++;
+        }
+        return success;
+    }
+
+    bool InairaPixelVariancePlugin::saveImage(
+        const std::string& path, const std::vector<float>& image)
+    {
+        std::ofstream image_stream(path.c_str(), std::ios::binary | std::ios::trunc);
+        image_stream.write(reinterpret_cast<const char*>(image.data()), image.size() * sizeof(float));
+        if (!image_stream)
+        {
+            LOG4CXX_ERROR(logger_, "Failed to save pixel variance image file " << path);
+            return false;
+        }
+        return true;
+    }
+
+    void InairaPixelVariancePlugin::pushImage(
+        const std::string& dataset, const std::vector<float>& image)
+    {
+        FrameMetaData metadata;
+        metadata.set_dataset_name(dataset);
+        metadata.set_data_type(raw_float);
+        metadata.set_frame_number(0);
+        metadata.set_compression_type(no_compression);
+        metadata.set_dimensions(dims_);
+        metadata.set_parameter<uint64_t>("accumulated_frames", variance_.frames);
+
+        boost::shared_ptr<Frame> frame(new DataBlockFrame(
+            metadata, image.data(), image.size() * sizeof(float)));
+        this->push(frame);
+    }
+}
@@ -0,0 +1,147 @@
+
+#include <InairaWindowLut.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INAIRA_X86_SIMD
+#endif
+
+namespace FrameProcessor
+{
+    // Number of table entries, one per uint16 pixel value
+    const std::size_t LUT_ENTRIES = 65536;
+
+    // Padding after the table, as the gathers load 32 bits from the byte offset of each entry
+    const std::size_t LUT_PADDING = 3;
+
+#ifdef INAIRA_X86_SIMD
+    /*
+     * AVX2 kernel converting pixels through the table, 16 at a time. Returns the number of pixels
+     * converted, always a multiple of 16.
+     */
+    __attribute__((target("avx2")))
+    static std::size_t convert_avx2(const uint8_t* table, const uint16_t* data, uint8_t* converted,
+        std::size_t num_pixels)
+    {
+        std::size_t num_vector = num_pixels & ~static_cast<std::size_t>(15);
+        const int* table_base = reinterpret_cast<const int*>(table);
+        const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+
+        for (std::size_t i = 0; i < num_vector; i += 16)
+        {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+            __m256i index_lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(pixels));
+            __m256i index_hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(pixels, 1));
+            __m256i value_lo = _mm256_and_si256(
+                _mm256_i32gather_epi32(table_base, index_lo, 1), byte_mask);
+            __m256i value_hi = _mm256_and_si256(
+                _mm256_i32gather_epi32(table_base, index_hi, 1), byte_mask);
+
+            // Narrow to bytes, undoing the per-lane interleaving of the pack instructions
+            __m256i words = _mm256_permute4x64_epi64(
+                _mm256_packus_epi32(value_lo, value_hi), 0xD8);
+            __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(converted + i),
+                _mm256_castsi256_si128(bytes));
+        }
+        return num_vector;
+    }
+#endif
+
+    InairaWindowLut::InairaWindowLut() :
+        level(32768),
+        width(65536),
+        gamma(1.0),
+        use_avx2_(false),
+        table_(LUT_ENTRIES + LUT_PADDING, 0)
+    {
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = __builtin_cpu_supports("avx2");
+#endif
+        configure(level, width, gamma);
+    }
+
+    InairaWindowLut::~InairaWindowLut()
+    {
+    }
+
+    /**
+     * Enable or disable the AVX2 implementation, which is only used where the CPU supports it.
+     * Disabling it selects the scalar implementation, e.g. to check the two agree.
+     *
+     * \param[in] enable - true to use AVX2 where the CPU supports it
+     * \return true if the AVX2 implementation is in use
+     */
+    bool InairaWindowLut::useSimd(bool enable)
+    {
+        use_avx2_ = false;
+#ifdef INAIRA_X86_SIMD
+        use_avx2_ = enable && __builtin_cpu_supports("avx2");
+#endif
+        return use_avx2_;
+    }
+
+    /**
+     * Configure the window and gamma, rebuilding the lookup table. Pixel values below the window
+     * map to 0 and values above it to 255.
+     *
+     * \param[in] level - pixel value at the centre of the window
+     * \param[in] width - width of the window in pixel values
+     * \param[in] gamma - gamma applied to the windowed value, 1.0 for a linear mapping
+     * \return true if the configuration is valid, false otherwise
+     */
+    bool InairaWindowLut::configure(uint32_t level, uint32_t width, double gamma)
+    {
+        if (width == 0 || !(gamma > 0.0))
+        {
+            return false;
+        }
+
+        this->level = level;
+        this->width = width;
+        this->gamma = gamma;
+
+        double low = static_cast<double>(level) - static_cast<double>(width) / 2.0;
+        double inverse_gamma = 1.0 / gamma;
+        for (std::size_t value = 0; value < LUT_ENTRIES; value++)
+        {
+            double scaled = (static_cast<double>(value) - low) / width;
+            scaled = std::min(std::max(scaled, 0.0), 1.0);
+            if (gamma != 1.0)
+            {
+                scaled = std::pow(scaled, inverse_gamma);
+            }
+            table_[value] = static_cast<uint8_t>(std::lround(scaled * 255.0));
+        }
+        return true;
+    }
+
+    /**
+     * Convert pixels through the lookup table. The converted output may be the same buffer as
+     * the input pixels, as each output byte is written no further than the pixels already read.
+     *
+     * \param[in] data - pointer to the uint16 pixels
+     * \param[out] converted - pointer to the uint8 output
+     * \param[in] num_pixels - number of pixels
+     */
+    void InairaWindowLut::convert(
+        const uint16_t* data, uint8_t* converted, std::size_t num_pixels) const
+    {
+        std::size_t offset = 0;
+#ifdef INAIRA_X86_SIMD
+        if (use_avx2_)
+        {
+            offset = convert_avx2(table_.data(), data, converted, num_pixels);
+        }
+#endif
+        for (std::size_t i = offset; i < num_pixels; i++)
+        {
+            converted[i] = table_[data[i]];
+        }
+    }
+}
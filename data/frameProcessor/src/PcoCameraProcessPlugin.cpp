@@ -5,13 +5,74 @@
 
 namespace FrameProcessor
 {
+    const std::string PcoCameraProcessPlugin::CONFIG_DARK_MAP_FILE = "dark_map_file";
+    const std::string PcoCameraProcessPlugin::CONFIG_GAIN_MAP_FILE = "gain_map_file";
+    const std::string PcoCameraProcessPlugin::CONFIG_BAD_PIXEL_FILE = "bad_pixel_file";
+    const std::string PcoCameraProcessPlugin::CONFIG_CAPTURE_DARK_FRAMES = "capture_dark_frames";
+    const std::string PcoCameraProcessPlugin::CONFIG_CAPTURE_FLAT_FRAMES = "capture_flat_frames";
+    const std::string PcoCameraProcessPlugin::CONFIG_COMPUTE_STATS = "compute_stats";
+    const std::string PcoCameraProcessPlugin::CONFIG_STATS_HISTOGRAM_BINS = "stats_histogram_bins";
+    const std::string PcoCameraProcessPlugin::CONFIG_STATS_PIXEL_BITS = "stats_pixel_bits";
+    const std::string PcoCameraProcessPlugin::CONFIG_STATS_SATURATION_LEVEL = "stats_saturation_level";
+    const std::string PcoCameraProcessPlugin::CONFIG_BINNING = "binning";
+    const std::string PcoCameraProcessPlugin::CONFIG_BINNING_MODE = "binning_mode";
+    const std::string PcoCameraProcessPlugin::CONFIG_BINNING_SATURATION_LEVEL = "binning_saturation_level";
+    const std::string PcoCameraProcessPlugin::CONFIG_PACK_BITS = "pack_bits";
+    const std::string PcoCameraProcessPlugin::CONFIG_COMPUTE_FOCUS = "compute_focus";
+    const std::string PcoCameraProcessPlugin::CONFIG_FOCUS_ROW_STEP = "focus_row_step";
+    const std::string PcoCameraProcessPlugin::CONFIG_FOCUS_THRESHOLD = "focus_threshold";
+    const std::string PcoCameraProcessPlugin::CONFIG_VERIFY_CHECKSUM = "verify_checksum";
 
-    PcoCameraProcessPlugin::PcoCameraProcessPlugin()
+    PcoCameraProcessPlugin::PcoCameraProcessPlugin() :
+        compute_stats_(false),
+        stats_frames_(0),
+        stats_mean_sum_(0.0),
+        stats_saturated_total_(0),
+        stats_saturated_frames_(0),
+        last_min_(0),
+        last_max_(0),
+        last_mean_(0.0),
+        last_std_dev_(0.0),
+        frames_binned_(0),
+        compute_focus_(false),
+        focus_threshold_(0.0),
+        last_focus_(0.0),
+        focus_frames_(0),
+        blurred_frames_(0),
+        frames_packed_(0),
+        frames_not_packed_(0),
+        frames_invalid_header_(0),
+        verify_checksum_(true),
+        frames_checksum_verified_(0),
+        frames_checksum_mismatched_(0),
+        camera_tracking_(false),
+        last_frame_number_(0),
+        last_camera_image_number_(0),
+        camera_frames_lost_(0),
+        camera_frame_gaps_(0),
+        camera_frame_duplicates_(0),
+        camera_frame_reordered_(0)
     {
         // Set up logging
         logger_ = Logger::getLogger("FP.PcoCameraProcessPlugin");
         LOG4CXX_INFO(logger_, "PcoCameraProcessPlugin version " <<
             this->get_version_long() << " loaded.");
+
+        // Bind the counters and latency histograms published to the shared memory metrics page
+        metrics_.bind("frames_invalid_header", frames_invalid_header_, Inaira::MetricCounter);
+        metrics_.bind("checksum/frames_verified", frames_checksum_verified_, Inaira::MetricCounter);
+        metrics_.bind("checksum/frames_mismatched", frames_checksum_mismatched_,
+            Inaira::MetricCounter);
+        metrics_.bind("frames_binned", frames_binned_, Inaira::MetricCounter);
+        metrics_.bind("frames_packed", frames_packed_, Inaira::MetricCounter);
+        metrics_.bind("frames_not_packed", frames_not_packed_, Inaira::MetricCounter);
+        metrics_.bind("focus/blurred_frames", blurred_frames_, Inaira::MetricCounter);
+        metrics_.bind("stats/saturated_frames", stats_saturated_frames_, Inaira::MetricCounter);
+        metrics_.bind("camera/frames_lost", camera_frames_lost_, Inaira::MetricCounter);
+        metrics_.bind("camera/frame_gaps", camera_frame_gaps_, Inaira::MetricCounter);
+        grab_to_ready_latency_.bindMetrics(metrics_, "latency/grab_to_ready/");
+        ready_to_process_latency_.bindMetrics(metrics_, "latency/ready_to_process/");
+        processing_latency_.bindMetrics(metrics_, "latency/processing/");
     }
 
     PcoCameraProcessPlugin::~PcoCameraProcessPlugin()
@@ -19,16 +80,227 @@ namespace FrameProcessor
         LOG4CXX_TRACE(logger_, "PcoCameraProcessPlugin destructor.");
     }
 
+    /**
+     * Configure the PCO camera process plugin. This plugin supports the following configuration
+     * parameters:
+     *
+     * - correction_     <=> dark_map_file, gain_map_file, bad_pixel_file,
+     *                       capture_dark_frames, capture_flat_frames
+     * - compute_stats_  <=> compute_stats
+     * - stats_          <=> stats_histogram_bins, stats_pixel_bits, stats_saturation_level
+     * - binning_        <=> binning, binning_mode, binning_saturation_level
+     * - compute_focus_  <=> compute_focus
+     * - focus_          <=> focus_row_step
+     * - focus_threshold_ <=> focus_threshold
+     * - packing_        <=> pack_bits
+     * - tracer_         <=> trace, trace_dump
+     * - metrics_        <=> metrics
+     * - perf_           <=> perf_counters
+     *
+     * Loading a dark map, gain map or bad pixel list enables correction of uint16 frames as
+     * (raw - dark) * gain, followed by interpolation of bad pixels from their neighbours. This is
+     * the first processing stage. Maps are raw float32 files of one value per pixel, and the bad
+     * pixel list is a text file of column and row pairs. An empty file name clears the map.
+     *
+     * Setting capture_dark_frames or capture_flat_frames to N captures a dark or gain map by
+     * averaging the next N uncorrected frames. The captured map replaces the current one and is
+     * saved to the configured map file, if any.
+     *
+     * The statistics histogram has stats_histogram_bins bins (a power of two) spanning the range
+     * of stats_pixel_bits bit pixels. Pixels at or above stats_saturation_level are counted as
+     * saturated. The statistics of each frame, including the histogram as the stats_histogram
+     * vector, are stored as parameters in its metadata.
+     *
+     * A binning factor of 2 or 4 bins uint16 frames in place by summing ("sum") or averaging
+     * ("mean") the pixels of each bin. A factor of 1 disables binning. Statistics are calculated
+     * on the binned frame.
+     *
+     * The focus metric is the variance of the Laplacian over every focus_row_step-th row. Frames
+     * with a focus metric below a non-zero focus_threshold are tagged with the "blurred" metadata
+     * parameter, so that downstream plugins can skip them.
+     *
+     * A pack_bits value of 10, 12 or 14 losslessly packs uint16 frames to that bit depth as the
+     * final stage, for storage. Packed frames are pushed as a one dimensional uint8 image, so the
+     * HDF dataset must be configured to match. A value of 0 disables packing.
+     *
+     * Frames whose header carries a payload CRC32C calculated by the receiver are verified when
+     * verify_checksum is set, which it is by default. Mismatched frames are counted, logged and
+     * tagged with the "payload_checksum_error" metadata parameter, but are still processed.
+     *
+     * Setting metrics to a shared memory name publishes the frame counters and latency histograms
+     * to a metrics page of that name after every frame. An empty name stops publishing.
+     *
+     * Setting perf_counters reads hardware performance counters around the correct, bin, stats,
+     * focus and pack stages, reporting the instructions per cycle and cache and branch miss rates
+     * of each stage in status.
+     *
+     * \param[in] config - Reference to the configuration IpcMessage object.
+     * \param[in] reply - Reference to the reply IpcMessage object.
+     */
     void PcoCameraProcessPlugin::configure(
         OdinData::IpcMessage& config, OdinData::IpcMessage& reply)
     {
-        // TODO add config here
+        configureTracing(config, reply);
+        configureMetrics(config, reply);
+        configurePerfCounters(config, reply);
+
+        {
+            boost::lock_guard<boost::mutex> lock(correction_mutex_);
+            if (config.has_param(PcoCameraProcessPlugin::CONFIG_DARK_MAP_FILE))
+            {
+                std::string path = config.get_param<std::string>(
+                    PcoCameraProcessPlugin::CONFIG_DARK_MAP_FILE);
+                if (!correction_.loadDarkMap(path))
+                {
+                    reply.set_nack("Failed to load dark map file " + path);
+                }
+            }
+            if (config.has_param(PcoCameraProcessPlugin::CONFIG_GAIN_MAP_FILE))
+            {
+                std::string path = config.get_param<std::string>(
+                    PcoCameraProcessPlugin::CONFIG_GAIN_MAP_FILE);
+                if (!correction_.loadGainMap(path))
+                {
+                    reply.set_nack("Failed to load gain map file " + path);
+                }
+            }
+            if (config.has_param(PcoCameraProcessPlugin::CONFIG_BAD_PIXEL_FILE))
+            {
+                std::string path = config.get_param<std::string>(
+                    PcoCameraProcessPlugin::CONFIG_BAD_PIXEL_FILE);
+                if (!correction_.loadBadPixels(path))
+                {
+                    reply.set_nack("Failed to load bad pixel file " + path);
+                }
+            }
+            if (config.has_param(PcoCameraProcessPlugin::CONFIG_CAPTURE_DARK_FRAMES))
+            {
+                uint32_t frames = config.get_param<unsigned int>(
+                    PcoCameraProcessPlugin::CONFIG_CAPTURE_DARK_FRAMES);
+                if (!correction_.startCapture(InairaFrameCorrection::CaptureDark, frames))
+                {
+                    reply.set_nack("Invalid number of dark capture frames");
+                }
+            }
+            if (config.has_param(PcoCameraProcessPlugin::CONFIG_CAPTURE_FLAT_FRAMES))
+            {
+                uint32_t frames = config.get_param<unsigned int>(
+                    PcoCameraProcessPlugin::CONFIG_CAPTURE_FLAT_FRAMES);
+                if (!correction_.startCapture(InairaFrameCorrection::CaptureFlat, frames))
+                {
+                    reply.set_nack("Invalid number of flat capture frames");
+                }
+            }
+        }
+        if (config.has_param(PcoCameraProcessPlugin::CONFIG_COMPUTE_STATS))
+        {
+            compute_stats_ = config.get_param<bool>(PcoCameraProcessPlugin::CONFIG_COMPUTE_STATS);
+        }
+        if (config.has_param(PcoCameraProcessPlugin::CONFIG_STATS_HISTOGRAM_BINS) ||
+            config.has_param(PcoCameraProcessPlugin::CONFIG_STATS_PIXEL_BITS) ||
+            config.has_param(PcoCameraProcessPlugin::CONFIG_STATS_SATURATION_LEVEL))
+        {
+            uint32_t histogram_bins = config.get_param<unsigned int>(
+                PcoCameraProcessPlugin::CONFIG_STATS_HISTOGRAM_BINS, stats_.histogram_bins);
+            uint32_t pixel_bits = config.get_param<unsigned int>(
+                PcoCameraProcessPlugin::CONFIG_STATS_PIXEL_BITS, stats_.pixel_bits);
+            uint32_t saturation_level = config.get_param<unsigned int>(
+                PcoCameraProcessPlugin::CONFIG_STATS_SATURATION_LEVEL,
+                config.has_param(PcoCameraProcessPlugin::CONFIG_STATS_PIXEL_BITS) ?
+                    (1u << pixel_bits) - 1 : stats_.saturation_level);
+
+            if (!stats_.configure(histogram_bins, pixel_bits, saturation_level))
+            {
+                LOG4CXX_ERROR(logger_, "Invalid statistics configuration: histogram bins "
+                    << histogram_bins << " pixel bits " << pixel_bits
+                    << " saturation level " << saturation_level);
+                reply.set_nack("Invalid statistics configuration");
+            }
+        }
+        if (config.has_param(PcoCameraProcessPlugin::CONFIG_BINNING) ||
+            config.has_param(PcoCameraProcessPlugin::CONFIG_BINNING_MODE) ||
+            config.has_param(PcoCameraProcessPlugin::CONFIG_BINNING_SATURATION_LEVEL))
+        {
+            uint32_t factor = config.get_param<unsigned int>(
+                PcoCameraProcessPlugin::CONFIG_BINNING, binning_.factor);
+            std::string mode = config.get_param<std::string>(
+                PcoCameraProcessPlugin::CONFIG_BINNING_MODE, binning_.mode);
+            uint32_t saturation_level = config.get_param<unsigned int>(
+                PcoCameraProcessPlugin::CONFIG_BINNING_SATURATION_LEVEL, binning_.saturation_level);
+
+            if (!binning_.configure(factor, mode, saturation_level))
+            {
+                LOG4CXX_ERROR(logger_, "Invalid binning configuration: factor " << factor
+                    << " mode " << mode << " saturation level " << saturation_level);
+                reply.set_nack("Invalid binning configuration");
+            }
+        }
+        if (config.has_param(PcoCameraProcessPlugin::CONFIG_COMPUTE_FOCUS))
+        {
+            compute_focus_ = config.get_param<bool>(PcoCameraProcessPlugin::CONFIG_COMPUTE_FOCUS);
+        }
+        if (config.has_param(PcoCameraProcessPlugin::CONFIG_FOCUS_ROW_STEP))
+        {
+            uint32_t row_step = config.get_param<unsigned int>(
+                PcoCameraProcessPlugin::CONFIG_FOCUS_ROW_STEP);
+            if (!focus_.configure(row_step))
+            {
+                LOG4CXX_ERROR(logger_, "Invalid focus row step " << row_step);
+                reply.set_nack("Invalid focus row step");
+            }
+        }
+        if (config.has_param(PcoCameraProcessPlugin::CONFIG_FOCUS_THRESHOLD))
+        {
+            focus_threshold_ = config.get_param<double>(
+                PcoCameraProcessPlugin::CONFIG_FOCUS_THRESHOLD);
+        }
+        if (config.has_param(PcoCameraProcessPlugin::CONFIG_PACK_BITS))
+        {
+            uint32_t pack_bits = config.get_param<unsigned int>(
+                PcoCameraProcessPlugin::CONFIG_PACK_BITS);
+            if (!packing_.configure(pack_bits))
+            {
+                LOG4CXX_ERROR(logger_, "Invalid pixel packing bit depth " << pack_bits);
+                reply.set_nack("Invalid pixel packing bit depth");
+            }
+        }
+        if (config.has_param(PcoCameraProcessPlugin::CONFIG_VERIFY_CHECKSUM))
+        {
+            verify_checksum_ = config.get_param<bool>(PcoCameraProcessPlugin::CONFIG_VERIFY_CHECKSUM);
+        }
     }
 
     void PcoCameraProcessPlugin::requestConfiguration(OdinData::IpcMessage& reply)
     {
         //return the config of the plugin
-
+        std::string base_str = get_name() + "/";
+        {
+            boost::lock_guard<boost::mutex> lock(correction_mutex_);
+            reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_DARK_MAP_FILE,
+                correction_.dark_map_file);
+            reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_GAIN_MAP_FILE,
+                correction_.gain_map_file);
+            reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_BAD_PIXEL_FILE,
+                correction_.bad_pixel_file);
+        }
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_COMPUTE_STATS, compute_stats_);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_STATS_HISTOGRAM_BINS,
+            stats_.histogram_bins);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_STATS_PIXEL_BITS,
+            stats_.pixel_bits);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_STATS_SATURATION_LEVEL,
+            stats_.saturation_level);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_BINNING, binning_.factor);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_BINNING_MODE, binning_.mode);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_BINNING_SATURATION_LEVEL,
+            binning_.saturation_level);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_COMPUTE_FOCUS, compute_focus_);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_FOCUS_ROW_STEP, focus_.row_step);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_FOCUS_THRESHOLD,
+            focus_threshold_);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_PACK_BITS, packing_.bits);
+        reply.set_param(base_str + PcoCameraProcessPlugin::CONFIG_VERIFY_CHECKSUM,
+            verify_checksum_);
     }
 
     void PcoCameraProcessPlugin::status(OdinData::IpcMessage& status)
@@ -36,23 +308,208 @@ namespace FrameProcessor
         //return the status of the plugin
         LOG4CXX_DEBUG(logger_, "Status requested for PcoCameraProcessPlugin");
 
+        std::string base_str = get_name() + "/";
+        perf_.status(status, base_str + "perf/");
+        status.set_param(base_str + "camera_frames/last_image_number", last_camera_image_number_);
+        status.set_param(base_str + "camera_frames/lost", camera_frames_lost_);
+        status.set_param(base_str + "camera_frames/gaps", camera_frame_gaps_);
+        status.set_param(base_str + "camera_frames/duplicates", camera_frame_duplicates_);
+        status.set_param(base_str + "camera_frames/reordered", camera_frame_reordered_);
+        status.set_param(base_str + "frames_invalid_header", frames_invalid_header_);
+        status.set_param(base_str + "checksum/frames_verified", frames_checksum_verified_);
+        status.set_param(base_str + "checksum/frames_mismatched", frames_checksum_mismatched_);
+        {
+            boost::lock_guard<boost::mutex> lock(latency_mutex_);
+            grab_to_ready_latency_.status(status, base_str + "latency/grab_to_ready/");
+            ready_to_process_latency_.status(status, base_str + "latency/ready_to_process/");
+            processing_latency_.status(status, base_str + "latency/processing/");
+        }
+        {
+            boost::lock_guard<boost::mutex> lock(correction_mutex_);
+            status.set_param(base_str + "correction/dark_map_pixels",
+                (uint64_t)correction_.dark_map_pixels);
+            status.set_param(base_str + "correction/gain_map_pixels",
+                (uint64_t)correction_.gain_map_pixels);
+            status.set_param(base_str + "correction/bad_pixels", (uint64_t)correction_.bad_pixels);
+            status.set_param(base_str + "correction/capture", correction_.captureName());
+            status.set_param(base_str + "correction/capture_frames_remaining",
+                correction_.capture_frames_remaining);
+            status.set_param(base_str + "correction/frames_corrected", correction_.frames_corrected);
+            status.set_param(base_str + "correction/frames_mismatched",
+                correction_.frames_mismatched);
+        }
+        status.set_param(base_str + "frames_binned", frames_binned_);
+        if (compute_focus_)
+        {
+            status.set_param(base_str + "focus/last", last_focus_);
+            status.set_param(base_str + "focus/frames", focus_frames_);
+            status.set_param(base_str + "focus/blurred_frames", blurred_frames_);
+            status.set_param(base_str + "focus/blur_rate",
+                focus_frames_ ? static_cast<double>(blurred_frames_) / focus_frames_ : 0.0);
+        }
+        status.set_param(base_str + "frames_packed", frames_packed_);
+        status.set_param(base_str + "frames_not_packed", frames_not_packed_);
+
+        if (compute_stats_)
+        {
+            boost::lock_guard<boost::mutex> lock(stats_mutex_);
+            status.set_param(base_str + "stats/frames", stats_frames_);
+            status.set_param(base_str + "stats/min", last_min_);
+            status.set_param(base_str + "stats/max", last_max_);
+            status.set_param(base_str + "stats/mean", last_mean_);
+            status.set_param(base_str + "stats/std_dev", last_std_dev_);
+            status.set_param(base_str + "stats/average_mean",
+                stats_frames_ ? stats_mean_sum_ / stats_frames_ : 0.0);
+            status.set_param(base_str + "stats/saturated_pixels", stats_saturated_total_);
+            status.set_param(base_str + "stats/saturated_frames", stats_saturated_frames_);
+            for (std::size_t bin = 0; bin < last_histogram_.size(); bin++)
+            {
+                status.set_param(base_str + "stats/histogram[]", last_histogram_[bin]);
+            }
+        }
     }
 
     bool PcoCameraProcessPlugin::reset_statistics(void)
     {
+        camera_tracking_ = false;
+        camera_frames_lost_ = 0;
+        camera_frame_gaps_ = 0;
+        camera_frame_duplicates_ = 0;
+        camera_frame_reordered_ = 0;
+        frames_binned_ = 0;
+        {
+            boost::lock_guard<boost::mutex> lock(correction_mutex_);
+            correction_.frames_corrected = 0;
+            correction_.frames_mismatched = 0;
+        }
+        focus_frames_ = 0;
+        blurred_frames_ = 0;
+        frames_packed_ = 0;
+        frames_not_packed_ = 0;
+        frames_invalid_header_ = 0;
+        frames_checksum_verified_ = 0;
+        frames_checksum_mismatched_ = 0;
+        {
+            boost::lock_guard<boost::mutex> lock(latency_mutex_);
+            grab_to_ready_latency_.reset();
+            ready_to_process_latency_.reset();
+            processing_latency_.reset();
+        }
+
+        boost::lock_guard<boost::mutex> lock(stats_mutex_);
+        stats_frames_ = 0;
+        stats_mean_sum_ = 0.0;
+        stats_saturated_total_ = 0;
+        stats_saturated_frames_ = 0;
         return true;
     }
 
     void PcoCameraProcessPlugin::process_frame(boost::shared_ptr<Frame> frame)
     {
+        uint64_t process_start_ns = Inaira::monotonic_clock_ns();
+
+        if (!decodeHeader(frame))
+        {
+            metrics_.publish();
+            return;
+        }
+
+        correctFrame(frame);
+
+        if (binning_.enabled())
+        {
+            binFrame(frame);
+        }
+
+        if (compute_stats_)
+        {
+            calculateStatistics(frame);
+        }
+
+        if (compute_focus_)
+        {
+            calculateFocus(frame);
+        }
+
+        if (packing_.enabled())
+        {
+            packFrame(frame);
+        }
+
+        recordLatency(frame, process_start_ns);
+        metrics_.publish();
+
+        Inaira::TraceSpan span(tracer_, "push", frame->get_frame_number());
+        this->push(frame);
+    }
+
+    /**
+     * Decode the frame header at the start of the frame buffer into the frame metadata, setting
+     * the image offset and size. The host acquisition timestamps and the camera image number and
+     * timestamp are added as metadata parameters when the header flags them as valid. Frames
+     * without a valid header of the current version, or whose image does not fit in the frame
+     * buffer, are counted and dropped. The payload checksum is verified if present and enabled.
+     *
+     * \param[in] frame - the frame to decode
+     * \return true if the header is valid, false otherwise
+     */
+    bool PcoCameraProcessPlugin::decodeHeader(boost::shared_ptr<Frame> frame)
+    {
+        Inaira::TraceSpan span(tracer_, "decode", frame->get_frame_number());
+
         Inaira::FrameHeader* hdr_ptr = static_cast<Inaira::FrameHeader*>(frame->get_data_ptr());
 
+        if (!Inaira::valid_frame_header(hdr_ptr))
+        {
+            LOG4CXX_ERROR(logger_, "Dropping frame with invalid header: magic 0x" << std::hex
+                << hdr_ptr->magic << std::dec << " version " << hdr_ptr->version
+                << " size " << hdr_ptr->header_size);
+            frames_invalid_header_++;
+            return false;
+        }
+
+        // Drop frames whose image does not fit in the frame buffer, as every later stage walks the
+        // image from its offset
+        if (!Inaira::valid_frame_image(hdr_ptr, frame->get_data_size(),
+            get_size_from_enum((DataType)hdr_ptr->frame_data_type)))
+        {
+            LOG4CXX_ERROR(logger_, "Dropping frame number " << hdr_ptr->frame_number
+                << " with invalid image: offset " << hdr_ptr->image_offset
+                << " size " << hdr_ptr->frame_size
+                << " for " << hdr_ptr->frame_width << "x" << hdr_ptr->frame_height
+                << " pixels in a buffer of " << frame->get_data_size() << " bytes");
+            frames_invalid_header_++;
+            return false;
+        }
+
+        // Verify the payload CRC32C calculated by the receiver on acquisition
+        bool checksum_error = false;
+        if (verify_checksum_ && (hdr_ptr->status_flags & Inaira::FramePayloadChecksum))
+        {
+            Inaira::TraceSpan checksum_span(tracer_, "checksum", frame->get_frame_number());
+            Inaira::PerfStageSpan checksum_perf_span(perf_, "checksum");
+            if (Inaira::valid_payload_checksum(hdr_ptr))
+            {
+                frames_checksum_verified_++;
+            }
+            else
+            {
+                LOG4CXX_ERROR(logger_, "Payload checksum mismatch for frame number "
+                    << hdr_ptr->frame_number << ": header CRC 0x" << std::hex
+                    << hdr_ptr->payload_crc << std::dec);
+                frames_checksum_mismatched_++;
+                checksum_error = true;
+            }
+        }
+
         LOG4CXX_DEBUG_LEVEL(1, logger_,
-            "process_frame got frame number " << hdr_ptr->frame_number
+            "Decoded header for frame number " << hdr_ptr->frame_number
             << " width " << hdr_ptr->frame_width
             << " height " << hdr_ptr->frame_height
             << " type " << hdr_ptr->frame_data_type
             << " size " << hdr_ptr->frame_size
+            << " flags 0x" << std::hex << hdr_ptr->status_flags << std::dec
+            << " camera image number " << hdr_ptr->camera_image_number
         );
 
         FrameMetaData metadata;
@@ -65,11 +522,323 @@ namespace FrameProcessor
         dims[0] = hdr_ptr->frame_height;
         dims[1] = hdr_ptr->frame_width;
         metadata.set_dimensions(dims);
+        metadata.set_parameter<uint32_t>("frame_status_flags", hdr_ptr->status_flags);
+
+        if (hdr_ptr->status_flags & Inaira::FrameHostTimestamps)
+        {
+            metadata.set_parameter<uint64_t>("acquisition_start_ns", hdr_ptr->acquisition_start_ns);
+            metadata.set_parameter<uint64_t>("acquisition_end_ns", hdr_ptr->acquisition_end_ns);
+        }
+
+        if (hdr_ptr->status_flags & Inaira::FrameMonotonicTimestamps)
+        {
+            metadata.set_parameter<uint64_t>("grab_mono_ns", hdr_ptr->grab_mono_ns);
+            metadata.set_parameter<uint64_t>("ready_mono_ns", hdr_ptr->ready_mono_ns);
+        }
+
+        if (hdr_ptr->status_flags & Inaira::FrameCameraTimestamp)
+        {
+            metadata.set_parameter<uint32_t>("camera_image_number", hdr_ptr->camera_image_number);
+            metadata.set_parameter<uint64_t>("camera_timestamp", hdr_ptr->camera_timestamp);
+            checkCameraImageNumber(hdr_ptr->frame_number, hdr_ptr->camera_image_number);
+        }
+
+        if (hdr_ptr->status_flags & Inaira::FramePayloadChecksum)
+        {
+            metadata.set_parameter<uint32_t>("payload_crc", hdr_ptr->payload_crc);
+            if (checksum_error)
+            {
+                metadata.set_parameter<bool>("payload_checksum_error", true);
+            }
+        }
 
         frame->set_meta_data(metadata);
-        frame->set_image_offset(sizeof(Inaira::FrameHeader));
+        frame->set_image_offset(hdr_ptr->image_offset);
         frame->set_image_size(hdr_ptr->frame_size);
+        return true;
+    }
 
-        this->push(frame);
+    /**
+     * Record the latency of a frame from the grab completing in the receiver to it being notified
+     * ready, from being notified ready to processing starting in this plugin, and of processing
+     * in this plugin. The receiver timestamps are on the monotonic clock shared by all processes
+     * on the host, so the ready to processing latency is the buffering between the processes.
+     *
+     * \param[in] frame - the processed frame
+     * \param[in] process_start_ns - monotonic clock when processing of the frame started
+     */
+    void PcoCameraProcessPlugin::recordLatency(
+        boost::shared_ptr<Frame> frame, uint64_t process_start_ns)
+    {
+        const FrameMetaData& metadata = frame->get_meta_data();
+        uint64_t grab_ns = 0;
+        uint64_t ready_ns = 0;
+        if (metadata.has_parameter("ready_mono_ns"))
+        {
+            grab_ns = metadata.get_parameter<uint64_t>("grab_mono_ns");
+            ready_ns = metadata.get_parameter<uint64_t>("ready_mono_ns");
+        }
+
+        boost::lock_guard<boost::mutex> lock(latency_mutex_);
+        grab_to_ready_latency_.record(grab_ns, ready_ns);
+        ready_to_process_latency_.record(ready_ns, process_start_ns);
+        processing_latency_.record(process_start_ns, Inaira::monotonic_clock_ns());
+    }
+
+    /**
+     * Check the camera image number of a frame against the previous frame to detect frames lost
+     * between the camera and the receiver. The frame number is the count of frames acquired by the
+     * receiver, so a camera image number advancing further than the frame number indicates frames
+     * dropped by the grabber. Repeated or decreasing camera image numbers are counted as duplicate
+     * and reordered frames. Tracking restarts when the frame number does not advance, i.e. at the
+     * start of a new acquisition.
+     *
+     * \param[in] frame_number - frame number assigned by the receiver
+     * \param[in] camera_image_number - image number decoded from the camera timestamp
+     */
+    void PcoCameraProcessPlugin::checkCameraImageNumber(
+        uint32_t frame_number, uint32_t camera_image_number)
+    {
+        if (!camera_tracking_ || (frame_number <= last_frame_number_))
+        {
+            camera_tracking_ = true;
+            last_frame_number_ = frame_number;
+            last_camera_image_number_ = camera_image_number;
+            return;
+        }
+
+        int64_t frame_delta = static_cast<int64_t>(frame_number) - last_frame_number_;
+        int64_t camera_delta =
+            static_cast<int64_t>(camera_image_number) - last_camera_image_number_;
+        last_frame_number_ = frame_number;
+
+        if (camera_delta == 0)
+        {
+            camera_frame_duplicates_++;
+            LOG4CXX_WARN(logger_, "Frame " << frame_number
+                << " duplicates camera image number " << camera_image_number);
+        }
+        else if (camera_delta < 0)
+        {
+            // A late image was previously counted as lost in the gap it left
+            camera_frame_reordered_++;
+            if (camera_frames_lost_)
+            {
+                camera_frames_lost_--;
+            }
+            LOG4CXX_WARN(logger_, "Frame " << frame_number << " camera image number "
+                << camera_image_number << " is before previous image number "
+                << last_camera_image_number_);
+        }
+        else
+        {
+            if (camera_delta > frame_delta)
+            {
+                camera_frame_gaps_++;
+                camera_frames_lost_ += (camera_delta - frame_delta);
+                LOG4CXX_WARN(logger_, "Frame " << frame_number << " camera image number "
+                    << camera_image_number << " follows " << last_camera_image_number_
+                    << ", " << (camera_delta - frame_delta) << " frames lost");
+            }
+            last_camera_image_number_ = camera_image_number;
+        }
+    }
+
+    /**
+     * Correct a uint16 frame in place for the dark level, pixel gain and bad pixels, after adding
+     * the uncorrected frame to any dark or flat map capture in progress.
+     *
+     * \param[in] frame - the frame to correct
+     */
+    void PcoCameraProcessPlugin::correctFrame(boost::shared_ptr<Frame> frame)
+    {
+        Inaira::TraceSpan span(tracer_, "correct", frame->get_frame_number());
+        Inaira::PerfStageSpan perf_span(perf_, "correct");
+
+        if (frame->get_meta_data().get_data_type() != raw_16bit)
+        {
+            return;
+        }
+
+        boost::lock_guard<boost::mutex> lock(correction_mutex_);
+        if (!correction_.capturing() && !correction_.enabled())
+        {
+            return;
+        }
+
+        uint16_t* image = static_cast<uint16_t*>(frame->get_image_ptr());
+        const dimensions_t& dims = frame->get_meta_data().get_dimensions();
+
+        if (correction_.capturing())
+        {
+            correction_.capture(image, dims[1], dims[0]);
+        }
+        if (correction_.enabled() && correction_.apply(image, dims[1], dims[0]))
+        {
+            frame->meta_data().set_parameter<bool>("corrected", true);
+        }
+    }
+
+    /**
+     * Bin a uint16 frame in place at the start of the image, updating the dimensions and image
+     * size so that downstream plugins only see the binned image.
+     *
+     * \param[in] frame - the frame to bin
+     */
+    void PcoCameraProcessPlugin::binFrame(boost::shared_ptr<Frame> frame)
+    {
+        Inaira::TraceSpan span(tracer_, "bin", frame->get_frame_number());
+        Inaira::PerfStageSpan perf_span(perf_, "bin");
+
+        if (frame->get_meta_data().get_data_type() != raw_16bit)
+        {
+            return;
+        }
+
+        dimensions_t dims = frame->get_meta_data().get_dimensions();
+        uint32_t binned_width, binned_height;
+        binning_.bin(static_cast<uint16_t*>(frame->get_image_ptr()), dims[1], dims[0],
+            binned_width, binned_height);
+
+        dims[0] = binned_height;
+        dims[1] = binned_width;
+        frame->meta_data().set_dimensions(dims);
+        frame->meta_data().set_parameter<uint32_t>("binning", binning_.factor);
+        frame->set_image_size(binned_width * binned_height * sizeof(uint16_t));
+        frames_binned_++;
+
+        LOG4CXX_DEBUG_LEVEL(2, logger_, "Frame " << frame->get_frame_number() << " binned "
+            << binning_.factor << "x" << binning_.factor << " to " << binned_width
+            << "x" << binned_height);
+    }
+
+    /**
+     * Calculate the focus metric of a uint16 frame, storing it in the frame metadata and tagging
+     * the frame as blurred if the metric is below the configured threshold.
+     *
+     * \param[in] frame - the frame to calculate the focus metric for
+     */
+    void PcoCameraProcessPlugin::calculateFocus(boost::shared_ptr<Frame> frame)
+    {
+        Inaira::TraceSpan span(tracer_, "focus", frame->get_frame_number());
+        Inaira::PerfStageSpan perf_span(perf_, "focus");
+
+        if (frame->get_meta_data().get_data_type() != raw_16bit)
+        {
+            return;
+        }
+
+        const dimensions_t& dims = frame->get_meta_data().get_dimensions();
+        double focus = focus_.calculate(
+            static_cast<const uint16_t*>(frame->get_image_ptr()), dims[1], dims[0]);
+        bool blurred = (focus_threshold_ > 0.0) && (focus < focus_threshold_);
+
+        frame->meta_data().set_parameter<double>("focus", focus);
+        frame->meta_data().set_parameter<bool>("blurred", blurred);
+
+        last_focus_ = focus;
+        focus_frames_++;
+        if (blurred)
+        {
+            blurred_frames_++;
+            LOG4CXX_DEBUG_LEVEL(1, logger_, "Frame " << frame->get_frame_number()
+                << " is blurred with focus " << focus);
+        }
+    }
+
+    /**
+     * Pack a uint16 frame in place to the configured bit depth. The frame becomes a one
+     * dimensional uint8 image of the packed bytes, with the packing and original dimensions
+     * recorded as metadata parameters so that readers can unpack it. Frames with pixels that do
+     * not fit in the bit depth are left unpacked.
+     *
+     * \param[in] frame - the frame to pack
+     */
+    void PcoCameraProcessPlugin::packFrame(boost::shared_ptr<Frame> frame)
+    {
+        Inaira::TraceSpan span(tracer_, "pack", frame->get_frame_number());
+        Inaira::PerfStageSpan perf_span(perf_, "pack");
+
+        if (frame->get_meta_data().get_data_type() != raw_16bit)
+        {
+            return;
+        }
+
+        uint16_t* image = static_cast<uint16_t*>(frame->get_image_ptr());
+        std::size_t num_pixels = frame->get_image_size() / sizeof(uint16_t);
+
+        if (!packing_.fits(image, num_pixels))
+        {
+            frames_not_packed_++;
+            LOG4CXX_WARN(logger_, "Frame " << frame->get_frame_number()
+                << " has pixels exceeding " << packing_.bits << " bits, not packing");
+            return;
+        }
+
+        std::size_t packed_size =
+            packing_.pack(image, reinterpret_cast<uint8_t*>(image), num_pixels);
+
+        FrameMetaData& metadata = frame->meta_data();
+        dimensions_t dims = metadata.get_dimensions();
+        metadata.set_parameter<uint32_t>("packed_bits", packing_.bits);
+        metadata.set_parameter<uint32_t>("packed_height", dims[0]);
+        metadata.set_parameter<uint32_t>("packed_width", dims[1]);
+
+        dimensions_t packed_dims(1);
+        packed_dims[0] = packed_size;
+        metadata.set_dimensions(packed_dims);
+        metadata.set_data_type(raw_8bit);
+        frame->set_image_size(packed_size);
+        frames_packed_++;
+
+        LOG4CXX_DEBUG_LEVEL(2, logger_, "Frame " << frame->get_frame_number() << " packed to "
+            << packing_.bits << " bits, " << packed_size << " bytes");
+    }
+
+    /**
+     * Calculate the statistics of a uint16 frame in a single pass over the image, storing them as
+     * parameters in the frame metadata and updating the aggregated values reported in status.
+     *
+     * \param[in] frame - the frame to calculate statistics for
+     */
+    void PcoCameraProcessPlugin::calculateStatistics(boost::shared_ptr<Frame> frame)
+    {
+        Inaira::TraceSpan span(tracer_, "stats", frame->get_frame_number());
+        Inaira::PerfStageSpan perf_span(perf_, "stats");
+
+        if (frame->get_meta_data().get_data_type() != raw_16bit)
+        {
+            return;
+        }
+
+        stats_.calculate(
+            static_cast<const uint16_t*>(frame->get_image_ptr()),
+            frame->get_image_size() / sizeof(uint16_t)
+        );
+
+        FrameMetaData& metadata = frame->meta_data();
+        metadata.set_parameter<uint32_t>("stats_min", stats_.min);
+        metadata.set_parameter<uint32_t>("stats_max", stats_.max);
+        metadata.set_parameter<double>("stats_mean", stats_.mean);
+        metadata.set_parameter<double>("stats_std_dev", stats_.std_dev);
+        metadata.set_parameter<uint64_t>("stats_saturated", stats_.saturated);
+        metadata.set_parameter<std::vector<uint32_t> >("stats_histogram", stats_.histogram);
+
+        LOG4CXX_DEBUG_LEVEL(2, logger_, "Frame " << frame->get_frame_number()
+            << " statistics min " << stats_.min << " max " << stats_.max
+            << " mean " << stats_.mean << " std_dev " << stats_.std_dev
+            << " saturated " << stats_.saturated
+        );
+
+        boost::lock_guard<boost::mutex> lock(stats_mutex_);
+        stats_frames_++;
+        stats_mean_sum_ += stats_.mean;
+        stats_saturated_total_ += stats_.saturated;
+        stats_saturated_frames_ += (stats_.saturated > 0);
+        last_min_ = stats_.min;
+        last_max_ = stats_.max;
+        last_mean_ = stats_.mean;
+        last_std_dev_ = stats_.std_dev;
+        last_histogram_ = stats_.histogram;
     }
 }
\ No newline at end of file
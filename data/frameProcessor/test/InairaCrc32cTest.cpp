@@ -0,0 +1,122 @@
+/*
+ * InairaCrc32cTest.cpp
+ *
+ * Tests of the CRC32C payload checksum, comparing the hardware and table implementations with a
+ * bitwise reference.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+#include "InairaCrc32c.h"
+
+using namespace Inaira;
+
+namespace
+{
+    // Bit at a time CRC32C, the definition the optimised implementations must match
+    uint32_t reference_crc32c(const uint8_t* data, std::size_t size)
+    {
+        uint32_t crc = 0xFFFFFFFF;
+        for (std::size_t idx = 0; idx < size; idx++)
+        {
+            crc ^= data[idx];
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+            }
+        }
+        return ~crc;
+    }
+
+    std::vector<uint8_t> random_bytes(std::size_t size)
+    {
+        std::vector<uint8_t> bytes(size);
+        srand(7);
+        for (std::size_t idx = 0; idx < bytes.size(); idx++)
+        {
+            bytes[idx] = static_cast<uint8_t>(rand());
+        }
+        return bytes;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(InairaCrc32cUnitTest);
+
+BOOST_AUTO_TEST_CASE(CheckValue)
+{
+    const char* check = "123456789";
+    Crc32c software;
+    software.useHardware(false);
+    BOOST_CHECK_EQUAL(software.update(0, check, 9), 0xE3069283);
+    BOOST_CHECK_EQUAL(crc32c(check, 9), 0xE3069283);
+    BOOST_CHECK_EQUAL(crc32c(check, 0), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SoftwareMatchesReference)
+{
+    Crc32c software;
+    software.useHardware(false);
+
+    std::vector<uint8_t> bytes = random_bytes(4096 + 8);
+    const std::size_t lengths[] = {1, 7, 8, 9, 63, 64, 65, 4096};
+    for (std::size_t offset = 0; offset < 8; offset++)
+    {
+        for (std::size_t length : lengths)
+        {
+            BOOST_CHECK_EQUAL(software.update(0, bytes.data() + offset, length),
+                reference_crc32c(bytes.data() + offset, length));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(HardwareMatchesSoftware)
+{
+    Crc32c hardware;
+    Crc32c software;
+    if (!hardware.useHardware(true))
+    {
+        BOOST_TEST_MESSAGE("SSE4.2 not supported, skipping comparison");
+        return;
+    }
+    software.useHardware(false);
+
+    // Lengths either side of the short and long three stream blocks, and several long blocks
+    // followed by short blocks and a tail, from aligned and unaligned starts
+    const std::size_t short_block = CRC32C_SHORT * 3;
+    const std::size_t long_block = CRC32C_LONG * 3;
+    const std::size_t lengths[] = {
+        0, 1, 8, 15,
+        short_block - 1, short_block, short_block + 1, short_block * 2 + 8,
+        long_block - 1, long_block, long_block + 1, long_block + short_block + 13,
+        long_block * 3 + short_block * 2 + 7
+    };
+    std::vector<uint8_t> bytes = random_bytes(long_block * 3 + short_block * 2 + 7 + 8);
+    for (std::size_t offset = 0; offset < 8; offset += 3)
+    {
+        for (std::size_t length : lengths)
+        {
+            const uint8_t* start = bytes.data() + offset;
+            uint32_t crc = hardware.update(0, start, length);
+            BOOST_CHECK_EQUAL(crc, software.update(0, start, length));
+            BOOST_CHECK_EQUAL(crc, reference_crc32c(start, length));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ContinueCrc)
+{
+    // A CRC continued over the second part of a buffer equals the CRC of the whole buffer
+    std::vector<uint8_t> bytes = random_bytes(CRC32C_LONG * 3 + 100);
+    uint32_t whole = crc32c(bytes.data(), bytes.size());
+    const std::size_t splits[] = {1, CRC32C_SHORT * 3 + 5, CRC32C_LONG * 3};
+    for (std::size_t split : splits)
+    {
+        uint32_t first = crc32c(bytes.data(), split);
+        BOOST_CHECK_EQUAL(crc32c(bytes.data() + split, bytes.size() - split, first), whole);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END(); //InairaCrc32cUnitTest
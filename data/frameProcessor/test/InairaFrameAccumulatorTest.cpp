@@ -0,0 +1,141 @@
+/*
+ * InairaFrameAccumulatorTest.cpp
+ *
+ * Tests of temporal frame accumulation, comparing the AVX2 and scalar implementations.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+#include "InairaFrameAccumulator.h"
+
+using namespace FrameProcessor;
+
+namespace
+{
+    std::vector<uint16_t> random_frame(std::size_t num_pixels)
+    {
+        std::vector<uint16_t> frame(num_pixels);
+        for (std::size_t idx = 0; idx < frame.size(); idx++)
+        {
+            frame[idx] = static_cast<uint16_t>(rand());
+        }
+        return frame;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(InairaFrameAccumulatorUnitTest);
+
+BOOST_AUTO_TEST_CASE(ConfigureAccumulator)
+{
+    InairaFrameAccumulator accumulator;
+    BOOST_CHECK(!accumulator.enabled());
+    BOOST_CHECK(accumulator.configure(4, "sum"));
+    BOOST_CHECK(accumulator.enabled());
+    BOOST_CHECK(accumulator.outputSum());
+    BOOST_CHECK_EQUAL(accumulator.outputPixelSize(), sizeof(uint32_t));
+    BOOST_CHECK(accumulator.configure(65536, "mean"));
+    BOOST_CHECK_EQUAL(accumulator.outputPixelSize(), sizeof(uint16_t));
+    BOOST_CHECK(!accumulator.configure(65537, "mean"));
+    BOOST_CHECK(!accumulator.configure(0, "mean"));
+    BOOST_CHECK(!accumulator.configure(4, "median"));
+}
+
+BOOST_AUTO_TEST_CASE(RoundedMean)
+{
+    InairaFrameAccumulator accumulator;
+    accumulator.configure(2, "mean");
+    accumulator.reset(3);
+    const uint16_t first[] = {1, 2, 65535};
+    const uint16_t second[] = {2, 2, 65534};
+    accumulator.add(first);
+    BOOST_CHECK(!accumulator.complete());
+    accumulator.add(second);
+    BOOST_CHECK(accumulator.complete());
+
+    uint16_t mean[3];
+    accumulator.read(mean);
+    BOOST_CHECK_EQUAL(mean[0], 2);
+    BOOST_CHECK_EQUAL(mean[1], 2);
+    BOOST_CHECK_EQUAL(mean[2], 65535);
+}
+
+BOOST_AUTO_TEST_CASE(SimdMatchesScalar)
+{
+    InairaFrameAccumulator simd;
+    InairaFrameAccumulator scalar;
+    if (!simd.useSimd(true))
+    {
+        BOOST_TEST_MESSAGE("AVX2 not supported, skipping comparison");
+        return;
+    }
+    scalar.useSimd(false);
+
+    // Lengths that leave a scalar tail after the 16 pixel vectors
+    srand(5);
+    const std::size_t lengths[] = {4096, 4096 + 15, 17, 15};
+    for (std::size_t length : lengths)
+    {
+        simd.configure(8, "sum");
+        scalar.configure(8, "sum");
+        simd.reset(length);
+        scalar.reset(length);
+        for (int frame_idx = 0; frame_idx < 8; frame_idx++)
+        {
+            std::vector<uint16_t> frame = random_frame(length);
+            simd.add(frame.data());
+            scalar.add(frame.data());
+        }
+
+        std::vector<uint32_t> simd_sum(length);
+        std::vector<uint32_t> scalar_sum(length);
+        simd.read(simd_sum.data());
+        scalar.read(scalar_sum.data());
+        BOOST_CHECK_EQUAL_COLLECTIONS(simd_sum.begin(), simd_sum.end(),
+            scalar_sum.begin(), scalar_sum.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MaximumFramesDoNotOverflow)
+{
+    // The largest accumulation of saturated pixels fits the uint32 sums exactly, through both
+    // the vector lanes and the scalar tail
+    const uint32_t max_frames = 65536;
+    const std::size_t length = 16 + 3;
+    std::vector<uint16_t> frame(length, 0xFFFF);
+    const bool enables[] = {true, false};
+    for (bool enable : enables)
+    {
+        InairaFrameAccumulator accumulator;
+        accumulator.useSimd(enable);
+        BOOST_REQUIRE(accumulator.configure(max_frames, "sum"));
+        accumulator.reset(length);
+        for (uint32_t frame_idx = 0; frame_idx < max_frames; frame_idx++)
+        {
+            accumulator.add(frame.data());
+        }
+        BOOST_CHECK(accumulator.complete());
+
+        std::vector<uint32_t> sum(length);
+        accumulator.read(sum.data());
+        for (std::size_t idx = 0; idx < length; idx++)
+        {
+            BOOST_CHECK_EQUAL(sum[idx], 0xFFFFu * max_frames);
+        }
+
+        accumulator.configure(max_frames, "mean");
+        std::vector<uint16_t> mean(length);
+        accumulator.reset(length);
+        for (uint32_t frame_idx = 0; frame_idx < max_frames; frame_idx++)
+        {
+            accumulator.add(frame.data());
+        }
+        accumulator.read(mean.data());
+        BOOST_CHECK_EQUAL(mean[0], 0xFFFF);
+        BOOST_CHECK_EQUAL(mean[length - 1], 0xFFFF);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END(); //InairaFrameAccumulatorUnitTest
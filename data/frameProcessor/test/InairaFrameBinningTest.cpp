@@ -0,0 +1,141 @@
+/*
+ * InairaFrameBinningTest.cpp
+ *
+ * Tests of in-place pixel binning, comparing the vectorised row sums with a plain reference.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "InairaFrameBinning.h"
+
+using namespace FrameProcessor;
+
+namespace
+{
+    // Bin each pixel directly from its block, the definition the in-place binning must match
+    std::vector<uint16_t> reference_bin(const std::vector<uint16_t>& image, uint32_t width,
+        uint32_t height, uint32_t factor, bool mean, uint32_t saturation_level)
+    {
+        uint32_t binned_width = width / factor;
+        uint32_t binned_height = height / factor;
+        std::vector<uint16_t> binned(binned_width * binned_height);
+        for (uint32_t row = 0; row < binned_height; row++)
+        {
+            for (uint32_t col = 0; col < binned_width; col++)
+            {
+                uint32_t sum = 0;
+                bool saturated = false;
+                for (uint32_t dy = 0; dy < factor; dy++)
+                {
+                    for (uint32_t dx = 0; dx < factor; dx++)
+                    {
+                        uint16_t pixel = image[(row * factor + dy) * width + col * factor + dx];
+                        sum += pixel;
+                        saturated |= (pixel >= saturation_level);
+                    }
+                }
+                uint32_t value = mean ?
+                    (sum + factor * factor / 2) / (factor * factor) : std::min<uint32_t>(sum, 0xFFFF);
+                if (saturated)
+                {
+                    value = mean ? saturation_level : 0xFFFF;
+                }
+                binned[row * binned_width + col] = static_cast<uint16_t>(value);
+            }
+        }
+        return binned;
+    }
+
+    std::vector<uint16_t> random_image(uint32_t width, uint32_t height, uint32_t max_value)
+    {
+        std::vector<uint16_t> image(width * height);
+        srand(11);
+        for (std::size_t idx = 0; idx < image.size(); idx++)
+        {
+            image[idx] = static_cast<uint16_t>(rand() % (max_value + 1));
+        }
+        return image;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(InairaFrameBinningUnitTest);
+
+BOOST_AUTO_TEST_CASE(ConfigureBinning)
+{
+    InairaFrameBinning binning;
+    BOOST_CHECK(!binning.enabled());
+    BOOST_CHECK(binning.configure(2, "sum", 0xFFFF));
+    BOOST_CHECK(binning.enabled());
+    BOOST_CHECK(!binning.configure(3, "sum", 0xFFFF));
+    BOOST_CHECK(!binning.configure(2, "median", 0xFFFF));
+    BOOST_CHECK(!binning.configure(2, "mean", 0));
+    BOOST_CHECK(!binning.configure(2, "mean", 0x10000));
+    BOOST_CHECK_EQUAL(binning.factor, 2);
+}
+
+BOOST_AUTO_TEST_CASE(SaturatedBin)
+{
+    // One saturated pixel marks its whole bin saturated, and sums clamp to the uint16 range
+    InairaFrameBinning binning;
+    binning.configure(2, "mean", 4000);
+    std::vector<uint16_t> image = {
+        100, 100, 4000, 0,
+        100, 100, 0,    0
+    };
+    uint32_t binned_width, binned_height;
+    binning.bin(image.data(), 4, 2, binned_width, binned_height);
+    BOOST_CHECK_EQUAL(binned_width, 2);
+    BOOST_CHECK_EQUAL(binned_height, 1);
+    BOOST_CHECK_EQUAL(image[0], 100);
+    BOOST_CHECK_EQUAL(image[1], 4000);
+
+    binning.configure(2, "sum", 0xFFFF);
+    image = {
+        30000, 30000, 0xFFFF, 0,
+        30000, 30000, 0,      0
+    };
+    binning.bin(image.data(), 4, 2, binned_width, binned_height);
+    BOOST_CHECK_EQUAL(image[0], 0xFFFF);
+    BOOST_CHECK_EQUAL(image[1], 0xFFFF);
+}
+
+BOOST_AUTO_TEST_CASE(VectorisedMatchesReference)
+{
+    // Widths leaving a remainder after the vectorised columns and a partial bin discarded, with
+    // pixel values that saturate and overflow the sums
+    const uint32_t widths[] = {64, 70, 37};
+    const uint32_t factors[] = {2, 4};
+    const char* modes[] = {"sum", "mean"};
+    const uint32_t saturation_levels[] = {0xFFFF, 50000};
+    for (uint32_t width : widths)
+    {
+        const uint32_t height = 18;
+        for (uint32_t factor : factors)
+        {
+            for (const char* mode : modes)
+            {
+                for (uint32_t saturation_level : saturation_levels)
+                {
+                    InairaFrameBinning binning;
+                    binning.configure(factor, mode, saturation_level);
+                    std::vector<uint16_t> image = random_image(width, height, 0xFFFF);
+                    std::vector<uint16_t> expected = reference_bin(image, width, height, factor,
+                        binning.mode == "mean", saturation_level);
+
+                    uint32_t binned_width, binned_height;
+                    binning.bin(image.data(), width, height, binned_width, binned_height);
+                    BOOST_CHECK_EQUAL(binned_width, width / factor);
+                    BOOST_CHECK_EQUAL(binned_height, height / factor);
+                    BOOST_CHECK_EQUAL_COLLECTIONS(image.begin(), image.begin() + expected.size(),
+                        expected.begin(), expected.end());
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END(); //InairaFrameBinningUnitTest
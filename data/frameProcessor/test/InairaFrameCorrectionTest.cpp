@@ -0,0 +1,158 @@
+/*
+ * InairaFrameCorrectionTest.cpp
+ *
+ * Tests of dark, gain and bad pixel correction, comparing the AVX2 and scalar implementations.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "InairaFrameCorrection.h"
+
+using namespace FrameProcessor;
+
+namespace
+{
+    // Image size with a row length that leaves a scalar tail after the 16 pixel vectors
+    const uint32_t TEST_WIDTH = 37;
+    const uint32_t TEST_HEIGHT = 11;
+    const std::size_t TEST_PIXELS = TEST_WIDTH * TEST_HEIGHT;
+
+    // Writes a correction map as a raw float32 file, removed when the fixture is destroyed
+    class MapFile
+    {
+        public:
+            MapFile(const std::string& name, const std::vector<float>& map) :
+                path_((std::filesystem::temp_directory_path() /
+                    ("inaira_correction_test_" + name)).string())
+            {
+                std::ofstream map_stream(path_.c_str(), std::ios::binary);
+                map_stream.write(reinterpret_cast<const char*>(map.data()),
+                    map.size() * sizeof(float));
+            }
+
+            ~MapFile()
+            {
+                std::remove(path_.c_str());
+            }
+
+            const std::string& path(void) const
+            {
+                return path_;
+            }
+
+        private:
+            std::string path_;
+    };
+
+    std::vector<uint16_t> random_pixels(std::size_t num_pixels)
+    {
+        std::vector<uint16_t> pixels(num_pixels);
+        for (std::size_t idx = 0; idx < num_pixels; idx++)
+        {
+            pixels[idx] = static_cast<uint16_t>(std::rand());
+        }
+        return pixels;
+    }
+
+    // Random map values, including values that clamp the corrected pixels to 0 and 65535
+    std::vector<float> random_map(std::size_t num_pixels, float offset, float scale)
+    {
+        std::vector<float> map(num_pixels);
+        for (std::size_t idx = 0; idx < num_pixels; idx++)
+        {
+            map[idx] = offset + scale * static_cast<float>(std::rand()) / RAND_MAX;
+        }
+        return map;
+    }
+
+    void check_simd_matches_scalar(const std::string& dark_path, const std::string& gain_path)
+    {
+        InairaFrameCorrection simd;
+        InairaFrameCorrection scalar;
+        BOOST_REQUIRE(simd.loadDarkMap(dark_path) && scalar.loadDarkMap(dark_path));
+        BOOST_REQUIRE(simd.loadGainMap(gain_path) && scalar.loadGainMap(gain_path));
+        simd.useSimd(true);
+        scalar.useSimd(false);
+
+        std::vector<uint16_t> simd_pixels = random_pixels(TEST_PIXELS);
+        std::vector<uint16_t> scalar_pixels(simd_pixels);
+        BOOST_CHECK(simd.apply(simd_pixels.data(), TEST_WIDTH, TEST_HEIGHT));
+        BOOST_CHECK(scalar.apply(scalar_pixels.data(), TEST_WIDTH, TEST_HEIGHT));
+        BOOST_CHECK_EQUAL_COLLECTIONS(simd_pixels.begin(), simd_pixels.end(),
+            scalar_pixels.begin(), scalar_pixels.end());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(InairaFrameCorrectionUnitTest);
+
+BOOST_AUTO_TEST_CASE(KnownCorrection)
+{
+    MapFile dark("known_dark", std::vector<float>(TEST_PIXELS, 100.0f));
+    MapFile gain("known_gain", std::vector<float>(TEST_PIXELS, 1.5f));
+    InairaFrameCorrection correction;
+    BOOST_REQUIRE(correction.loadDarkMap(dark.path()));
+    BOOST_REQUIRE(correction.loadGainMap(gain.path()));
+    BOOST_CHECK_EQUAL(correction.dark_map_pixels, TEST_PIXELS);
+
+    std::vector<uint16_t> pixels(TEST_PIXELS, 1100);
+    pixels[0] = 50;
+    pixels[TEST_PIXELS - 1] = 60000;
+    BOOST_CHECK(correction.apply(pixels.data(), TEST_WIDTH, TEST_HEIGHT));
+
+    BOOST_CHECK_EQUAL(pixels[0], 0);
+    BOOST_CHECK_EQUAL(pixels[1], 1500);
+    BOOST_CHECK_EQUAL(pixels[TEST_PIXELS - 2], 1500);
+    BOOST_CHECK_EQUAL(pixels[TEST_PIXELS - 1], 65535);
+    BOOST_CHECK_EQUAL(correction.frames_corrected, 1);
+}
+
+BOOST_AUTO_TEST_CASE(MismatchedMap)
+{
+    MapFile dark("mismatched_dark", std::vector<float>(TEST_PIXELS - 1, 100.0f));
+    InairaFrameCorrection correction;
+    BOOST_REQUIRE(correction.loadDarkMap(dark.path()));
+
+    std::vector<uint16_t> pixels(TEST_PIXELS, 1000);
+    BOOST_CHECK(!correction.apply(pixels.data(), TEST_WIDTH, TEST_HEIGHT));
+    BOOST_CHECK_EQUAL(pixels[0], 1000);
+    BOOST_CHECK_EQUAL(correction.frames_mismatched, 1);
+}
+
+BOOST_AUTO_TEST_CASE(SimdMatchesScalar)
+{
+    if (!InairaFrameCorrection().useSimd(true))
+    {
+        BOOST_TEST_MESSAGE("AVX2 not supported, skipping comparison");
+        return;
+    }
+
+    std::srand(36);
+    MapFile dark("simd_dark", random_map(TEST_PIXELS, -1000.0f, 20000.0f));
+    MapFile gain("simd_gain", random_map(TEST_PIXELS, 0.5f, 1.5f));
+
+    check_simd_matches_scalar(dark.path(), gain.path());
+    check_simd_matches_scalar(dark.path(), "");
+    check_simd_matches_scalar("", gain.path());
+}
+
+BOOST_AUTO_TEST_CASE(SimdRoundsToNearestEven)
+{
+    if (!InairaFrameCorrection().useSimd(true))
+    {
+        BOOST_TEST_MESSAGE("AVX2 not supported, skipping comparison");
+        return;
+    }
+
+    // Corrected values falling exactly half way between integers
+    MapFile dark("round_dark", std::vector<float>(TEST_PIXELS, 0.5f));
+    check_simd_matches_scalar(dark.path(), "");
+}
+
+BOOST_AUTO_TEST_SUITE_END(); //InairaFrameCorrectionUnitTest
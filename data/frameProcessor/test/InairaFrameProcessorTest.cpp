@@ -0,0 +1,9 @@
+/*
+ * InairaFrameProcessorTest.cpp
+ *
+ * Test module for the frame processor image kernels.
+ */
+
+#define BOOST_TEST_MODULE "InairaFrameProcessorUnitTests"
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
@@ -0,0 +1,127 @@
+/*
+ * InairaFrameStatisticsTest.cpp
+ *
+ * Tests of the frame statistics, comparing the AVX2 and scalar implementations.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+#include "InairaFrameStatistics.h"
+
+using namespace FrameProcessor;
+
+namespace
+{
+    // Image lengths covering partial vectors and partial cache blocks
+    const std::size_t TEST_LENGTHS[] = {1, 15, 16, 17, 4095, 4096, 4097, 10007};
+
+    std::vector<uint16_t> random_pixels(std::size_t num_pixels, uint32_t bits)
+    {
+        std::vector<uint16_t> pixels(num_pixels);
+        for (std::size_t idx = 0; idx < num_pixels; idx++)
+        {
+            pixels[idx] = static_cast<uint16_t>(std::rand() & ((1 << bits) - 1));
+        }
+        return pixels;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(InairaFrameStatisticsUnitTest);
+
+BOOST_AUTO_TEST_CASE(ConfigureHistogram)
+{
+    InairaFrameStatistics stats;
+    BOOST_CHECK(stats.configure(256, 12, 4000));
+    BOOST_CHECK(!stats.configure(100, 12, 4000));
+    BOOST_CHECK(!stats.configure(8192, 12, 4000));
+    BOOST_CHECK(!stats.configure(256, 17, 4000));
+}
+
+BOOST_AUTO_TEST_CASE(KnownStatistics)
+{
+    InairaFrameStatistics stats;
+    stats.configure(4, 12, 3000);
+    std::vector<uint16_t> pixels = {0, 1000, 2000, 3000, 4000, 4095};
+    stats.calculate(pixels.data(), pixels.size());
+
+    BOOST_CHECK_EQUAL(stats.min, 0);
+    BOOST_CHECK_EQUAL(stats.max, 4095);
+    BOOST_CHECK_CLOSE(stats.mean, 14095.0 / 6, 1e-9);
+    BOOST_CHECK_EQUAL(stats.saturated, 3);
+    std::vector<uint32_t> expected = {2, 1, 1, 2};
+    BOOST_CHECK_EQUAL_COLLECTIONS(stats.histogram.begin(), stats.histogram.end(),
+        expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(SimdMatchesScalar)
+{
+    InairaFrameStatistics simd;
+    InairaFrameStatistics scalar;
+    if (!simd.useSimd(true))
+    {
+        BOOST_TEST_MESSAGE("AVX2 not supported, skipping comparison");
+        return;
+    }
+    scalar.useSimd(false);
+    simd.configure(256, 16, 60000);
+    scalar.configure(256, 16, 60000);
+
+    std::srand(31);
+    for (std::size_t length : TEST_LENGTHS)
+    {
+        std::vector<uint16_t> pixels = random_pixels(length, 16);
+        simd.calculate(pixels.data(), pixels.size());
+        scalar.calculate(pixels.data(), pixels.size());
+
+        BOOST_CHECK_EQUAL(simd.min, *std::min_element(pixels.begin(), pixels.end()));
+        BOOST_CHECK_EQUAL(simd.max, *std::max_element(pixels.begin(), pixels.end()));
+        BOOST_CHECK_EQUAL(simd.min, scalar.min);
+        BOOST_CHECK_EQUAL(simd.max, scalar.max);
+        BOOST_CHECK_EQUAL(simd.saturated, scalar.saturated);
+        BOOST_CHECK_EQUAL(simd.saturated,
+            std::count_if(pixels.begin(), pixels.end(), [](uint16_t p) { return p >= 60000; }));
+
+        // The sums are exact integers in both implementations, so the moments agree exactly
+        BOOST_CHECK_EQUAL(simd.mean, scalar.mean);
+        BOOST_CHECK_EQUAL(simd.std_dev, scalar.std_dev);
+        BOOST_CHECK_CLOSE(simd.mean,
+            std::accumulate(pixels.begin(), pixels.end(), 0.0) / length, 1e-9);
+
+        BOOST_CHECK_EQUAL_COLLECTIONS(simd.histogram.begin(), simd.histogram.end(),
+            scalar.histogram.begin(), scalar.histogram.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SimdSaturatedAndExtremes)
+{
+    InairaFrameStatistics simd;
+    InairaFrameStatistics scalar;
+    if (!simd.useSimd(true))
+    {
+        BOOST_TEST_MESSAGE("AVX2 not supported, skipping comparison");
+        return;
+    }
+    scalar.useSimd(false);
+
+    // Pixels at the limits of the uint16 range, where a signed comparison would go wrong
+    std::vector<uint16_t> pixels(100, 0xFFFF);
+    pixels[3] = 0x8000;
+    pixels[40] = 0x7FFF;
+    pixels[97] = 0;
+    simd.calculate(pixels.data(), pixels.size());
+    scalar.calculate(pixels.data(), pixels.size());
+
+    BOOST_CHECK_EQUAL(simd.min, 0);
+    BOOST_CHECK_EQUAL(simd.max, 0xFFFF);
+    BOOST_CHECK_EQUAL(simd.saturated, 97);
+    BOOST_CHECK_EQUAL(simd.saturated, scalar.saturated);
+    BOOST_CHECK_EQUAL(simd.mean, scalar.mean);
+    BOOST_CHECK_EQUAL(simd.std_dev, scalar.std_dev);
+}
+
+BOOST_AUTO_TEST_SUITE_END(); //InairaFrameStatisticsUnitTest
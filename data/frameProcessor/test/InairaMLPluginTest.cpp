@@ -0,0 +1,92 @@
+/*
+ * InairaMLPluginTest.cpp
+ *
+ * Tests of the InairaMLPlugin frame gating, which run without loading a model.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <vector>
+
+#include "InairaMLPlugin.h"
+
+using namespace FrameProcessor;
+
+namespace
+{
+    const uint32_t TEST_WIDTH = 8;
+    const uint32_t TEST_HEIGHT = 4;
+
+    // Build a frame holding a frame header and a uint8 image, as received from shared memory,
+    // with metadata optionally tagged as blurred by an upstream plugin
+    boost::shared_ptr<Frame> make_frame(uint32_t frame_number, bool blurred)
+    {
+        std::vector<uint8_t> buffer(Inaira::FRAME_IMAGE_ALIGNMENT + TEST_WIDTH * TEST_HEIGHT, 0);
+        Inaira::FrameHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = Inaira::FRAME_HEADER_MAGIC;
+        header.version = Inaira::FRAME_HEADER_VERSION;
+        header.header_size = sizeof(Inaira::FrameHeader);
+        header.frame_number = frame_number;
+        header.frame_width = TEST_WIDTH;
+        header.frame_height = TEST_HEIGHT;
+        header.frame_data_type = raw_8bit;
+        header.frame_size = TEST_WIDTH * TEST_HEIGHT;
+        header.image_offset = Inaira::FRAME_IMAGE_ALIGNMENT;
+        std::memcpy(buffer.data(), &header, sizeof(header));
+
+        FrameMetaData metadata;
+        metadata.set_frame_number(frame_number);
+        metadata.set_parameter<bool>("blurred", blurred);
+        return boost::shared_ptr<Frame>(
+            new DataBlockFrame(metadata, buffer.data(), buffer.size()));
+    }
+
+    uint32_t frames_skipped_blurred(InairaMLPlugin& plugin)
+    {
+        OdinData::IpcMessage status;
+        plugin.status(status);
+        return status.get_param<uint32_t>("learning/frames_skipped_blurred");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(InairaMLPluginUnitTest);
+
+BOOST_AUTO_TEST_CASE(SkipBlurredDecodedFrame)
+{
+    InairaMLPlugin plugin;
+    plugin.set_name("learning");
+
+    OdinData::IpcMessage config;
+    OdinData::IpcMessage reply;
+    config.set_param("decode_header", true);
+    config.set_param("skip_blurred", true);
+    plugin.configure(config, reply);
+
+    // Decoding the header keeps the blurred tag, so the frame is skipped without the model
+    boost::shared_ptr<Frame> frame = make_frame(1, true);
+    plugin.process_frame(frame);
+    BOOST_CHECK_EQUAL(frames_skipped_blurred(plugin), 1);
+    BOOST_CHECK(frame->get_meta_data().get_parameter<bool>("blurred"));
+    BOOST_CHECK_EQUAL(frame->get_meta_data().get_dimensions()[0], TEST_HEIGHT);
+    BOOST_CHECK_EQUAL(frame->get_meta_data().get_dimensions()[1], TEST_WIDTH);
+}
+
+BOOST_AUTO_TEST_CASE(SkipBlurredUndecodedFrame)
+{
+    InairaMLPlugin plugin;
+    plugin.set_name("learning");
+
+    OdinData::IpcMessage config;
+    OdinData::IpcMessage reply;
+    config.set_param("decode_header", false);
+    config.set_param("skip_blurred", true);
+    plugin.configure(config, reply);
+
+    plugin.process_frame(make_frame(1, true));
+    plugin.process_frame(make_frame(2, true));
+    BOOST_CHECK_EQUAL(frames_skipped_blurred(plugin), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END(); //InairaMLPluginUnitTest
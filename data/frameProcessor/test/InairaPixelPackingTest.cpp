@@ -0,0 +1,163 @@
+/*
+ * InairaPixelPackingTest.cpp
+ *
+ * Round trip tests of pixel packing, with the BMI2 and shift and mask implementations.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+#include "InairaPixelPacking.h"
+
+using namespace FrameProcessor;
+
+namespace
+{
+    // Image lengths covering no groups, a partial group, the final group packed by the tail and
+    // lengths that are not a multiple of the four pixel group
+    const std::size_t TEST_LENGTHS[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 13, 1021, 1024, 1027};
+
+    std::vector<uint16_t> random_pixels(std::size_t num_pixels, uint32_t bits)
+    {
+        std::vector<uint16_t> pixels(num_pixels);
+        for (std::size_t idx = 0; idx < num_pixels; idx++)
+        {
+            pixels[idx] = static_cast<uint16_t>(std::rand() & ((1 << bits) - 1));
+        }
+        return pixels;
+    }
+
+    void check_round_trip(uint32_t bits, bool simd)
+    {
+        InairaPixelPacking packing;
+        BOOST_REQUIRE(packing.configure(bits));
+        packing.useSimd(simd);
+
+        std::srand(bits);
+        for (std::size_t length : TEST_LENGTHS)
+        {
+            std::vector<uint16_t> pixels = random_pixels(length, bits);
+            BOOST_CHECK(packing.fits(pixels.data(), length));
+
+            // Guard bytes after the packed output catch writes beyond its end
+            std::size_t packed_size = InairaPixelPacking::packedSize(length, bits);
+            std::vector<uint8_t> packed(packed_size + 8, 0xA5);
+            BOOST_CHECK_EQUAL(packing.pack(pixels.data(), packed.data(), length), packed_size);
+            for (std::size_t idx = packed_size; idx < packed.size(); idx++)
+            {
+                BOOST_CHECK_EQUAL(packed[idx], 0xA5);
+            }
+
+            std::vector<uint16_t> unpacked(length + 4, 0xFFFF);
+            packing.unpack(packed.data(), unpacked.data(), length);
+            BOOST_CHECK_EQUAL_COLLECTIONS(unpacked.begin(), unpacked.begin() + length,
+                pixels.begin(), pixels.end());
+            for (std::size_t idx = length; idx < unpacked.size(); idx++)
+            {
+                BOOST_CHECK_EQUAL(unpacked[idx], 0xFFFF);
+            }
+        }
+    }
+
+    void check_simd_matches_scalar(uint32_t bits)
+    {
+        InairaPixelPacking simd;
+        InairaPixelPacking scalar;
+        BOOST_REQUIRE(simd.configure(bits));
+        BOOST_REQUIRE(scalar.configure(bits));
+        if (!simd.useSimd(true))
+        {
+            BOOST_TEST_MESSAGE("BMI2 not supported, skipping comparison");
+            return;
+        }
+        scalar.useSimd(false);
+
+        std::srand(bits + 1);
+        for (std::size_t length : TEST_LENGTHS)
+        {
+            std::vector<uint16_t> pixels = random_pixels(length, bits);
+            std::size_t packed_size = InairaPixelPacking::packedSize(length, bits);
+            std::vector<uint8_t> simd_packed(packed_size);
+            std::vector<uint8_t> scalar_packed(packed_size);
+            simd.pack(pixels.data(), simd_packed.data(), length);
+            scalar.pack(pixels.data(), scalar_packed.data(), length);
+            BOOST_CHECK_EQUAL_COLLECTIONS(simd_packed.begin(), simd_packed.end(),
+                scalar_packed.begin(), scalar_packed.end());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(InairaPixelPackingUnitTest);
+
+BOOST_AUTO_TEST_CASE(ConfigureBits)
+{
+    InairaPixelPacking packing;
+    BOOST_CHECK(!packing.enabled());
+    BOOST_CHECK(packing.configure(12));
+    BOOST_CHECK(packing.enabled());
+    BOOST_CHECK(!packing.configure(11));
+    BOOST_CHECK(!packing.configure(16));
+    BOOST_CHECK_EQUAL(packing.bits, 12);
+}
+
+BOOST_AUTO_TEST_CASE(PackedSize)
+{
+    BOOST_CHECK_EQUAL(InairaPixelPacking::packedSize(4, 12), 6);
+    BOOST_CHECK_EQUAL(InairaPixelPacking::packedSize(5, 12), 8);
+    BOOST_CHECK_EQUAL(InairaPixelPacking::packedSize(4, 14), 7);
+    BOOST_CHECK_EQUAL(InairaPixelPacking::packedSize(5, 14), 9);
+}
+
+BOOST_AUTO_TEST_CASE(FitsBitDepth)
+{
+    InairaPixelPacking packing;
+    packing.configure(12);
+    std::vector<uint16_t> pixels(7, 0x0FFF);
+    BOOST_CHECK(packing.fits(pixels.data(), pixels.size()));
+    pixels[6] = 0x1000;
+    BOOST_CHECK(!packing.fits(pixels.data(), pixels.size()));
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip12Bit)
+{
+    check_round_trip(12, true);
+    check_round_trip(12, false);
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip14Bit)
+{
+    check_round_trip(14, true);
+    check_round_trip(14, false);
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip10Bit)
+{
+    check_round_trip(10, true);
+    check_round_trip(10, false);
+}
+
+BOOST_AUTO_TEST_CASE(PackInPlace)
+{
+    InairaPixelPacking packing;
+    packing.configure(14);
+    std::srand(0);
+    std::vector<uint16_t> pixels = random_pixels(1027, 14);
+    std::vector<uint16_t> buffer(pixels);
+
+    packing.pack(buffer.data(), reinterpret_cast<uint8_t*>(buffer.data()), buffer.size());
+    std::vector<uint16_t> unpacked(pixels.size());
+    packing.unpack(reinterpret_cast<const uint8_t*>(buffer.data()), unpacked.data(),
+        unpacked.size());
+    BOOST_CHECK_EQUAL_COLLECTIONS(unpacked.begin(), unpacked.end(), pixels.begin(), pixels.end());
+}
+
+BOOST_AUTO_TEST_CASE(SimdMatchesScalar)
+{
+    check_simd_matches_scalar(10);
+    check_simd_matches_scalar(12);
+    check_simd_matches_scalar(14);
+}
+
+BOOST_AUTO_TEST_SUITE_END(); //InairaPixelPackingUnitTest
@@ -0,0 +1,101 @@
+/*
+ * InairaPixelVarianceTest.cpp
+ *
+ * Tests of the running per-pixel mean and variance, comparing the AVX2 and scalar
+ * implementations.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+#include "InairaPixelVariance.h"
+
+using namespace FrameProcessor;
+
+BOOST_AUTO_TEST_SUITE(InairaPixelVarianceUnitTest);
+
+BOOST_AUTO_TEST_CASE(KnownVariance)
+{
+    // Values 2, 4, 4, 4, 5, 5, 7, 9 have mean 5 and unbiased sample variance 32 / 7
+    InairaPixelVariance variance;
+    variance.reset(1);
+    const uint16_t values[] = {2, 4, 4, 4, 5, 5, 7, 9};
+    for (uint16_t value : values)
+    {
+        variance.add(&value);
+    }
+    float mean, var;
+    variance.read(&mean, &var);
+    BOOST_CHECK_CLOSE(mean, 5.0f, 1e-4);
+    BOOST_CHECK_CLOSE(var, 32.0f / 7.0f, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(SingleFrame)
+{
+    InairaPixelVariance variance;
+    variance.reset(2);
+    const uint16_t frame[] = {100, 65535};
+    variance.add(frame);
+    float mean[2], var[2];
+    variance.read(mean, var);
+    BOOST_CHECK_EQUAL(mean[1], 65535.0f);
+    BOOST_CHECK_EQUAL(var[0], 0.0f);
+    BOOST_CHECK_EQUAL(var[1], 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(SimdMatchesScalar)
+{
+    InairaPixelVariance simd;
+    InairaPixelVariance scalar;
+    if (!simd.useSimd(true))
+    {
+        BOOST_TEST_MESSAGE("AVX2 not supported, skipping comparison");
+        return;
+    }
+    scalar.useSimd(false);
+
+    // Lengths that leave a scalar tail after the 8 pixel vectors, with values up to 65535 so
+    // that the 32-bit squares in the vector kernel use their full range
+    srand(3);
+    const std::size_t lengths[] = {4096, 4096 + 7, 9, 7};
+    for (std::size_t length : lengths)
+    {
+        simd.reset(length);
+        scalar.reset(length);
+        std::vector<uint16_t> frame(length);
+        for (int frame_idx = 0; frame_idx < 16; frame_idx++)
+        {
+            for (std::size_t idx = 0; idx < length; idx++)
+            {
+                frame[idx] = (idx % 5 == 0) ? 65535 : static_cast<uint16_t>(rand());
+            }
+            simd.add(frame.data());
+            scalar.add(frame.data());
+        }
+
+        std::vector<float> simd_mean(length), simd_var(length);
+        std::vector<float> scalar_mean(length), scalar_var(length);
+        simd.read(simd_mean.data(), simd_var.data());
+        scalar.read(scalar_mean.data(), scalar_var.data());
+        BOOST_CHECK_EQUAL_COLLECTIONS(simd_mean.begin(), simd_mean.end(),
+            scalar_mean.begin(), scalar_mean.end());
+        BOOST_CHECK_EQUAL_COLLECTIONS(simd_var.begin(), simd_var.end(),
+            scalar_var.begin(), scalar_var.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ClearReleasesSums)
+{
+    InairaPixelVariance variance;
+    variance.reset(16);
+    std::vector<uint16_t> frame(16, 1);
+    variance.add(frame.data());
+    variance.clear();
+    BOOST_CHECK_EQUAL(variance.num_pixels, 0);
+    BOOST_CHECK_EQUAL(variance.frames, 0);
+    BOOST_CHECK(!variance.full());
+}
+
+BOOST_AUTO_TEST_SUITE_END(); //InairaPixelVarianceUnitTest
@@ -0,0 +1,113 @@
+/*
+ * InairaWindowLutTest.cpp
+ *
+ * Tests of the window lookup table, comparing the AVX2 and scalar implementations.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+#include "InairaWindowLut.h"
+
+using namespace FrameProcessor;
+
+namespace
+{
+    // Every uint16 value, including the last table entry read by the final gather
+    std::vector<uint16_t> all_values(void)
+    {
+        std::vector<uint16_t> pixels(65536);
+        for (std::size_t idx = 0; idx < pixels.size(); idx++)
+        {
+            pixels[idx] = static_cast<uint16_t>(idx);
+        }
+        return pixels;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(InairaWindowLutUnitTest);
+
+BOOST_AUTO_TEST_CASE(ConfigureWindow)
+{
+    InairaWindowLut lut;
+    BOOST_CHECK(lut.configure(2048, 4096, 1.0));
+    BOOST_CHECK(!lut.configure(2048, 0, 1.0));
+    BOOST_CHECK(!lut.configure(2048, 4096, 0.0));
+    BOOST_CHECK_EQUAL(lut.width, 4096);
+}
+
+BOOST_AUTO_TEST_CASE(WindowLimits)
+{
+    InairaWindowLut lut;
+    lut.configure(2000, 1000, 1.0);
+    std::vector<uint16_t> pixels = {0, 1500, 2000, 2500, 65535};
+    std::vector<uint8_t> converted(pixels.size());
+    lut.convert(pixels.data(), converted.data(), pixels.size());
+
+    BOOST_CHECK_EQUAL(converted[0], 0);
+    BOOST_CHECK_EQUAL(converted[1], 0);
+    BOOST_CHECK_EQUAL(converted[2], 128);
+    BOOST_CHECK_EQUAL(converted[3], 255);
+    BOOST_CHECK_EQUAL(converted[4], 255);
+}
+
+BOOST_AUTO_TEST_CASE(SimdMatchesScalar)
+{
+    InairaWindowLut simd;
+    InairaWindowLut scalar;
+    if (!simd.useSimd(true))
+    {
+        BOOST_TEST_MESSAGE("AVX2 not supported, skipping comparison");
+        return;
+    }
+    scalar.useSimd(false);
+
+    std::vector<uint16_t> pixels = all_values();
+    const double gammas[] = {1.0, 0.5, 2.2};
+    for (double gamma : gammas)
+    {
+        simd.configure(30000, 20000, gamma);
+        scalar.configure(30000, 20000, gamma);
+
+        // Lengths that leave a scalar tail after the 16 pixel vectors
+        const std::size_t lengths[] = {pixels.size(), pixels.size() - 1, 17, 15};
+        for (std::size_t length : lengths)
+        {
+            const uint16_t* start = pixels.data() + pixels.size() - length;
+            std::vector<uint8_t> simd_converted(length);
+            std::vector<uint8_t> scalar_converted(length);
+            simd.convert(start, simd_converted.data(), length);
+            scalar.convert(start, scalar_converted.data(), length);
+            BOOST_CHECK_EQUAL_COLLECTIONS(simd_converted.begin(), simd_converted.end(),
+                scalar_converted.begin(), scalar_converted.end());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SimdConvertInPlace)
+{
+    InairaWindowLut simd;
+    InairaWindowLut scalar;
+    simd.useSimd(true);
+    scalar.useSimd(false);
+    simd.configure(1000, 3000, 1.0);
+    scalar.configure(1000, 3000, 1.0);
+
+    std::srand(35);
+    std::vector<uint16_t> pixels(1003);
+    for (std::size_t idx = 0; idx < pixels.size(); idx++)
+    {
+        pixels[idx] = static_cast<uint16_t>(std::rand() & 0xFFF);
+    }
+    std::vector<uint8_t> expected(pixels.size());
+    scalar.convert(pixels.data(), expected.data(), pixels.size());
+
+    simd.convert(pixels.data(), reinterpret_cast<uint8_t*>(pixels.data()), pixels.size());
+    const uint8_t* converted = reinterpret_cast<const uint8_t*>(pixels.data());
+    BOOST_CHECK_EQUAL_COLLECTIONS(converted, converted + expected.size(),
+        expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END(); //InairaWindowLutUnitTest
@@ -21,6 +21,7 @@ using namespace log4cxx::helpers;
 #include "PcoCameraConfiguration.h"
 #include "PcoCameraDelayExposureConfig.h"
 #include "PcoCameraStatus.h"
+#include "InairaMetricsPage.h"
 
 #include "Cpco_com.h"
 #include "Cpco_grab_clhs.h"
@@ -96,13 +97,22 @@ namespace FrameReceiver
     //! Returns true if the camera is currently recording
     bool camera_recording(void) { return camera_recording_; }
 
+    //! Publishes acquisition metrics to a shared memory page, or stops if the name is empty
+    bool publish_metrics(const std::string& name);
+
   private:
 
     //! Acquires an image from camera into an image buffer
     bool acquire_image(void* image_buffer, int timeout);
 
     //! Calculates the image number from the timestamp in the first pixel data
-    int image_nr_from_timestamp(void *image_buffer, int shift);
+    uint32_t image_nr_from_timestamp(const void *image_buffer, int shift) const;
+
+    //! Calculates the camera timestamp in microseconds from the BCD timestamp in the pixel data
+    uint64_t time_from_timestamp(const void *image_buffer, int shift) const;
+
+    //! Returns the host realtime clock in nanoseconds since the epoch
+    static uint64_t realtime_ns(void);
 
     //! Checks camera error codes, setting camera error status and emitting error messages
     bool check_pco_error(const std::string message, DWORD pco_error = default_pco_error);
@@ -130,6 +140,9 @@ namespace FrameReceiver
     uint32_t image_pixel_size_;   //!< Image pixel size in bytes
     std::size_t image_data_type_; //!< Image data type for frame header
 
+    Inaira::MetricsPage metrics_; //!< Shared memory page of acquisition metrics
+    uint64_t frames_no_buffer_;   //!< Number of frames not acquired as no buffer was empty
+
   };
 }
 #endif // INCLUDE_PCOCAMERALINKCONTROLLER_H_
@@ -15,12 +15,21 @@
 
 #include "FrameDecoderCameraLink.h"
 #include "PcoCameraLinkController.h"
+#include "InairaTrace.h"
+#include "InairaPerfCounters.h"
+#include "InairaStartupTimer.h"
 
 namespace FrameReceiver
 {
 
   const std::string CAMERA_CONFIG_PATH = "camera";
   const std::string CAMERA_COMMAND_PATH = "command";
+  const std::string IMAGE_ALIGNMENT_PATH = "image_alignment";
+  const std::string TRACE_PATH = "trace";
+  const std::string TRACE_DUMP_PATH = "trace_dump";
+  const std::string METRICS_PATH = "metrics";
+  const std::string PERF_COUNTERS_PATH = "perf_counters";
+  const std::string PAYLOAD_CHECKSUM_PATH = "payload_checksum";
 
   class PcoCameraLinkFrameDecoder : public FrameDecoderCameraLink
   {
@@ -56,6 +65,9 @@ namespace FrameReceiver
     //! Returns the frame header size defined for this decoder
     const size_t get_frame_header_size(void) const;
 
+    //! Returns the alignment in bytes of the image in each frame buffer
+    const uint32_t get_image_alignment(void) const { return image_alignment_; }
+
     //! Monitors the state of allocated buffers in the decoder
     void monitor_buffers(void);
 
@@ -71,6 +83,21 @@ namespace FrameReceiver
     //! Returns the current status of the camera in an IPC message
     void get_status(const std::string param_prefix, OdinData::IpcMessage& status_reply);
 
+    //! Returns the tracer recording per-frame spans in the decoder and camera controller
+    Inaira::Tracer& get_tracer(void) { return tracer_; }
+
+    //! Returns the performance counters read around stages of the camera service loop
+    Inaira::PerfCounters& get_perf_counters(void) { return perf_; }
+
+    //! Indicates if a CRC32C of each image payload is calculated and stored in the frame header
+    const bool get_payload_checksum(void) const
+    {
+      return __atomic_load_n(&payload_checksum_, __ATOMIC_RELAXED);
+    }
+
+    //! Returns the timer recording the phases of camera controller startup
+    Inaira::StartupTimer& get_startup_timer(void) { return startup_; }
+
     //! Indicates if the camera control service thread is currently running
     const bool run_camera_service_thread(void) const { return run_thread_; }
 
@@ -82,6 +109,21 @@ namespace FrameReceiver
     //! Scoped pointer to the current PCO camera controller instance
     boost::scoped_ptr<PcoCameraLinkController> controller_;
 
+    //! Alignment in bytes of the image in each frame buffer
+    uint32_t image_alignment_;
+
+    //! Enables calculation of the image payload CRC32C on acquisition
+    bool payload_checksum_;
+
+    //! Tracer recording per-frame spans when enabled
+    Inaira::Tracer tracer_;
+
+    //! Per-stage performance counter totals of the camera service loop
+    Inaira::PerfCounters perf_;
+
+    //! Timing report of the camera controller startup phases
+    Inaira::StartupTimer startup_;
+
   };
 
 }
@@ -12,6 +12,7 @@
 #define PCOCAMERASTATUS_H_
 
 #include "ParamContainer.h"
+#include "InairaMemoryUsage.h"
 
 namespace FrameReceiver
 {
@@ -40,7 +41,19 @@ namespace FrameReceiver
                 error_message_(error_message_none),
                 camera_name_("unknown"),
                 camera_type_(0),
-                camera_serial_(0)
+                camera_serial_(0),
+                camera_dynamic_resolution_(0),
+                buffers_mapped_(0),
+                buffers_empty_(0),
+                buffers_in_use_(0),
+                buffers_in_use_high_water_(0),
+                buffer_size_(0),
+                buffer_bytes_mapped_(0),
+                buffer_bytes_high_water_(0),
+                buffer_occupancy_(0.0),
+                buffer_occupancy_high_water_(0.0),
+                rss_bytes_(0),
+                rss_peak_bytes_(0)
             {
                 bind_params();
             }
@@ -56,6 +69,53 @@ namespace FrameReceiver
                 error_message_ = error_message_none;
             }
 
+            //! Updates the frame buffer occupancy parameters
+            //!
+            //! This method updates the number of mapped, empty and in-use frame buffers, tracking
+            //! the high-water mark of buffers in use. The receiver maps as many buffers as fit in
+            //! its max_buffer_mem setting, so the occupancy fractions give the current and peak
+            //! use of that configured limit, where 1.0 means the frame buffers ran out.
+            //!
+            //! \param[in] num_mapped - number of frame buffers mapped by the decoder
+            //! \param[in] num_empty - number of mapped frame buffers currently empty
+
+            void update_buffer_status(unsigned long num_mapped, unsigned long num_empty)
+            {
+                buffers_mapped_ = num_mapped;
+                buffers_empty_ = num_empty;
+                buffers_in_use_ = (num_mapped > num_empty) ? (num_mapped - num_empty) : 0;
+                if (buffers_in_use_ > buffers_in_use_high_water_)
+                {
+                    buffers_in_use_high_water_ = buffers_in_use_;
+                }
+                if (buffers_mapped_ > 0)
+                {
+                    buffer_occupancy_ =
+                        static_cast<double>(buffers_in_use_) / buffers_mapped_;
+                    buffer_occupancy_high_water_ =
+                        static_cast<double>(buffers_in_use_high_water_) / buffers_mapped_;
+                }
+            }
+
+            //! Updates the memory footprint parameters
+            //!
+            //! This method updates the buffer sizes in bytes and the resident set size of the
+            //! receiver process. It reads /proc so is intended for status requests only.
+            //!
+            //! \param[in] buffer_size - size of each frame buffer in bytes
+
+            void update_memory_status(unsigned long buffer_size)
+            {
+                buffer_size_ = buffer_size;
+                buffer_bytes_mapped_ = buffers_mapped_ * buffer_size;
+                buffer_bytes_high_water_ = buffers_in_use_high_water_ * buffer_size;
+                if (memory_.read())
+                {
+                    rss_bytes_ = memory_.rss_bytes;
+                    rss_peak_bytes_ = memory_.rss_peak_bytes;
+                }
+            }
+
         private:
 
             void bind_params(void)
@@ -74,6 +134,20 @@ namespace FrameReceiver
                 bind_param<std::string>(camera_name_, "camera/info/name");
                 bind_param<unsigned int>(camera_type_, "camera/info/type");
                 bind_param<unsigned long>(camera_serial_, "camera/info/serial");
+                bind_param<unsigned int>(camera_dynamic_resolution_, "camera/info/dynamic_resolution");
+
+                // Bind frame buffer and memory footprint parameters
+                bind_param<unsigned long>(buffers_mapped_, "buffers/mapped");
+                bind_param<unsigned long>(buffers_empty_, "buffers/empty");
+                bind_param<unsigned long>(buffers_in_use_, "buffers/in_use");
+                bind_param<unsigned long>(buffers_in_use_high_water_, "buffers/in_use_high_water");
+                bind_param<unsigned long>(buffer_size_, "buffers/buffer_size");
+                bind_param<unsigned long>(buffer_bytes_mapped_, "buffers/bytes_mapped");
+                bind_param<unsigned long>(buffer_bytes_high_water_, "buffers/bytes_high_water");
+                bind_param<double>(buffer_occupancy_, "buffers/occupancy");
+                bind_param<double>(buffer_occupancy_high_water_, "buffers/occupancy_high_water");
+                bind_param<unsigned long>(rss_bytes_, "memory/rss_bytes");
+                bind_param<unsigned long>(rss_peak_bytes_, "memory/rss_peak_bytes");
             }
 
             std::string camera_state_name_;  //!< Name of the current camera state
@@ -87,6 +161,21 @@ namespace FrameReceiver
             std::string camera_name_;        //!< Camera name
             unsigned int camera_type_;       //!< Camera product type
             unsigned long camera_serial_;    //!< Camera serial number
+            unsigned int camera_dynamic_resolution_; //!< Camera sensor dynamic resolution in bits
+
+            unsigned long buffers_mapped_;   //!< Number of frame buffers mapped by the decoder
+            unsigned long buffers_empty_;    //!< Number of mapped frame buffers currently empty
+            unsigned long buffers_in_use_;   //!< Number of frame buffers in use downstream
+            unsigned long buffers_in_use_high_water_; //!< Highest number of buffers in use
+            unsigned long buffer_size_;      //!< Size of each frame buffer in bytes
+            unsigned long buffer_bytes_mapped_;      //!< Total bytes of frame buffers mapped
+            unsigned long buffer_bytes_high_water_;  //!< Highest bytes of frame buffers in use
+            double buffer_occupancy_;        //!< Fraction of mapped frame buffers in use
+            double buffer_occupancy_high_water_;     //!< Highest fraction of buffers in use
+            unsigned long rss_bytes_;        //!< Resident set size of the receiver process
+            unsigned long rss_peak_bytes_;   //!< Peak resident set size of the receiver process
+
+            Inaira::MemoryUsage memory_;     //!< Process memory usage reader
 
             //! Allow the PcoCameraLinkController class direct access to status parameters
             friend class PcoCameraLinkController;
@@ -12,6 +12,7 @@
  */
 
 #include <math.h>
+#include <time.h>
 
 #include "PcoCameraLinkController.h"
 #include "PcoCameraStateMachine.h"
@@ -20,6 +21,8 @@
 #include "file12.h"
 #include "IpcMessage.h"
 #include "InairaDefinitions.h"
+#include "InairaHotLog.h"
+#include "InairaCrc32c.h"
 
 using namespace FrameReceiver;
 
@@ -28,7 +31,8 @@ using namespace FrameReceiver;
 //! This constructor initialises the camera controller, setting up the initial state and
 //! configuration of the camera. In order for the decoder to report the image dimensions during
 //! frame receiver configuration, the camera is connected, armed and started so that the image
-//! width and height can be obtained from the frame grabber.
+//! width and height can be obtained from the frame grabber. Each phase of this is recorded in the
+//! startup timer of the decoder.
 //!
 //! \param decoder - pointer to the parent frame decoder
 
@@ -41,12 +45,24 @@ PcoCameraLinkController::PcoCameraLinkController(PcoCameraLinkFrameDecoder* deco
     camera_recording_(false),
     image_width_(0),
     image_height_(0),
-    image_data_type_(2) // TODO Get this from common header?
+    image_data_type_(2), // TODO Get this from common header?
+    frames_no_buffer_(0)
 {
     DWORD pco_error;
 
     LOG4CXX_INFO(logger_, "Initialising camera system");
 
+    // Bind the acquisition status and counters published to the shared memory metrics page
+    metrics_.bind("acquisition/acquiring", camera_status_.acquiring_);
+    metrics_.bind("acquisition/frames_acquired", camera_status_.frames_acquired_,
+        Inaira::MetricGauge);
+    metrics_.bind("acquisition/frames_no_buffer", frames_no_buffer_, Inaira::MetricCounter);
+    metrics_.bind("buffers/empty", camera_status_.buffers_empty_, Inaira::MetricGauge);
+    metrics_.bind("buffers/mapped", camera_status_.buffers_mapped_, Inaira::MetricGauge);
+    metrics_.bind("buffers/in_use_high_water", camera_status_.buffers_in_use_high_water_,
+        Inaira::MetricGauge);
+    metrics_.bind("camera/error/code", camera_status_.error_code_, Inaira::MetricGauge);
+
     // Initialise the camera system. In order for the controller to correctly report the camera
     // image size to the frame decoder and frame receiver controller, the camera must be connected
     // to, armed and started recording before the image size can be determined from the grabber.
@@ -60,10 +76,13 @@ PcoCameraLinkController::PcoCameraLinkController(PcoCameraLinkFrameDecoder* deco
         camera_state_.execute_command(PcoCameraState::CommandConnect);
 
         // Arm and start the camera recording so that the image size can be determined from the
-        // frame grabber
+        // frame grabber, timing each startup phase
+        Inaira::StartupPhase phase(decoder_->get_startup_timer(), "arm");
         camera_state_.execute_command(PcoCameraState::CommandArm);
+        phase.next("first_record");
         camera_state_.execute_command(PcoCameraState::CommandStartRecording);
 
+        phase.next("grabber_size_query");
         pco_error = grabber_->Get_actual_size(&image_width_, &image_height_, NULL);
         if (check_pco_error("Failed to get actual size from grabber", pco_error))
         {
@@ -76,7 +95,9 @@ PcoCameraLinkController::PcoCameraLinkController(PcoCameraLinkFrameDecoder* deco
         }
 
         // Stop the camera recording
+        phase.next("stop_record");
         camera_state_.execute_command(PcoCameraState::CommandStopRecording);
+        phase.end();
 
     }
     catch (PcoCameraStateException&)
@@ -93,6 +114,9 @@ PcoCameraLinkController::PcoCameraLinkController(PcoCameraLinkFrameDecoder* deco
 PcoCameraLinkController::~PcoCameraLinkController()
 {
     this->disconnect();
+
+    // Log any hot path messages while their format literals are still loaded
+    Inaira::HotLog::instance().flush();
 }
 
 
@@ -254,6 +278,7 @@ void PcoCameraLinkController::get_status(ParamContainer::Document& params,
     const std::string param_prefix)
 {
     camera_status_.camera_state_name_ = camera_state_.current_state_name();
+    camera_status_.update_memory_status(decoder_->get_frame_buffer_size());
     camera_status_.encode(params, param_prefix);
 }
 
@@ -320,6 +345,10 @@ bool PcoCameraLinkController::connect(void)
 
     LOG4CXX_INFO(logger_, "Connecting camera");
 
+    // Time the camera and grabber open and the reads of the camera description and settings as
+    // startup phases. These are ignored when reconnecting once startup is complete.
+    Inaira::StartupPhase phase(decoder_->get_startup_timer(), "camera_open");
+
     // Create a new PCO camera instance
     LOG4CXX_DEBUG_LEVEL(2, logger_, "Creating PCO camera instance")
     camera_.reset(new CPco_com_clhs());
@@ -368,6 +397,7 @@ bool PcoCameraLinkController::connect(void)
     }
 
     // Read the camera type and serial number
+    phase.next("descriptor_read");
     LOG4CXX_DEBUG_LEVEL(2, logger_, "Getting camera type and serial number");
     pco_error = camera_->PCO_GetCameraType(&camera_type, &camera_serial);
     if (!check_pco_error("Failed to get camera type", pco_error))
@@ -383,6 +413,7 @@ bool PcoCameraLinkController::connect(void)
         return false;
     }
     image_pixel_size_ = floorl((camera_description.wDynResDESC-1)/8) + 1;
+    camera_status_.camera_dynamic_resolution_ = camera_description.wDynResDESC;
     LOG4CXX_INFO(logger_, "Camera descriptor reports dynamic resolution: " <<
         camera_description.wDynResDESC << " pixel size: " << image_pixel_size_ << " bytes"
     );
@@ -406,6 +437,7 @@ bool PcoCameraLinkController::connect(void)
     );
 
     // Read the camera delay and exposure settings
+    phase.next("settings_read");
     LOG4CXX_DEBUG_LEVEL(2, logger_, "Getting camera delay and exposure times");
     pco_error = camera_->PCO_GetDelayExposure(
         &(camera_delay_exp_.delay_time_), &(camera_delay_exp_.exposure_time_)
@@ -652,30 +684,90 @@ void PcoCameraLinkController::run_camera_service(void)
             void* buffer_addr;
             if (decoder_->get_empty_buffer(buffer_id, buffer_addr))
             {
-                LOG4CXX_DEBUG_LEVEL(2, logger_, "Decoder got empty buffer id " << buffer_id
-                    << " at addr 0x" << std::hex << (unsigned long)buffer_addr << std::dec );
-
-                // Get a pointer to the image location in the buffer, o.e. offset from the start
-                // of the buffer by the header size
-                void* image_buffer = reinterpret_cast<void*>(
-                    reinterpret_cast<uint8_t*>(buffer_addr) + decoder_->get_frame_header_size()
-                );
-
-                // Acquire an image from the camera into the buffer
-                if (this->acquire_image(image_buffer, image_timeout_ms))
+                INAIRA_HOTLOG_DEBUG_LEVEL(2, logger_, "Decoder got empty buffer id {} at addr 0x{}",
+                    buffer_id, Inaira::HotLogHex(buffer_addr));
+
+                // Get a pointer to the image location in the buffer, i.e. offset from the start
+                // of the buffer by the header size and padded to the image alignment. Shared
+                // buffers are not themselves aligned, so the padding depends on the address
+                uintptr_t image_addr = reinterpret_cast<uintptr_t>(buffer_addr)
+                    + sizeof(Inaira::FrameHeader);
+                uintptr_t image_alignment = decoder_->get_image_alignment();
+                image_addr = (image_addr + image_alignment - 1) & ~(image_alignment - 1);
+                void* image_buffer = reinterpret_cast<void*>(image_addr);
+
+                // Acquire an image from the camera into the buffer, recording the host time
+                // either side of the acquisition
+                uint64_t acquisition_start_ns = realtime_ns();
+                bool image_acquired;
+                {
+                    Inaira::TraceSpan span(
+                        decoder_->get_tracer(), "grab", camera_status_.frames_acquired_);
+                    Inaira::PerfStageSpan perf_span(decoder_->get_perf_counters(), "grab");
+                    image_acquired = this->acquire_image(image_buffer, image_timeout_ms);
+                }
+                if (image_acquired)
                 {
+                    uint64_t acquisition_end_ns = realtime_ns();
+                    uint64_t grab_mono_ns = Inaira::monotonic_clock_ns();
+
                     // Populate the fields of the frame header
                     Inaira::FrameHeader* frame_hdr =
                         reinterpret_cast<Inaira::FrameHeader*>(buffer_addr);
+                    frame_hdr->magic = Inaira::FRAME_HEADER_MAGIC;
+                    frame_hdr->version = Inaira::FRAME_HEADER_VERSION;
+                    frame_hdr->header_size = sizeof(Inaira::FrameHeader);
                     frame_hdr->frame_number = camera_status_.frames_acquired_;
                     frame_hdr->frame_width = image_width_;
                     frame_hdr->frame_height = image_height_;
                     frame_hdr->frame_data_type = image_data_type_;
                     frame_hdr->frame_size = get_image_size();
+                    frame_hdr->status_flags =
+                        Inaira::FrameHostTimestamps | Inaira::FrameMonotonicTimestamps;
+                    frame_hdr->acquisition_start_ns = acquisition_start_ns;
+                    frame_hdr->acquisition_end_ns = acquisition_end_ns;
+                    frame_hdr->grab_mono_ns = grab_mono_ns;
+                    frame_hdr->image_offset = static_cast<uint32_t>(
+                        image_addr - reinterpret_cast<uintptr_t>(buffer_addr));
+                    frame_hdr->payload_crc = 0;
+                    frame_hdr->reserved = 0;
+
+                    // Calculate the CRC32C of the image as received from the grabber if enabled,
+                    // so that the frame processor can detect corruption after acquisition
+                    if (decoder_->get_payload_checksum())
+                    {
+                        Inaira::TraceSpan span(
+                            decoder_->get_tracer(), "checksum", camera_status_.frames_acquired_);
+                        Inaira::PerfStageSpan perf_span(decoder_->get_perf_counters(), "checksum");
+                        frame_hdr->payload_crc = Inaira::crc32c(image_buffer, frame_hdr->frame_size);
+                        frame_hdr->status_flags |= Inaira::FramePayloadChecksum;
+                    }
+
+                    // Decode the camera image number and time from the BCD timestamp in the
+                    // first pixels of the image if the camera timestamp mode includes it
+                    frame_hdr->camera_image_number = 0;
+                    frame_hdr->camera_timestamp = 0;
+                    if ((camera_config_.timestamp_mode_ == 1) ||
+                        (camera_config_.timestamp_mode_ == 2))
+                    {
+                        frame_hdr->status_flags |= Inaira::FrameCameraTimestamp;
+                        frame_hdr->camera_image_number =
+                            this->image_nr_from_timestamp(image_buffer, 0);
+                        frame_hdr->camera_timestamp = this->time_from_timestamp(image_buffer, 0);
+                        INAIRA_HOTLOG_DEBUG_LEVEL(2, logger_,
+                            "Frame {} has camera image number {} timestamp {}",
+                            camera_status_.frames_acquired_, frame_hdr->camera_image_number,
+                            frame_hdr->camera_timestamp);
+                    }
 
                     // Notify the frame receiver main control thread that the frame is ready to
-                    // be processed downstream
-                    decoder_->notify_frame_ready(buffer_id, camera_status_.frames_acquired_);
+                    // be processed downstream, stamping the header with the time of notification
+                    frame_hdr->ready_mono_ns = Inaira::monotonic_clock_ns();
+                    {
+                        Inaira::TraceSpan span(
+                            decoder_->get_tracer(), "notify", camera_status_.frames_acquired_);
+                        decoder_->notify_frame_ready(buffer_id, camera_status_.frames_acquired_);
+                    }
                     camera_status_.frames_acquired_++;
                 }
             }
@@ -684,6 +776,7 @@ void PcoCameraLinkController::run_camera_service(void)
                 // The logic of handling when no buffers are available needs improving with
                 // retry attempts, but for now simply report the failure as a warning
                 LOG4CXX_WARN(logger_, "Failed to get empty buffer from queue");
+                frames_no_buffer_++;
             }
 
             // If the current configuration specifies a number of frames to acquire, check if
@@ -719,9 +812,47 @@ void PcoCameraLinkController::run_camera_service(void)
             }
             usleep(1000);
         }
+
+        // Publish the acquisition metrics, updating the buffer counts from the decoder first
+        camera_status_.update_buffer_status(
+            decoder_->get_num_mapped_buffers(), decoder_->get_num_empty_buffers()
+        );
+        metrics_.publish();
     }
 }
 
+//! Publishes acquisition metrics to a shared memory page
+//!
+//! This method creates a shared memory metrics page of the specified name, to which the camera
+//! service loop publishes the acquisition status, frame counters and buffer occupancy on every
+//! iteration. Monitoring tools can read the page at any rate without sending status requests to
+//! the decoder. An empty name removes the page and stops publishing.
+//!
+//! \param name - POSIX shared memory name of the metrics page
+//! \return true if the page was created or removed successfully
+
+bool PcoCameraLinkController::publish_metrics(const std::string& name)
+{
+    if (name.empty())
+    {
+        metrics_.destroy();
+        return true;
+    }
+    if (!metrics_.create(name))
+    {
+        LOG4CXX_ERROR(logger_, "Failed to create metrics page " << name << ": "
+            << strerror(errno));
+        return false;
+    }
+    LOG4CXX_INFO(logger_, "Publishing acquisition metrics to shared memory " << metrics_.name);
+    if (metrics_.droppedBindings() > 0)
+    {
+        LOG4CXX_ERROR(logger_, metrics_.droppedBindings()
+            << " metrics did not fit in the metrics page and are not published");
+    }
+    return true;
+}
+
 //! Returns the name of the current camera state
 //!
 //! This method returns the readable name of the current state of the camera state machine
@@ -798,40 +929,89 @@ bool PcoCameraLinkController::acquire_image(void* image_buffer, int timeout)
     pco_error = grabber_->Wait_For_Next_Image(reinterpret_cast<WORD*>(image_buffer), timeout);
     acquire_ok = check_pco_error("Failed to acquire an image", pco_error);
 
-    if (acquire_ok)
-    {
-        int image_num = this->image_nr_from_timestamp(image_buffer, 0);
-        LOG4CXX_DEBUG_LEVEL(
-            2, logger_, "Image acquisition completed OK with image number: " << image_num
-        );
-    }
-
     return acquire_ok;
 }
 
 //! Calculates the image number from the timestamp in the first pixel data
 //!
 //! This method, taken from an example in the PCO SDK demo applications, calculates the camera
-//! image number from the BCD coded values stored in the first four pixels of the image.
+//! image number from the BCD coded values stored in the first four pixels of the image. The
+//! pixel values are shifted locally and the image buffer is not modified.
 //!
 //! \param image_buffer - pointer to image buffer in memory
 //! \param shift - number of bits to right-shift each BCD pixel value
-//! \return image number as an integer
+//! \return image number as an unsigned integer
 
-int PcoCameraLinkController::image_nr_from_timestamp(void *image_buffer, int shift)
+uint32_t PcoCameraLinkController::image_nr_from_timestamp(const void *image_buffer, int shift) const
 {
-    int image_num = 0;
-    unsigned short *pixel_ptr = (unsigned short *)(image_buffer);
+    uint32_t image_num = 0;
+    const uint16_t *pixel_ptr = static_cast<const uint16_t*>(image_buffer);
 
-    for (int bcd_mult = 100*100*100; bcd_mult > 0; bcd_mult /= 100)
+    for (uint32_t bcd_mult = 100*100*100; bcd_mult > 0; bcd_mult /= 100)
     {
-        *pixel_ptr >>= shift;
-        image_num += (((*pixel_ptr & 0x00F0)>>4)*10 + (*pixel_ptr & 0x000F)) * bcd_mult ;
+        uint16_t pixel = *pixel_ptr >> shift;
+        image_num += (((pixel & 0x00F0)>>4)*10 + (pixel & 0x000F)) * bcd_mult;
         pixel_ptr++;
     }
     return image_num;
 }
 
+//! Calculates the camera timestamp in microseconds from the BCD timestamp in the pixel data
+//!
+//! This method decodes the camera date and time from the BCD coded values stored in pixels 4 to
+//! 13 of the image, following the image number. These hold the year (two pixels), month, day,
+//! hour, minute, second and microseconds (three pixels). The camera clock time is returned as
+//! microseconds since the epoch. The image buffer is not modified.
+//!
+//! \param image_buffer - pointer to image buffer in memory
+//! \param shift - number of bits to right-shift each BCD pixel value
+//! \return camera timestamp in microseconds, or zero if the timestamp is invalid
+
+uint64_t PcoCameraLinkController::time_from_timestamp(const void *image_buffer, int shift) const
+{
+    const uint16_t *pixel_ptr = static_cast<const uint16_t*>(image_buffer) + 4;
+
+    unsigned int bcd[10];
+    for (int idx = 0; idx < 10; idx++)
+    {
+        uint16_t pixel = pixel_ptr[idx] >> shift;
+        bcd[idx] = ((pixel & 0x00F0)>>4)*10 + (pixel & 0x000F);
+    }
+
+    struct tm camera_time = {};
+    camera_time.tm_year = (bcd[0] * 100 + bcd[1]) - 1900;
+    camera_time.tm_mon = static_cast<int>(bcd[2]) - 1;
+    camera_time.tm_mday = bcd[3];
+    camera_time.tm_hour = bcd[4];
+    camera_time.tm_min = bcd[5];
+    camera_time.tm_sec = bcd[6];
+
+    if ((camera_time.tm_mon < 0) || (camera_time.tm_mday == 0))
+    {
+        return 0;
+    }
+
+    uint64_t usecs = bcd[7] * 10000 + bcd[8] * 100 + bcd[9];
+    time_t secs = timegm(&camera_time);
+
+    return (static_cast<uint64_t>(secs) * 1000000) + usecs;
+}
+
+//! Returns the host realtime clock in nanoseconds since the epoch
+//!
+//! This method reads the host realtime clock, used to stamp the frame header with the time of
+//! image acquisition so that it can be compared with the camera timestamp and with the time at
+//! which results are produced downstream.
+//!
+//! \return realtime clock in nanoseconds
+
+uint64_t PcoCameraLinkController::realtime_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (static_cast<uint64_t>(now.tv_sec) * 1000000000) + now.tv_nsec;
+}
+
 //! Checks camera error codes, setting camera error status and emitting error messages
 //!
 //! This method checks camera error codes, setting the error fields in the camera status parameter
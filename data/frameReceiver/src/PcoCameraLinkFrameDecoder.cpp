@@ -23,7 +23,9 @@ using namespace FrameReceiver;
 //! decoder and the PCO camera controller is done later during a call to the init() method.
 
 PcoCameraLinkFrameDecoder::PcoCameraLinkFrameDecoder() :
-    FrameDecoderCameraLink()
+    FrameDecoderCameraLink(),
+    image_alignment_(Inaira::FRAME_IMAGE_ALIGNMENT),
+    payload_checksum_(false)
 {
 
     this->logger_ = Logger::getLogger("FR.PcoCLFrameDecoder");
@@ -100,7 +102,12 @@ std::string PcoCameraLinkFrameDecoder::get_version_long()
 //!
 //! This method initialises the decoder from the configuration message received as an argument. The
 //! base class init() method is called and a new PcoCameraLinkController instance created to control
-//! the camera.
+//! the camera. The optional image_alignment parameter sets the alignment of the image in each
+//! frame buffer, from 64 bytes (a cache line) to 4096 bytes (a page). This is fixed at
+//! initialisation as it determines the frame buffer size. The optional metrics parameter names
+//! the shared memory page the controller publishes acquisition metrics to. The optional
+//! payload_checksum parameter enables a CRC32C of each image in the frame header. The phases of
+//! controller startup are timed and logged, and reported in the startup status group.
 //!
 //! \param logger - deprecated argument retained for compatiblity
 //! \param config_msg - IPC message containing decoder configuration parameters
@@ -112,8 +119,52 @@ void PcoCameraLinkFrameDecoder::init(LoggerPtr& logger, OdinData::IpcMessage& co
   // Pass the configuration message to the base class decoder
   FrameDecoderCameraLink::init(config_msg);
 
-  // Instantiate a new camera controller
-  controller_.reset(new PcoCameraLinkController(this));
+  // Set the image alignment if specified, retaining the default if the value is not valid
+  if (config_msg.has_param(IMAGE_ALIGNMENT_PATH))
+  {
+    uint32_t image_alignment = config_msg.get_param<unsigned int>(IMAGE_ALIGNMENT_PATH);
+    if (Inaira::valid_image_alignment(image_alignment))
+    {
+      image_alignment_ = image_alignment;
+    }
+    else
+    {
+      LOG4CXX_ERROR(logger_, "Invalid image alignment " << image_alignment
+        << ", using default of " << image_alignment_ << " bytes");
+    }
+  }
+  LOG4CXX_INFO(logger_, "Frame buffer images aligned to " << image_alignment_ << " bytes");
+
+  // Enable the image payload checksum if specified
+  if (config_msg.has_param(PAYLOAD_CHECKSUM_PATH))
+  {
+    __atomic_store_n(
+      &payload_checksum_, config_msg.get_param<bool>(PAYLOAD_CHECKSUM_PATH), __ATOMIC_RELAXED
+    );
+  }
+  LOG4CXX_INFO(logger_, "Frame payload checksum "
+    << (payload_checksum_ ? "enabled" : "disabled"));
+
+  // Instantiate a new camera controller, which times the phases of connecting to and starting the
+  // camera. Report the timing whether or not startup succeeds so that slow or failing phases can
+  // be identified.
+  try
+  {
+    controller_.reset(new PcoCameraLinkController(this));
+  }
+  catch (FrameDecoderException&)
+  {
+    LOG4CXX_ERROR(logger_, "Camera controller startup failed after: " << startup_.report());
+    throw;
+  }
+  startup_.complete();
+  LOG4CXX_INFO(logger_, "Camera controller startup complete: " << startup_.report());
+
+  // Start publishing acquisition metrics if a metrics page name is specified
+  if (config_msg.has_param(METRICS_PATH))
+  {
+    controller_->publish_metrics(config_msg.get_param<std::string>(METRICS_PATH));
+  }
 
 }
 
@@ -122,6 +173,8 @@ void PcoCameraLinkFrameDecoder::init(LoggerPtr& logger, OdinData::IpcMessage& co
 //! This method calcualtes and returns the frame buffer size required for image acqusition. This is
 //! used by the frame reeiver controller during initialisation to configure the frame shared memory
 //! buffer. The controller determines the raw image size based on the configuration of the camera.
+//! The size is rounded up to a multiple of the image alignment so that the image is at the same
+//! offset in every buffer.
 //!
 //! \return frame buffer size in bytes
 
@@ -132,6 +185,7 @@ const size_t PcoCameraLinkFrameDecoder::get_frame_buffer_size(void) const
   if (controller_)
   {
     frame_buffer_size += controller_->get_image_size();
+    frame_buffer_size = (frame_buffer_size + image_alignment_ - 1) & ~(size_t)(image_alignment_ - 1);
     LOG4CXX_DEBUG_LEVEL(2, logger_, "Calculated frame buffer size: " << frame_buffer_size);
   }
   else
@@ -143,13 +197,15 @@ const size_t PcoCameraLinkFrameDecoder::get_frame_buffer_size(void) const
 
 //! Returns the frame header size defined for this decoder.
 //!
-//! This method returns the size of the frame header used during image acqusition by this decoder.
+//! This method returns the size of the frame header region used during image acqusition by this
+//! decoder. This is the header plus the largest padding needed to align the image that follows
+//! it, wherever the buffer starts in memory.
 //!
 //! \return frame header size in bytes
 
 const size_t PcoCameraLinkFrameDecoder::get_frame_header_size(void) const
 {
-  return sizeof(Inaira::FrameHeader);
+  return sizeof(Inaira::FrameHeader) + image_alignment_ - 1;
 }
 
 //! Monitors the state of allocated buffers in the decoder.
@@ -275,7 +331,13 @@ void PcoCameraLinkFrameDecoder::handle_ctrl_channel(void)
 //! This method is called in response to receipt of a configuration command message on the
 //! control channel. If the message parameter payload includes camera parameters, these are
 //! passed to the camera controller for handling. If the payload contains a command parameter,
-//! this is passed to the controller to be executed.
+//! this is passed to the controller to be executed. The trace parameter enables or disables
+//! tracing of per-frame spans, and the trace_dump parameter writes the recorded spans to the
+//! specified file as Chrome trace event JSON. The metrics parameter names the shared memory page
+//! the controller publishes acquisition metrics to, or is empty to stop publishing them. The
+//! perf_counters parameter enables reading performance counters around the image grab, which
+//! are reported in the decoder status. The payload_checksum parameter enables or disables the
+//! CRC32C of each image stored in the frame header for verification in the frame processor.
 //!
 //! TODO - handle failure cases here so that response to client is updated
 //!
@@ -286,8 +348,53 @@ void PcoCameraLinkFrameDecoder::configure(
   OdinData::IpcMessage& config_msg, OdinData::IpcMessage& config_reply
 )
 {
+  if (config_msg.has_param(TRACE_PATH))
+  {
+    tracer_.enable(config_msg.get_param<bool>(TRACE_PATH));
+    LOG4CXX_INFO(logger_, "Tracing " << (tracer_.enabled() ? "enabled" : "disabled"));
+  }
+  if (config_msg.has_param(TRACE_DUMP_PATH))
+  {
+    std::string trace_file = config_msg.get_param<std::string>(TRACE_DUMP_PATH);
+    std::size_t num_events = 0;
+    if (tracer_.dump(trace_file, "PcoCameraLinkFrameDecoder", num_events))
+    {
+      LOG4CXX_INFO(logger_, "Dumped " << num_events << " trace events to " << trace_file);
+    }
+    else
+    {
+      LOG4CXX_ERROR(logger_, "Failed to dump trace events to " << trace_file);
+      config_reply.set_nack("Failed to dump trace to " + trace_file);
+    }
+  }
+
+  if (config_msg.has_param(PERF_COUNTERS_PATH))
+  {
+    perf_.enable(config_msg.get_param<bool>(PERF_COUNTERS_PATH));
+    LOG4CXX_INFO(logger_, "Performance counters " << (perf_.enabled() ? "enabled" : "disabled"));
+  }
+
+  if (config_msg.has_param(PAYLOAD_CHECKSUM_PATH))
+  {
+    __atomic_store_n(
+      &payload_checksum_, config_msg.get_param<bool>(PAYLOAD_CHECKSUM_PATH), __ATOMIC_RELAXED
+    );
+    LOG4CXX_INFO(logger_, "Frame payload checksum "
+      << (get_payload_checksum() ? "enabled" : "disabled"));
+  }
+
   if (controller_)
   {
+    // If the configuration message has a metrics page name, tell the controller to publish to it
+    if (config_msg.has_param(METRICS_PATH))
+    {
+      std::string metrics_name = config_msg.get_param<std::string>(METRICS_PATH);
+      if (!controller_->publish_metrics(metrics_name))
+      {
+        config_reply.set_nack("Failed to create metrics page " + metrics_name);
+      }
+    }
+
     // If the configuration message has camera parameters, copy those into a parameter document
     // and tell the controller to update its configuration
     if (config_msg.has_param(CAMERA_CONFIG_PATH))
@@ -334,6 +441,7 @@ void PcoCameraLinkFrameDecoder::request_configuration(
 
   // Call the base class method to populate parameters
   FrameDecoderCameraLink::request_configuration(param_prefix, config_reply);
+  config_reply.set_param(param_prefix + PAYLOAD_CHECKSUM_PATH, get_payload_checksum());
 
   if (controller_)
   {
@@ -371,6 +479,12 @@ void PcoCameraLinkFrameDecoder::get_status(
   // Insert the decoder name into the reply
   status_reply.set_param(param_prefix + "name", std::string("PcoCameraLinkFrameDecoder"));
 
+  // Insert the performance counters of the camera service loop stages
+  perf_.status(status_reply, param_prefix + "perf/");
+
+  // Insert the timing report of the camera controller startup phases
+  startup_.status(status_reply, param_prefix + "startup/");
+
   if (controller_)
   {
     // Create a new parame document and pass to the controller to populate with the appropriate
@@ -18,6 +18,22 @@ from odin_data.ipc_message import IpcMessage, IpcMessageException
 
 from .frame_producer_config import FrameProducerConfig
 
+# Frame header layout, matching Inaira::FrameHeader in InairaDefinitions.h: magic, version,
+# header_size, frame_number, frame_width, frame_height, frame_data_type, frame_size, status_flags,
+# acquisition_start_ns, acquisition_end_ns, camera_image_number, image_offset, camera_timestamp,
+# grab_mono_ns, ready_mono_ns, payload_crc, reserved
+FRAME_HEADER_FORMAT = "<IHHIIIIIIQQIIQQQII"
+FRAME_HEADER_SIZE = struct.calcsize(FRAME_HEADER_FORMAT)
+FRAME_HEADER_MAGIC = 0x49414E49
+FRAME_HEADER_VERSION = 4
+
+# Frame header status flags
+FRAME_HOST_TIMESTAMPS = 1 << 0
+FRAME_CAMERA_TIMESTAMP = 1 << 1
+FRAME_SIMULATED = 1 << 2
+FRAME_MONOTONIC_TIMESTAMPS = 1 << 3
+FRAME_PAYLOAD_CHECKSUM = 1 << 4
+
 class FrameProducer():
 
     def __init__(self, config_file):
@@ -167,7 +183,8 @@ class FrameProducer():
                     # Set image path based on frame number
                     testimage = file_list[self.frame%len(file_list)]
 
-                    # Load image
+                    # Load image, recording the host time either side as the acquisition time
+                    acquisition_start_ns = time.time_ns()
                     vals = io.imread(join(imgs_path,testimage))
 
                     # Is the image RGB or Grayscale?
@@ -186,19 +203,34 @@ class FrameProducer():
                     # TODO deal with empty queue??
                     buffer = self.free_buffer_queue.get()
 
-                    # Split image shape from (x, y) into x and y
+                    # Split the row-major image shape (rows, columns) into height and width
                     imageshape = vals.shape
-                    imagewidth = imageshape[0]
-                    imageheight = imageshape[1]
+                    imageheight = imageshape[0]
+                    imagewidth = imageshape[1]
                     self.logger.debug("Width " + str(imagewidth) + " Height " + str(imageheight) + "\n")
 
                     # What is the dtype outputting
                     self.logger.debug("Data Type: " + str(vals.dtype))
                     self.logger.debug("Data Type Enumeration: " + str(self.get_dtype_enumeration(vals.dtype.name)) + "\n")
 
-                    # Create struct with these parameters for the header
-                    # frame_header, (currently ignoring)frame_state, frame_start_time_secs, frame_start_time_nsecs, frame_width, frame_height, frame_data_type, frame_size
-                    header = struct.pack("iiiii", self.frame, imagewidth, imageheight, self.get_dtype_enumeration(vals.dtype.name), vals.size)
+                    # Create struct with these parameters for the header. The camera image number
+                    # and timestamp are zero as there is no camera to stamp the image. The image
+                    # follows the header padded to the configured alignment from the buffer start.
+                    # The monotonic clock is CLOCK_MONOTONIC, shared with the frame processor. No
+                    # payload checksum is calculated, so the checksum flag is not set
+                    acquisition_end_ns = time.time_ns()
+                    grab_mono_ns = time.monotonic_ns()
+                    alignment = self.config.image_alignment
+                    image_offset = ((FRAME_HEADER_SIZE + alignment - 1) // alignment) * alignment
+                    header = struct.pack(
+                        FRAME_HEADER_FORMAT, FRAME_HEADER_MAGIC, FRAME_HEADER_VERSION,
+                        FRAME_HEADER_SIZE, self.frame, imagewidth, imageheight,
+                        self.get_dtype_enumeration(vals.dtype.name), vals.nbytes,
+                        FRAME_HOST_TIMESTAMPS | FRAME_SIMULATED | FRAME_MONOTONIC_TIMESTAMPS,
+                        acquisition_start_ns, acquisition_end_ns, 0, image_offset, 0,
+                        grab_mono_ns, time.monotonic_ns(), 0, 0
+                    )
+                    header += bytes(image_offset - FRAME_HEADER_SIZE)
 
                     # Copy the image nparray directly into the buffer as bytes
                     self.logger.debug("Filling frame %d into buffer %d", self.frame, buffer)
@@ -16,6 +16,7 @@ class FrameProducerConfig:
     frames = 0
     testfile_path = (os.getcwd().split("tools"))[0] + "/Test-Images/"
     frames_per_second = 1
+    image_alignment = 64
 
     config_file: InitVar[str] = None
 
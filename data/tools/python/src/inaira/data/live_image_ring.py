@@ -0,0 +1,128 @@
+# Reader for the shared memory live image ring written by the INAIRA ML frame processor plugin.
+#
+# The InairaMLPlugin can write the latest preview images, with their classification and score,
+# into a POSIX shared memory ring (see InairaLiveImageRingDefinitions.h). This module maps the
+# ring and reads the newest image without any socket traffic, using the per-slot sequence number
+# as a seqlock to detect images overwritten during the read.
+import mmap
+import os
+import struct
+import time
+
+import click
+import numpy as np
+
+
+class LiveImageRingError(Exception):
+    """Exception raised for errors accessing the live image ring."""
+    pass
+
+
+class LiveImageRingReader():
+    """Live image ring reader.
+
+    This class maps the shared memory live image ring read-only and returns the newest image.
+    """
+
+    RING_MAGIC = 0x474E5249
+    RING_VERSION = 1
+    RING_HEADER = struct.Struct("<IIIIQQ")
+    RING_HEADER_SIZE = 64
+    SLOT_HEADER = struct.Struct("<QQIfIIII")
+    SLOT_HEADER_SIZE = 64
+    WRITE_COUNT_OFFSET = 24
+
+    DTYPES = [None, np.uint8, np.uint16, np.uint32, np.uint64, np.float32]
+    CLASSES = ["defective", "good"]
+
+    def __init__(self, name):
+        """Map the ring with the specified POSIX shared memory name."""
+        path = os.path.join("/dev/shm", name.lstrip("/"))
+        try:
+            with open(path, "rb") as ring_file:
+                self.ring = mmap.mmap(ring_file.fileno(), 0, access=mmap.ACCESS_READ)
+        except OSError as e:
+            raise LiveImageRingError("Unable to map live image ring {}: {}".format(name, e))
+
+        (magic, version, self.num_slots, self.slot_size, self.max_image_size, _) = \
+            self.RING_HEADER.unpack_from(self.ring, 0)
+        if magic != self.RING_MAGIC or version != self.RING_VERSION:
+            raise LiveImageRingError(
+                "Shared memory {} is not a version {} live image ring".format(
+                    name, self.RING_VERSION
+                )
+            )
+
+    def write_count(self):
+        """Return the total number of images written to the ring."""
+        return struct.unpack_from("<Q", self.ring, self.WRITE_COUNT_OFFSET)[0]
+
+    def read_latest(self, retries=10):
+        """Read the newest image in the ring.
+
+        Returns a tuple of an info dictionary and a numpy array of the image, or None if no
+        image has been written yet. The read is retried if the slot is overwritten during it.
+        """
+        for _ in range(retries):
+            write_count = self.write_count()
+            if write_count == 0:
+                return None
+
+            slot_offset = self.RING_HEADER_SIZE + ((write_count - 1) % self.num_slots) * self.slot_size
+            sequence = struct.unpack_from("<Q", self.ring, slot_offset)[0]
+            if sequence & 1:
+                continue
+
+            (_, frame_number, classification, score, height, width, data_type, image_size) = \
+                self.SLOT_HEADER.unpack_from(self.ring, slot_offset)
+            data_offset = slot_offset + self.SLOT_HEADER_SIZE
+            image = bytes(self.ring[data_offset:data_offset + image_size])
+
+            if struct.unpack_from("<Q", self.ring, slot_offset)[0] != sequence:
+                continue
+
+            info = {
+                "frame_number": frame_number,
+                "classification": (
+                    self.CLASSES[classification] if classification < len(self.CLASSES)
+                    else "unknown"
+                ),
+                "score": score,
+                "shape": [height, width],
+            }
+            dtype = self.DTYPES[data_type] if data_type < len(self.DTYPES) else None
+            if dtype is None:
+                raise LiveImageRingError("Unsupported image data type {}".format(data_type))
+            data = np.frombuffer(image, dtype=dtype).reshape(height, width)
+            return info, data
+
+        return None
+
+    def close(self):
+        """Unmap the ring."""
+        self.ring.close()
+
+
+@click.command()
+@click.option('--name', default="inaira_live", help="Shared memory name of the live image ring")
+@click.option('--interval', default=1.0, help="Interval in seconds between reads")
+def main(name, interval):
+    """Print the newest image in the live image ring at a regular interval."""
+    reader = LiveImageRingReader(name)
+    try:
+        while True:
+            latest = reader.read_latest()
+            if latest:
+                info, data = latest
+                print("frame {frame_number} {classification} score {score:.3f} shape {shape}".format(
+                    **info
+                ), "mean {:.1f}".format(data.mean()))
+            time.sleep(interval)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        reader.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,197 @@
+# Reader for the shared memory metrics pages published by the INAIRA receiver and plugins.
+#
+# The PCO camera controller and the INAIRA frame processor plugins can publish their counters,
+# gauges and latency histograms into a fixed layout POSIX shared memory page (see
+# InairaMetricsPage.h). This module maps the pages and takes consistent snapshots of them, using
+# the page sequence number as a seqlock, without sending any requests to the processes.
+import mmap
+import os
+import struct
+import time
+
+import click
+
+
+class MetricsPageError(Exception):
+    """Exception raised for errors accessing a metrics page."""
+    pass
+
+
+class MetricsPageReader():
+    """Metrics page reader.
+
+    This class maps a shared memory metrics page read-only and returns snapshots of its metrics.
+    """
+
+    PAGE_MAGIC = 0x54454D49
+    PAGE_VERSION = 1
+    PAGE_HEADER = struct.Struct("<IIIIQQ")
+    PAGE_HEADER_SIZE = 64
+    ENTRY = struct.Struct("<48sIIQ")
+    ENTRY_SIZE = 64
+    SEQUENCE_OFFSET = 16
+
+    COUNTER = 0
+    GAUGE = 1
+    VALUE = 2
+
+    def __init__(self, name):
+        """Map the page with the specified POSIX shared memory name."""
+        self.name = name
+        self.types = {}
+        path = os.path.join("/dev/shm", name.lstrip("/"))
+        try:
+            with open(path, "rb") as page_file:
+                self.page = mmap.mmap(page_file.fileno(), 0, access=mmap.ACCESS_READ)
+        except OSError as e:
+            raise MetricsPageError("Unable to map metrics page {}: {}".format(name, e))
+
+        (magic, version, _, self.pid, _, _) = self.PAGE_HEADER.unpack_from(self.page, 0)
+        if magic != self.PAGE_MAGIC or version != self.PAGE_VERSION:
+            raise MetricsPageError(
+                "Shared memory {} is not a version {} metrics page".format(
+                    name, self.PAGE_VERSION
+                )
+            )
+
+    def sequence(self):
+        """Return the page sequence number, which is odd while the page is being updated."""
+        return struct.unpack_from("<Q", self.page, self.SEQUENCE_OFFSET)[0]
+
+    def read(self, retries=100):
+        """Take a consistent snapshot of the metrics in the page.
+
+        Returns a tuple of the monotonic update time in nanoseconds and a dictionary of metric
+        values, or None if the page was updated during every attempt to read it. The type of
+        each metric is recorded in the types dictionary.
+        """
+        for _ in range(retries):
+            sequence = self.sequence()
+            if sequence & 1:
+                continue
+
+            snapshot = bytes(self.page)
+
+            if self.sequence() != sequence:
+                continue
+
+            (_, _, num_metrics, _, _, update_ns) = self.PAGE_HEADER.unpack_from(snapshot, 0)
+            metrics = {}
+            for index in range(num_metrics):
+                (name, metric_type, _, value) = self.ENTRY.unpack_from(
+                    snapshot, self.PAGE_HEADER_SIZE + index * self.ENTRY_SIZE
+                )
+                if metric_type == self.VALUE:
+                    value = struct.unpack("<d", struct.pack("<Q", value))[0]
+                name = name.split(b"\0", 1)[0].decode()
+                metrics[name] = value
+                self.types[name] = metric_type
+            return update_ns, metrics
+
+        return None
+
+    def close(self):
+        """Unmap the page."""
+        self.page.close()
+
+
+def latency_summary(metrics, prefix):
+    """Summarise a latency histogram in a metrics snapshot.
+
+    The bins of the histogram are logarithmic in microseconds, with bin i counting latencies up
+    to 2^i us. Percentiles are estimated as the upper bound of the bin containing them, matching
+    the status reported by the plugins.
+    """
+    count = metrics[prefix + "count"]
+    bins = []
+    while prefix + "histogram/{}".format(len(bins)) in metrics:
+        bins.append(metrics[prefix + "histogram/{}".format(len(bins))])
+
+    def percentile(fraction):
+        target = int(fraction * count)
+        cumulative = 0
+        for (index, value) in enumerate(bins):
+            cumulative += value
+            if cumulative > target:
+                return 1 << index
+        return metrics[prefix + "max_ns"] / 1000
+
+    return {
+        "count": count,
+        "mean_us": (metrics[prefix + "sum_ns"] / 1000) / count if count else 0.0,
+        "p50_us": percentile(0.5),
+        "p99_us": percentile(0.99),
+        "max_us": metrics[prefix + "max_ns"] / 1000,
+    }
+
+
+def summarise(metrics):
+    """Return a metrics snapshot with each latency histogram replaced by its summary."""
+    summary = {}
+    histograms = set()
+    for (name, value) in metrics.items():
+        if "/histogram/" in name:
+            histograms.add(name.split("histogram/")[0])
+        else:
+            summary[name] = value
+
+    for prefix in histograms:
+        for key in ("invalid", "min_ns", "max_ns", "sum_ns", "count"):
+            summary.pop(prefix + key, None)
+        for (key, value) in latency_summary(metrics, prefix).items():
+            summary[prefix + key] = value
+
+    return summary
+
+
+@click.command()
+@click.option('--interval', default=1.0, help="Interval in seconds between reads")
+@click.option('--raw', is_flag=True, help="Print latency histogram bins instead of summaries")
+@click.option('--count', default=0, help="Number of reads, or 0 to read until interrupted")
+@click.argument('names', nargs=-1, required=True)
+def main(interval, raw, count, names):
+    """Print the metrics in one or more metrics pages at a regular interval.
+
+    Counter rates are calculated from the change since the previous read.
+    """
+    readers = [MetricsPageReader(name) for name in names]
+    previous = {}
+    reads = 0
+    try:
+        while not count or reads < count:
+            for reader in readers:
+                snapshot = reader.read()
+                if snapshot is None:
+                    print("{}: page busy, skipped".format(reader.name))
+                    continue
+
+                update_ns, metrics = snapshot
+                last = previous.get(reader.name)
+                previous[reader.name] = snapshot
+                print("{} (pid {}, updated {:.3f}s ago)".format(
+                    reader.name, reader.pid, time.clock_gettime(time.CLOCK_MONOTONIC)
+                    - update_ns / 1e9
+                ))
+
+                values = metrics if raw else summarise(metrics)
+                for name in sorted(values):
+                    line = "  {:<40} {}".format(name, values[name])
+                    if last and last[0] < update_ns and name in last[1] and \
+                            reader.types.get(name) == reader.COUNTER:
+                        rate = (values[name] - last[1][name]) / ((update_ns - last[0]) / 1e9)
+                        if rate:
+                            line += " ({:.1f}/s)".format(rate)
+                    print(line)
+
+            reads += 1
+            if not count or reads < count:
+                time.sleep(interval)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for reader in readers:
+            reader.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,71 @@
+# Unpacking of PCO camera frames packed to their sensor bit depth.
+#
+# The PcoCameraProcessPlugin can losslessly pack uint16 pixels to 10, 12 or 14 bits for storage
+# (see InairaPixelPacking.h). Pixels are packed LSB first into a little-endian bit stream, so each
+# group of four pixels fills exactly bits / 2 bytes. This module unpacks such frames back to uint16
+# images, either from a numpy array or from a dataset in an HDF5 file.
+import click
+import numpy as np
+
+
+PACKED_BITS = (10, 12, 14)
+GROUP_PIXELS = 4
+
+
+def packed_size(num_pixels, bits):
+    """Return the size in bytes of num_pixels pixels packed to the specified bit depth."""
+    return (num_pixels * bits + 7) // 8
+
+
+def unpack_pixels(packed, bits, shape):
+    """Unpack a packed frame.
+
+    Returns a uint16 numpy array of the specified shape unpacked from the packed bytes.
+    """
+    if bits not in PACKED_BITS:
+        raise ValueError("Unsupported packed bit depth {}".format(bits))
+
+    num_pixels = int(np.prod(shape))
+    group_bytes = bits // 2
+    num_groups = (num_pixels + GROUP_PIXELS - 1) // GROUP_PIXELS
+
+    # Zero-pad each group of bytes to a 64-bit word and extract the four pixels from it
+    packed = np.frombuffer(packed, dtype=np.uint8)[:packed_size(num_pixels, bits)]
+    groups = np.zeros((num_groups, 8), dtype=np.uint8)
+    padded = np.zeros(num_groups * group_bytes, dtype=np.uint8)
+    padded[:packed.size] = packed
+    groups[:, :group_bytes] = padded.reshape(num_groups, group_bytes)
+    words = groups.view("<u8").reshape(num_groups, 1)
+
+    shifts = np.arange(GROUP_PIXELS, dtype=np.uint64) * np.uint64(bits)
+    mask = np.uint64((1 << bits) - 1)
+    pixels = ((words >> shifts) & mask).astype(np.uint16).reshape(-1)
+
+    return pixels[:num_pixels].reshape(shape)
+
+
+@click.command()
+@click.option('--bits', type=click.Choice([str(bits) for bits in PACKED_BITS]), required=True,
+              help="Packed bit depth")
+@click.option('--height', type=int, required=True, help="Unpacked image height")
+@click.option('--width', type=int, required=True, help="Unpacked image width")
+@click.option('--dataset', default="pco", help="Packed dataset name")
+@click.argument('input_file')
+@click.argument('output_file')
+def main(bits, height, width, dataset, input_file, output_file):
+    """Unpack the packed frames of a dataset in an HDF5 file into a uint16 dataset."""
+    import h5py
+
+    bits = int(bits)
+    with h5py.File(input_file, "r") as input_hdf, h5py.File(output_file, "w") as output_hdf:
+        packed = input_hdf[dataset]
+        unpacked = output_hdf.create_dataset(
+            dataset, shape=(packed.shape[0], height, width), dtype=np.uint16
+        )
+        for frame in range(packed.shape[0]):
+            unpacked[frame] = unpack_pixels(packed[frame], bits, (height, width))
+        print("Unpacked {} frames of {} bit pixels to {}".format(packed.shape[0], bits, output_file))
+
+
+if __name__ == "__main__":
+    main()
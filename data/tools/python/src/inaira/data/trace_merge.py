@@ -0,0 +1,36 @@
+# Merging of Inaira trace files into a single timeline.
+#
+# The PCO frame decoder and each frame processor plugin dump the spans they record as a separate
+# Chrome trace event JSON file (see InairaTrace.h). All span times are taken from the host
+# monotonic clock, so the events of the separate files can simply be combined into one trace, which
+# shows each frame moving from the receiver through the processor plugins when opened in Perfetto.
+import json
+
+import click
+
+
+def merge_traces(trace_files):
+    """Return the combined trace events of a list of trace files, ordered by time."""
+    events = []
+    for trace_file in trace_files:
+        with open(trace_file) as trace:
+            events.extend(json.load(trace)["traceEvents"])
+
+    # Metadata events naming the threads have no timestamp and are placed first
+    events.sort(key=lambda event: event.get("ts", 0.0))
+    return events
+
+
+@click.command()
+@click.option('--output', '-o', default="trace.json", help="Merged trace output file")
+@click.argument('trace_files', nargs=-1, required=True)
+def main(output, trace_files):
+    """Merge the trace files dumped by the frame receiver and processor into one trace."""
+    events = merge_traces(trace_files)
+    with open(output, "w") as trace:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, trace)
+    print("Merged {} events from {} files into {}".format(len(events), len(trace_files), output))
+
+
+if __name__ == "__main__":
+    main()